@@ -0,0 +1,73 @@
+#pragma once
+
+#include <types.h>
+#include <gx/context.h>
+
+#include <exception>
+#include <stdexcept>
+
+namespace brdrive {
+
+// Forward declaration
+class IWindow;
+
+// PIMPL struct
+struct pEGLContext;
+
+// Headless GLContext, which doesn't need a window (or an X server
+//   at all when EGL_MESA_platform_surfaceless is available) and
+//   so can only render into GLFramebuffers
+//  - acquire() MUST be called with 'window' == nullptr and
+//    the 'share' context (if any) must be an EGLContext
+//  - gx_init() has to be passed EGLContext::get_proc_address
+class EGLContext : public GLContext {
+public:
+  enum Mode {
+    // Surfaceless when EGL_KHR_surfaceless_context
+    //   is supported, Pbuffer otherwise
+    Auto,
+
+    // The context is made current without any surface
+    Surfaceless,
+    // The context gets a dummy 1x1 pbuffer surface
+    Pbuffer,
+  };
+
+  struct NoDisplayError : public std::runtime_error {
+    NoDisplayError() :
+      std::runtime_error("failed to get or initialize an EGLDisplay!")
+    { }
+  };
+
+  struct SurfacelessUnsupportedError : public std::runtime_error {
+    SurfacelessUnsupportedError() :
+      std::runtime_error("Surfaceless mode requested, but EGL_KHR_surfaceless_context isn't supported!")
+    { }
+  };
+
+  EGLContext(Mode mode = Auto);
+  virtual ~EGLContext();
+
+  virtual auto acquire(
+      IWindow *window = nullptr, GLContext *share = nullptr
+    ) -> GLContext&;
+
+  virtual auto makeCurrent() -> GLContext&;
+  virtual auto swapBuffers() -> GLContext&;
+  virtual auto destroy() -> GLContext&;
+
+  virtual auto handle() -> GLContextHandle;
+
+  // Returns the Mode which was chosen by acquire()
+  auto mode() const -> Mode;
+
+  // Wrapper over eglGetProcAddress() to be passed to gx_init()
+  static auto get_proc_address(const char *name) -> GLProc;
+
+private:
+  Mode mode_;
+
+  pEGLContext *p;
+};
+
+}
@@ -395,6 +395,13 @@ public:
   GLUniformBuffer();
 };
 
+// Can be bound to GLBufferBindPoints of the ShaderStorageType
+//   (requires ARB_shader_storage_buffer_object)
+class GLShaderStorageBuffer : public GLBuffer {
+public:
+  GLShaderStorageBuffer();
+};
+
 class GLPixelBuffer : public GLBuffer {
 public:
   enum XferDirection {
@@ -451,6 +458,32 @@ public:
   GLBufferTexture();
 };
 
+// Source of the parameters for glDraw*Indirect() and
+//   glMultiDraw*Indirect() calls
+//  - The commands must be written into the buffer
+//    tightly packed (i.e. with a stride of 0)
+class GLDrawIndirectBuffer : public GLBuffer {
+public:
+  // Layouts mandated by the OpenGL spec,
+  //   intended for direct memcpy() into the buffer
+  struct DrawArraysCommand {
+    u32 count;
+    u32 instance_count;
+    u32 first;
+    u32 base_instance;
+  };
+
+  struct DrawElementsCommand {
+    u32 count;
+    u32 instance_count;
+    u32 first_index;
+    i32 base_vertex;
+    u32 base_instance;
+  };
+
+  GLDrawIndirectBuffer();
+};
+
 enum GLBufferBindPointType : unsigned {
   UniformType,
   ShaderStorageType,
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <gx/gx.h>
+
+#include <bitset>
+#include <string>
+#include <unordered_set>
+
+namespace brdrive {
+
+// Snapshot of the extensions and implementation limits
+//   of a GLContext, queried only once - by gx_init() for the
+//   context which is current at that point and by the first
+//   makeCurrent() of every context acquire()'d later on
+//  - The ARB::* and EXT::* extension queries (see extensions.h)
+//    read the GLCaps of GLContext::current()
+//  - Limits which depend on an unavailable extension are 0
+struct GLCaps {
+  // Extensions which are checked on (potentially) hot paths
+  enum Extension : unsigned {
+    ARB_vertex_attrib_binding,
+    ARB_separate_shader_objects,
+    ARB_tessellation_shader,
+    ARB_compute_shader,
+    ARB_texture_storage,
+    ARB_buffer_storage,
+    ARB_direct_state_access,
+    ARB_texture_filter_anisotropic,
+    ARB_multi_draw_indirect,
+    ARB_shader_draw_parameters,
+    ARB_shader_storage_buffer_object,
+    ARB_base_instance,
+
+    EXT_direct_state_access,
+    EXT_texture_filter_anisotropic,
+
+    NumExtensions,
+  };
+
+  // Queries the GLContext which is current on the calling thread
+  static auto query() -> GLCaps;
+
+  auto has(Extension extension) const -> bool { return extensions_.test(extension); }
+
+  // 'name' MUST be the WHOLE extension name string (see queryExtension())
+  auto has(const char *name) const -> bool;
+
+  // ARB_direct_state_access || EXT_direct_state_access
+  auto directStateAccess() const -> bool { return dsa_; }
+
+  // GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS
+  int max_texture_image_units = 0;
+  int max_texture_size = 0;
+  int max_3d_texture_size = 0;
+  int max_array_texture_layers = 0;
+  float max_texture_max_anisotropy = 0.0f;
+
+  int max_vertex_attribs = 0;
+  int max_vertex_attrib_bindings = 0;
+
+  int max_uniform_buffer_bindings = 0;
+  int max_uniform_block_size = 0;
+  int uniform_buffer_offset_alignment = 0;
+
+  int max_shader_storage_buffer_bindings = 0;
+  int shader_storage_buffer_offset_alignment = 0;
+
+  int max_transform_feedback_buffers = 0;
+
+  int max_color_attachments = 0;
+  int max_draw_buffers = 0;
+  int max_samples = 0;
+
+private:
+  std::bitset<NumExtensions> extensions_;
+  bool dsa_ = false;
+
+  // All of the context's extensions, including
+  //   ones which aren't listed in the enum above
+  std::unordered_set<std::string> all_extensions_;
+};
+
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <gx/gx.h>
+#include <gx/caps.h>
+#include <gx/dispatch.h>
 
 #include <exception>
 #include <stdexcept>
@@ -15,6 +17,9 @@ class GLTexImageUnit;
 class GLBufferBindPoint;
 class GLTexture2D;
 class GLSampler;
+class GLProfiler;
+class GLStateTracker;
+class GLDebugLog;
 
 enum GLBufferBindPointType : unsigned;
 // --------------------
@@ -28,6 +33,12 @@ struct GLVersion {
 
 class GLContext {
 public:
+  // See dbg_EnableMessages()
+  enum DebugOutput {
+    DebugOutputAsync,
+    DebugOutputSync,
+  };
+
   struct NoSuitableFramebufferConfigError : public std::runtime_error {
     NoSuitableFramebufferConfigError() :
       std::runtime_error("no siutable frmebuffer config could be found!")
@@ -59,6 +70,10 @@ public:
   static GLContext *current();
 
   // Acquires and initializes the GLContext
+  //  - When 'window' == nullptr the context doesn't get a
+  //    default framebuffer (swapBuffers() can't be called)
+  //  - All contexts acquire()'d with a 'share' context share
+  //    it's objects (buffers, textures, fences...)
   virtual auto acquire(
       IWindow *window, GLContext *share = nullptr
     ) -> GLContext& = 0;
@@ -78,22 +93,50 @@ public:
   //   yet been called
   virtual auto handle() -> GLContextHandle = 0;
 
+  // The GLCaps and GLDispatch are only available after gx_init()
+  //   has been called (see the comment above GLCaps)
+  auto caps() const -> const GLCaps&;
+  auto dispatch() const -> const GLDispatch&;
+
+  // - 'slot' must be < min(GLNumTexImageUnits, caps().max_texture_image_units)
   auto texImageUnit(unsigned slot) -> GLTexImageUnit&;
 
+  // Returns the GLStateTracker which shadows this context's
+  //   bindings (see the comment above GLStateTracker)
+  auto state() -> GLStateTracker&;
+
   // If ARB::direct_state_access || EXT::direct_state_access
   //   this method always returns 0
   auto activeTexture() const -> unsigned;
 
+  // - 'index' must be < GLNumBufferBindPoints and the
+  //   caps().max_*_bindings limit of the 'bind_point'
   auto bufferBindPoint(
       GLBufferBindPointType bind_point, unsigned index
     ) -> GLBufferBindPoint&;
 
   // Can only be called AFTER gx_init()!
-  auto dbg_EnableMessages() -> GLContext&;
+  //  - The messages are handed off to the 'log' (or, when it's
+  //    nullptr, to GLDebugLog::global()) which prints them on it's
+  //    own thread, the 'log' MUST outlive the GLContext
+  //  - DebugOutputSync makes the driver report the messages on the
+  //    thread (and inside of the GL call) which caused them - useful
+  //    for breakpoints in GLDebugLog::callback(), but it keeps the
+  //    driver from doing any work on it's own threads
+  auto dbg_EnableMessages(
+      DebugOutput output = DebugOutputAsync, GLDebugLog *log = nullptr
+    ) -> GLContext&;
 
   auto dbg_PushCallGroup(const char *name) -> GLContext&;
   auto dbg_PopCallGroup() -> GLContext&;
 
+  // Once attached, the 'profiler' measures the GPU time of every
+  //   dbg_PushCallGroup()/dbg_PopCallGroup() pair (in all build
+  //   configurations), pass nullptr to detach it
+  //  - The GLProfiler must outlive the attachment
+  auto attachProfiler(GLProfiler *profiler) -> GLContext&;
+  auto profiler() const -> GLProfiler *;
+
   auto versionString() -> std::string;
   auto version() -> GLVersion;
 
@@ -107,12 +150,24 @@ private:
   friend GLTexImageUnit;
   friend GLBufferBindPoint;
 
+  friend void gx_init(GLGetProcAddressFn);
+
+  // Snapshots the GLCaps and selects the GLDispatch
+  void queryCaps();
+
   GLTexImageUnit *tex_image_units_;        //   Array
-  unsigned active_texture_;
 
   GLBufferBindPoint *buffer_bind_points_;  // ---||---
 
   unsigned dbg_group_id_;
+
+  GLStateTracker *state_;
+
+  bool caps_queried_;
+  GLCaps caps_;
+  GLDispatch dispatch_;
+
+  GLProfiler *profiler_;
 };
 
 }
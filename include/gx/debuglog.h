@@ -0,0 +1,144 @@
+#pragma once
+
+#include <gx/gx.h>
+
+#include <cstdio>
+
+#include <array>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace brdrive {
+
+// Collects the messages reported via the KHR_debug callback
+//   (see GLContext::dbg_EnableMessages()) and prints them on
+//   a dedicated thread, so the driver never waits on I/O
+//  - The callback only copies the message into a fixed-size
+//    ring buffer, which never takes a lock and can be written
+//    to by many threads at once (with asynchronous debug output
+//    the driver calls it from it's own threads), messages which
+//    don't fit are dropped and counted
+//  - Each message id is allowed at most 'rate_limit' messages per
+//    second, the rest is counted but never reaches the ring, and
+//    runs of identical messages are printed only once followed
+//    by a repeat count
+//  - Messages from GL_DEBUG_SOURCE_APPLICATION (i.e. the debug
+//    groups pushed by GLContext::dbg_PushCallGroup()) are skipped
+class GLDebugLog {
+public:
+  enum : u32 {
+    RingSize = 1024,    // MUST be a power of 2
+
+    // Longer messages get truncated
+    MaxMessageLength = 256,
+
+    // Size of the table which tracks the per-id rates,
+    //   ids which hash to the same entry share their limit
+    RateTableSize = 256,
+
+    DefaultRateLimit = 16,    // Messages per second
+  };
+
+  struct Stats {
+    u64 num_logged;         // Number of messages which were printed
+    u64 num_repeated;       // Number of messages which were folded into a repeat count
+    u64 num_rate_limited;   // Number of messages which exceeded the rate limit
+    u64 num_dropped;        // Number of messages which didn't fit in the ring
+  };
+
+  // - 'out' MUST stay open until the GLDebugLog is destroyed
+  GLDebugLog(FILE *out = stderr, u32 rate_limit = DefaultRateLimit);
+  GLDebugLog(const GLDebugLog&) = delete;
+  ~GLDebugLog();
+
+  // Returns the GLDebugLog used by GLContext::dbg_EnableMessages()
+  //   when none was given explicitly, it logs to stderr
+  static auto global() -> GLDebugLog&;
+
+  // Pass as the 'callback' to glDebugMessageCallback()
+  //   with this GLDebugLog as the 'userParam'
+  static void callback(
+      GLEnum source, GLEnum type, GLId id, GLEnum severity,
+      GLSize length, const char *message, const void *user
+  );
+
+  // Prints all the messages which are currently in the ring
+  //   on the calling thread, without waiting for the logging
+  //   thread to pick them up (e.g. before a crash or abort())
+  auto flush() -> GLDebugLog&;
+
+  auto stats() const -> Stats;
+
+private:
+  struct Message {
+    // Equal to the position of the Message in the ring when it's
+    //   free for writing and to that position + 1 once written
+    std::atomic<u64> sequence;
+
+    GLEnum source, type, severity;
+    GLId id;
+
+    char message[MaxMessageLength];
+  };
+
+  struct RateEntry {
+    std::atomic<u64> key;     // (source << 32) | id
+    std::atomic<u64> second;  // The second in which 'count' started counting
+    std::atomic<u32> count;
+  };
+
+  // Returns 'false' when the message should be rate-limited
+  auto admit(GLEnum source, GLId id) -> bool;
+
+  auto push(
+      GLEnum source, GLEnum type, GLId id, GLEnum severity,
+      GLSize length, const char *message
+  ) -> void;
+
+  // Prints all the messages which are in the ring and
+  //   returns their number, MUST be called with 'drain_mutex_'
+  //   held (i.e. the ring only ever has a single reader)
+  auto drain() -> unsigned;
+
+  auto print(const Message& msg) -> void;
+  auto printRepeats() -> void;
+
+  void loggerMain();
+
+  FILE *out_;
+  u32 rate_limit_;
+
+  std::array<Message, RingSize> ring_;
+  alignas(64) std::atomic<u64> write_pos_;
+
+  std::array<RateEntry, RateTableSize> rates_;
+
+  std::atomic<u64> num_rate_limited_;
+  std::atomic<u64> num_dropped_;
+
+  std::mutex drain_mutex_;
+  std::condition_variable quit_requested_;
+  bool quit_;                 // Protected by 'drain_mutex_'
+
+  // The members below are protected by 'drain_mutex_'
+  u64 read_pos_;
+
+  // The last printed message and how many times it
+  //   was repeated since (excluding the printed one)
+  GLEnum last_source_, last_type_;
+  GLId last_id_;
+  std::array<char, MaxMessageLength> last_message_;
+  u64 last_repeats_;
+
+  // Values of the counters which were already reported in the log
+  u64 reported_rate_limited_, reported_dropped_;
+
+  std::atomic<u64> num_logged_;
+  std::atomic<u64> num_repeated_;
+
+  std::thread logger_;
+};
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <gx/gx.h>
+
+namespace brdrive {
+
+// Forward declaration
+struct GLCaps;
+
+// Per-context table of the operations which have both a direct
+//   state access and a bind-to-edit implementation, selected
+//   once (along with the GLCaps snapshot), so the hot paths -
+//   buffer uploads/mappings, texture binds and uploads and
+//   uniform uploads - don't test for the extensions on every
+//   call
+//  - The bind-to-edit implementations go through the context's
+//    GLStateTracker, the buffers get unbound afterwards
+//  - The 'target' arguments are ignored by the direct state
+//    access implementations
+struct GLDispatch {
+  // Returns the GLDispatch of GLContext::current()
+  static auto current() -> const GLDispatch&;
+
+  // Selects the implementations according to the 'caps'
+  static auto select(const GLCaps& caps) -> GLDispatch;
+
+  // GLBuffer
+  void (*bufferSubData)(
+      GLId buffer, GLEnum target, intptr_t offset, GLSizePtr size, const void *data
+  );
+  void *(*mapBufferRange)(
+      GLId buffer, GLEnum target, intptr_t offset, GLSizePtr size, u32 access
+  );
+  void (*unmapBuffer)(GLId buffer, GLEnum target);
+  void (*flushMappedBufferRange)(
+      GLId buffer, GLEnum target, intptr_t offset, GLSizePtr length
+  );
+
+  // GLTexImageUnit/GLTexture2D
+  //  - bindTextureUnit() changes the active texture unit
+  //    when direct state access is unavailable, whereas
+  //    textureSubImage2D() uses the current one
+  void (*bindTextureUnit)(unsigned unit, GLEnum target, GLId texture);
+  void (*textureSubImage2D)(
+      GLId texture, unsigned level, unsigned width, unsigned height,
+      GLEnum format, GLEnum type, const void *data
+  );
+
+  // GLProgram - the bind-to-edit versions use() the
+  //   program (with glProgramUniform*() being available
+  //   with either of ARB_direct_state_access or
+  //   ARB_separate_shader_objects)
+  void (*programUniform1i)(GLId program, int location, int i);
+  void (*programUniform1f)(GLId program, int location, float f);
+  void (*programUniform2f)(GLId program, int location, float x, float y);
+  void (*programUniform3f)(GLId program, int location, float x, float y, float z);
+  void (*programUniformMatrix4fv)(
+      GLId program, int location, GLSize count, bool transpose, const float *value
+  );
+};
+
+}
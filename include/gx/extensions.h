@@ -1,6 +1,7 @@
 #pragma once
 
 #include <gx/gx.h>
+#include <gx/caps.h>
 
 namespace brdrive {
 // 'name' MUST be the WHOLE extension name string i.e.:
@@ -15,43 +16,47 @@ auto queryExtension(const char *name) -> bool;
 namespace extensions_detail {
 
 // Usage: define an instance of the struct object passing
-//        the WHOLE extension name string i.e.:
-//            CachedExtensionQuery("GL_ARB_buffer_storage")
-//     *NOT*  CachedExtensionQuery("ARB_buffer_storage")
+//        the GLCaps::Extension i.e.:
+//            CachedExtensionQuery(GLCaps::ARB_buffer_storage)
 //        after that apply the call operator to the object
 //        to query the avilability of the extension (or
 //        use operator bool() either via an explicit or
 //        a contextual cast)
+//  - The result comes from the GLCaps of GLContext::current(),
+//    which caches the avilability of all the extensions
 struct CachedExtensionQuery {
-  constexpr CachedExtensionQuery(const char *extension) :
-    extension_(extension), query_result_(-1)
+  constexpr CachedExtensionQuery(GLCaps::Extension extension) :
+    extension_(extension)
   { }
 
-  auto operator()() -> bool;
+  auto operator()() const -> bool;
 
-  operator bool() { return (*this)(); }
+  operator bool() const { return (*this)(); }
 
 private:
-  const char * const extension_;
-  int query_result_;
+  const GLCaps::Extension extension_;
 };
 
 }
 
 namespace ARB {
-extern thread_local extensions_detail::CachedExtensionQuery vertex_attrib_binding;
-extern thread_local extensions_detail::CachedExtensionQuery separate_shader_objects;
-extern thread_local extensions_detail::CachedExtensionQuery tessellation_shader;
-extern thread_local extensions_detail::CachedExtensionQuery compute_shader;
-extern thread_local extensions_detail::CachedExtensionQuery texture_storage;
-extern thread_local extensions_detail::CachedExtensionQuery buffer_storage;
-extern thread_local extensions_detail::CachedExtensionQuery direct_state_access;
-extern thread_local extensions_detail::CachedExtensionQuery texture_filter_anisotropic;
+extern const extensions_detail::CachedExtensionQuery vertex_attrib_binding;
+extern const extensions_detail::CachedExtensionQuery separate_shader_objects;
+extern const extensions_detail::CachedExtensionQuery tessellation_shader;
+extern const extensions_detail::CachedExtensionQuery compute_shader;
+extern const extensions_detail::CachedExtensionQuery texture_storage;
+extern const extensions_detail::CachedExtensionQuery buffer_storage;
+extern const extensions_detail::CachedExtensionQuery direct_state_access;
+extern const extensions_detail::CachedExtensionQuery texture_filter_anisotropic;
+extern const extensions_detail::CachedExtensionQuery multi_draw_indirect;
+extern const extensions_detail::CachedExtensionQuery shader_draw_parameters;
+extern const extensions_detail::CachedExtensionQuery shader_storage_buffer_object;
+extern const extensions_detail::CachedExtensionQuery base_instance;
 }
 
 namespace EXT {
-extern thread_local extensions_detail::CachedExtensionQuery direct_state_access;
-extern thread_local extensions_detail::CachedExtensionQuery texture_filter_anisotropic;
+extern const extensions_detail::CachedExtensionQuery direct_state_access;
+extern const extensions_detail::CachedExtensionQuery texture_filter_anisotropic;
 }
 
 }
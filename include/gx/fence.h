@@ -5,6 +5,8 @@
 #include <exception>
 #include <stdexcept>
 #include <string>
+#include <deque>
+#include <vector>
 
 namespace brdrive {
 
@@ -34,8 +36,19 @@ public:
 
   auto operator=(GLFence&& other) -> GLFence&;
 
+  // Inserts a new fence into the GL command stream
+  //   - If the GLFence already holds a fence it's
+  //     deleted and replaced by the new one
   auto fence() -> GLFence&;
 
+  // Deletes the held fence (if any), after this
+  //   call fenced() == false
+  auto reset() -> GLFence&;
+
+  // Returns 'true' if fence() was called (and
+  //   reset() wasn't called after it)
+  auto fenced() const -> bool;
+
   // Causes the program's execution to halt until
   //   either the fence is signaled or the timeout
   //   expires
@@ -45,6 +58,12 @@ public:
   //   issuing any commands to the GPU
   auto sync(u64 timeout = TimeoutInfinite) -> GLFence&;
 
+  // Makes sure the fence will eventually be signaled by flushing
+  //   the context's command queue, which is required before
+  //   waiting on the fence in another context (block() only
+  //   flushes the context which is current on the calling thread)
+  auto flush() -> GLFence&;
+
   auto signaled() -> bool;
 
   auto label() const -> const char *;
@@ -59,4 +78,33 @@ private:
 #endif
 };
 
+// Recycles GLFence objects, so code which needs a lot of
+//   short-lived fences doesn't have to allocate a GLFence
+//   for each one of them
+//  - The GL sync objects themselves can't be reused (every
+//    GLFence::fence() creates a new one), release() deletes
+//    the sync object right away
+//  - The returned references stay valid for the lifetime
+//    of the pool
+class GLFencePool {
+public:
+  GLFencePool() = default;
+  GLFencePool(const GLFencePool&) = delete;
+
+  // Returns a GLFence for which fenced() == false
+  auto acquire() -> GLFence&;
+
+  // Returns the 'fence' (which MUST have been acquire()'d
+  //   from this pool) to the pool, after calling reset() on it
+  auto release(GLFence& fence) -> GLFencePool&;
+
+  // Returns the number of GLFence objects ever created by the pool
+  auto size() const -> size_t;
+
+private:
+  // std::deque never moves it's elements on push_back()
+  std::deque<GLFence> fences_;
+  std::vector<GLFence *> free_;
+};
+
 }
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <gx/gx.h>
+#include <gx/object.h>
+
+#include <exception>
+#include <stdexcept>
+
+namespace brdrive {
+
+// Forward declarations
+class GLTexture2D;
+
+class GLFramebuffer : public GLObject {
+public:
+  enum : unsigned {
+    MaxColorAttachments = 8,
+  };
+
+  enum Status {
+    StatusInvalid,
+
+    Complete,
+
+    IncompleteAttachment,         // GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT
+    IncompleteMissingAttachment,  // GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT
+    IncompleteOther,              // Any of the other GL_FRAMEBUFFER_INCOMPLETE_* values
+    Unsupported,                  // GL_FRAMEBUFFER_UNSUPPORTED
+  };
+
+  struct IncompleteError : public std::runtime_error {
+    IncompleteError() :
+      std::runtime_error("attempted to use() an incomplete framebuffer!")
+    { }
+  };
+
+  GLFramebuffer();
+  GLFramebuffer(GLFramebuffer&& other);
+  virtual ~GLFramebuffer();
+
+  auto operator=(GLFramebuffer&& other) -> GLFramebuffer&;
+
+  // Attaches the 'level' of 'tex' as GL_COLOR_ATTACHMENT0+index and
+  //   adds it to the draw buffers, in the order of the indices
+  //  - The texture must've been alloc()'ed beforehand
+  auto color(unsigned index, GLTexture2D& tex, unsigned level = 0) -> GLFramebuffer&;
+
+  auto status() -> Status;
+
+  // Binds the framebuffer as both the draw and read framebuffer,
+  //   throws IncompleteError if status() != Complete
+  auto use() -> GLFramebuffer&;
+
+  // Binds the context's default framebuffer (which doesn't
+  //   exist for contexts acquire()'d without a window)
+  static auto use_default() -> void;
+
+protected:
+  auto swap(GLFramebuffer& other) -> GLFramebuffer&;
+
+  virtual auto doDestroy() -> GLObject& final;
+
+private:
+  // Lazily creates the OpenGL framebuffer object
+  void initGLObject();
+
+  // Bitmask of the attached color attachments
+  unsigned color_attachments_;
+
+  // Cached result of status(), reset every
+  //   time an attachment is changed
+  Status status_;
+};
+
+}
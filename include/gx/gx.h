@@ -26,6 +26,7 @@ enum GLFormat : int {
   rg8i, rg8ui, rg16i, rg16ui,
   rgb8i, rgb8ui, rgb16i, rgb16ui,
   rgba8i, rgba8ui, rgba16i, rgba16ui,
+  r32i, r32ui, rg32i, rg32ui, rgba32i, rgba32ui,
   srgb8, srgb8_a8,
   depth,
   depth16, depth24, depth32f,
@@ -54,12 +55,22 @@ enum class GLPrimitive : int {
   Triangles, TriangleStrip, TriangleFan,
 };
 
- // TODO: query OpenGL for this (?)
+// Upper bounds on the number of texture image units and indexed
+//   buffer bind points (per-type) which can be used, meant for
+//   sizing arrays - the hardware can have fewer of them (e.g. only
+//   4 transform feedback buffers), see GLContext::caps()
 static constexpr unsigned GLNumTexImageUnits    = 16;
 static constexpr unsigned GLNumBufferBindPoints = 16;
 
+// Generic OpenGL function pointer
+using GLProc = void (*)();
+// Returns the address of the OpenGL function called 'name'
+using GLGetProcAddressFn = GLProc (*)(const char *name);
+
 // Can only be called AFTER acquiring an OpenGL context!
-void gx_init();
+//  - When 'get_proc_address' == nullptr the functions are
+//    loaded via glXGetProcAddress()
+void gx_init(GLGetProcAddressFn get_proc_address = nullptr);
 void gx_finalize();
 
 auto gx_was_init() -> bool;
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <gx/gx.h>
+#include <gx/fence.h>
+
+#include <deque>
+#include <functional>
+#include <exception>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace brdrive {
+
+// Forward declarations
+class GLContext;
+
+// Creates and fills GL objects (buffers, textures, samplers...)
+//   on a helper thread, so loading them never stalls rendering
+//  - The helper thread makes the 'context' passed to the
+//    constructor current, so it must've been acquire()'d with
+//    the rendering context as 'share' (and without a window)
+//    and must not be current on any other thread
+//  - A GLFence is inserted after every LoadFn and the matching
+//    DoneFn is only called (by collect(), on the thread which
+//    owns the rendering context) after the GPU has signaled it,
+//    so the objects are guaranteed to be complete by then
+//  - Container objects (vertex arrays, framebuffers, program
+//    pipelines) aren't shared between contexts - so they MUST
+//    NOT be created by the LoadFns
+class GLResourceLoader {
+public:
+  // Called on the helper thread with it's context current
+  using LoadFn = std::function<void()>;
+  // Called by collect() once the LoadFn's commands have completed,
+  //   this is where the objects should be handed over to their owners
+  using DoneFn = std::function<void()>;
+
+  GLResourceLoader(GLContext& context);
+  GLResourceLoader(const GLResourceLoader&) = delete;
+  ~GLResourceLoader();
+
+  // Queues a load - the LoadFns are run in the order
+  //   of the load() calls and so are the DoneFns
+  auto load(LoadFn load_fn, DoneFn done_fn) -> GLResourceLoader&;
+
+  // Calls the DoneFns of the loads which have completed (never
+  //   blocks) and returns their number
+  //  - If a LoadFn threw, the exception gets rethrown here
+  //    instead of calling the DoneFn
+  auto collect() -> unsigned;
+
+  // Blocks until all the queued loads complete
+  //   and calls their DoneFns
+  auto finish() -> GLResourceLoader&;
+
+  // Returns the number of loads whose DoneFns haven't been called yet
+  auto numPending() const -> unsigned;
+
+private:
+  struct Load {
+    LoadFn load_fn;
+    DoneFn done_fn;
+
+    GLFence fence;
+    std::exception_ptr exception;
+  };
+
+  void workerMain();
+
+  // Returns 'false' if there wasn't a completed
+  //   Load at the front of 'loaded_'
+  auto collectOne(bool block) -> bool;
+
+  GLContext& context_;
+
+  std::thread worker_;
+
+  std::mutex mutex_;
+  std::condition_variable load_available_;
+  std::condition_variable load_done_;
+
+  // The members below are protected by 'mutex_'
+  std::deque<Load> queue_;      // Loads yet to run on the helper thread
+  std::deque<Load> loaded_;     // ...which were issued to the GPU
+  bool quit_;
+
+  std::atomic<unsigned> num_pending_;
+};
+
+}
@@ -7,6 +7,17 @@
 
 namespace brdrive {
 
+// Owner of all of OpenGL's fixed-function state, i.e.
+//   - viewport and scissor rectangles
+//   - rasterizer state (face culling, polygon mode)
+//   - depth/stencil test state
+//   - blending
+//   - input assembly (primitive type and restart index)
+// A GLPipeline stores only the state structs which were add()'ed to
+//   it - all other state is considered a "don't care" and is left
+//   untouched when the pipeline is use()'d. When use() is called the
+//   pipeline is diff()'ed against the state applied by the previously
+//   used one, and only the state structs which differ get sent to GL
 class GLPipeline {
 public:
   enum : u32 {
@@ -25,20 +36,26 @@ public:
     CompareFuncEqual = 2, CompareFuncNotEqual = 3,
     CompareFuncLess = 4, CompareFuncLessEqual = 5,
     CompareFuncGreater = 6, CompareFuncGreaterEqual = 7,
-  };
 
-  struct Program {
-    GLId program;
-  };
+    StencilOpKeep = 0, StencilOpZero = 1, StencilOpReplace = 2,
+    StencilOpIncr = 3, StencilOpIncrWrap = 4,
+    StencilOpDecr = 5, StencilOpDecrWrap = 6,
+    StencilOpInvert = 7,
+
+    BlendFactorZero = 0, BlendFactorOne = 1,
+    BlendFactorSrcColor = 2, BlendFactorOneMinusSrcColor = 3,
+    BlendFactorDstColor = 4, BlendFactorOneMinusDstColor = 5,
+    BlendFactorSrcAlpha = 6, BlendFactorOneMinusSrcAlpha = 7,
+    BlendFactorDstAlpha = 8, BlendFactorOneMinusDstAlpha = 9,
 
-  struct VertexInput {
-    GLId array;
-    GLType indices_type;
+    BlendEquationAdd = 0, BlendEquationSubtract = 1, BlendEquationReverseSubtract = 2,
+    BlendEquationMin = 3, BlendEquationMax = 4,
   };
 
   struct InputAssembly {
     GLPrimitive primitive;
 
+    // When == RestartIndexNone primitive restart is disabled
     u32 restart_index;
   };
 
@@ -46,46 +63,105 @@ public:
     u16 x, y, w, h;
   };
 
+  // When 'scissor' == 0 the scissor test is disabled
+  //   and the rectangle is ignored
   struct Scissor {
+    u32 scissor : 1;
+
     u16 x, y, w, h;
   };
 
   struct Rasterizer {
     u32 cull_mode : 2;
-    u32 cull_face : 1;
+    u32 front_face : 1;
     u32 polygon_mode : 2;
   };
 
-  // TODO: stencil test parameters
   struct DepthStencil {
     u32 depth_test : 1;
+    u32 depth_write : 1;
     u32 depth_func : 3;
+
+    u32 stencil_test : 1;
+    u32 stencil_func : 3;
+    u32 stencil_ref : 8;
+    u32 stencil_mask : 8;
+
+    u32 stencil_fail : 3;
+    u32 stencil_depth_fail : 3;
+    u32 stencil_pass : 3;
   };
 
   struct Blend {
     u32 blend : 1;
-  };
 
-  struct RawStateStruct {
-    // 2 u32's of space used at most by each of the possible variants
-    u8 raw[2 * sizeof(u32)];
+    u32 src_factor : 4;
+    u32 dst_factor : 4;
+    u32 equation : 3;
   };
 
   using StateStruct = std::variant<
     std::monostate,
-    VertexInput, InputAssembly, Viewport, Scissor,
-    Rasterizer, DepthStencil, Blend,
-    RawStateStruct
+    InputAssembly, Viewport, Scissor,
+    Rasterizer, DepthStencil, Blend
   >;
 
+  // Counters of the state structs which use() either had
+  //   to apply or could skip (because the same state was
+  //   already applied by a previously used pipeline)
+  struct Stats {
+    u64 num_applied;
+    u64 num_elided;
+  };
+
   GLPipeline();
   GLPipeline(const GLPipeline&) = delete;
 
+  // Sets the state struct of the type held by 'st' (i.e. replaces
+  //   the previously add()'ed struct of the same type, if any)
+  //  - Adding std::monostate is a no-op
+  auto add(const StateStruct& st) -> GLPipeline&;
+
+  // Convenience wrappers around add()
+  auto viewport(u16 x, u16 y, u16 w, u16 h) -> GLPipeline&;
+  auto scissor(u16 x, u16 y, u16 w, u16 h) -> GLPipeline&;
+  auto noScissor() -> GLPipeline&;
+  auto inputAssembly(GLPrimitive primitive, u32 restart_index = RestartIndexNone) -> GLPipeline&;
+  auto noDepth() -> GLPipeline&;
+  auto noBlend() -> GLPipeline&;
+  auto alphaBlend() -> GLPipeline&;
+
+  // Applies all the state which differs from the state currently
+  //   applied to the context
+  //  - The currently applied state is tracked per-thread (analogous
+  //    to GLProgram::use()) so all state changes must be done through
+  //    GLPipelines for the tracking to stay accurate
+  auto use() -> GLPipeline&;
+
+  // Returns the primitive type from the InputAssembly struct
+  //   or GLPrimitive::Invalid if no such struct was add()'ed
+  auto primitive() const -> GLPrimitive;
+
+  static auto stats() -> Stats;
+  static void resetStats();
+
+  // Forgets the currently applied state, so the next use()
+  //   will apply every struct of the pipeline being used
+  //  - Must be called after modifying state by other means
+  //    than a GLPipeline (or when switching contexts)
+  static void invalidateCurrent();
+
 private:
-  using StateStructArray = std::array<StateStruct, std::variant_size_v<StateStruct>>;
+  using StateStructArray = std::array<StateStruct, std::variant_size_v<StateStruct>-1>;
 
-  auto diff(const StateStructArray& other) -> StateStructArray;
+  // Returns an array with std::monostate everywhere where 'other'
+  //   and this pipeline's state_structs_ match (or where 'this'
+  //   doesn't specify any state), and this pipeline's state
+  //   struct everywhere else
+  auto diff(const StateStructArray& other) const -> StateStructArray;
 
+  // Stored ordered by the variant's index (minus 1 to skip
+  //   std::monostate), unset slots hold std::monostate
   StateStructArray state_structs_;
 };
 
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <gx/gx.h>
+#include <gx/query.h>
+
+#include <array>
+#include <deque>
+#include <vector>
+#include <string>
+
+namespace brdrive {
+
+// Measures the time the GPU spends executing the commands issued
+//   inside of GLContext::dbg_PushCallGroup()/dbg_PopCallGroup()
+//   pairs, which happens automatically once the GLProfiler is
+//   attached to the context via GLContext::attachProfiler()
+//  - Every group gets a pair of GL_TIMESTAMP queries, which are
+//    kept in a ring of NumFrames frames - the results of a frame
+//    are only read back by endFrame() once all of it's queries
+//    are available (so reading them back never stalls), if that
+//    doesn't happen before the frame's slot in the ring has to
+//    be reused the frame's results are dropped
+//  - Groups can be nested, the timings are reported in the
+//    order in which the groups were pushed
+//  - While tracing is enabled (see util/trace.h) the timings
+//    are also recorded as GPU zones via trace_gpu_zone()
+class GLProfiler {
+public:
+  enum : unsigned {
+    NumFrames = 4,
+  };
+
+  struct GroupTiming {
+    std::string name;
+    unsigned depth;     // 0 for top-level groups
+
+    u64 gpu_ns;         // Time between the push and the pop
+  };
+
+  struct Stats {
+    u64 frames_read;      // Number of frames whose results were read back
+    u64 frames_dropped;   // ...and which were discarded
+  };
+
+  GLProfiler();
+  GLProfiler(const GLProfiler&) = delete;
+
+  // Called by GLContext::dbg_PushCallGroup()/dbg_PopCallGroup()
+  auto pushGroup(const char *name) -> GLProfiler&;
+  auto popGroup() -> GLProfiler&;
+
+  // Ends the current frame and starts the next one, reads back
+  //   the results of all the previous frames which are available
+  //  - Returns 'true' if latestResults() was updated
+  auto endFrame() -> bool;
+
+  // Returns the timings of the most recent frame which has been
+  //   read back (empty if there wasn't one yet) and it's index
+  //   (counting endFrame() calls, starting at 0)
+  auto latestResults() const -> const std::vector<GroupTiming>&;
+  auto latestResultsFrame() const -> u64;
+
+  auto stats() const -> Stats;
+
+private:
+  struct Group {
+    std::string name;
+    unsigned depth;
+
+    // Indices into Frame::queries
+    unsigned begin_query, end_query;
+  };
+
+  struct Frame {
+    u64 index;
+    bool pending;   // Results haven't been read back yet
+
+    // trace_now() minus the GPU's time when the frame ended,
+    //   0 when tracing was disabled at that point
+    i64 trace_offset_ns;
+
+    std::vector<Group> groups;
+
+    // std::deque never moves it's elements on emplace_back(),
+    //   only the first 'num_queries' are used by this frame
+    std::deque<GLQuery> queries;
+    unsigned num_queries;
+  };
+
+  auto currentFrame() -> Frame&;
+
+  auto nextQuery() -> unsigned;
+
+  // Returns 'false' if the frame's results aren't available yet
+  auto tryReadBack(Frame& frame) -> bool;
+
+  std::array<Frame, NumFrames> frames_;
+  u64 frame_index_;
+
+  // Indices into the current frame's 'groups'
+  std::vector<unsigned> group_stack_;
+
+  std::vector<GroupTiming> latest_results_;
+  u64 latest_results_frame_;
+
+  Stats stats_;
+};
+
+}
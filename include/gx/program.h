@@ -223,6 +223,27 @@ public:
 
   auto uniformMat4x4(const char *name, const float *mat) -> GLProgram&;
 
+  // Returns the location of the uniform 'name' (or InvalidLocation
+  //   if it was optimized out) for use with the uniformAt() methods
+  //  - Throws UniformTypeError if the uniform was previously
+  //    uploaded with a different 'type'
+  auto uniformLocation(const char *name, UniformType type) -> UniformLocation;
+
+  // Same as uniform(const char *, int) above, except the name ->
+  //   location lookup is skipped, which makes it suitable for
+  //   uploads which are performed very frequently
+  //  - Sampler uniforms can be set by passing the
+  //    GLTexImageUnit::texImageUnitIndex() as 'i'
+  auto uniformAt(UniformLocation location, int i) -> GLProgram&;
+
+  // Assigns the shader storage block 'name' to the GLBufferBindPoint
+  //   of the ShaderStorageType with the given 'index' (blocks which
+  //   were optimized out are ignored)
+  //  - Requires ARB_shader_storage_buffer_object, the binding is
+  //    a part of the program's state, so it only has to be set
+  //    once after link()'ing
+  auto storageBlockBinding(const char *name, unsigned index) -> GLProgram&;
+
 protected:
   auto swap(GLProgram& other) -> GLProgram&;
 
@@ -234,18 +255,13 @@ private:
   auto uniformLocationType(const char *name, UniformType type) -> UniformLocationType;
 
   // Usage:
-  //   has_dsa: always ARB::direct_state_access || EXT::direct_state_access
-  //   fn_dsa:  pointer to direct state acces version of the upload function
-  //      i.e. glProgramUniform*
-  //   fn_non_dsa: pointer to NON dsa version of the function i.e. glUniform*
-  //   location:   can be obtained from uniformLocationType()
-  //   args:       the value(s) to be uploaded
+  //   fn:       one of the GLDispatch::programUniform* function
+  //     pointers (which use the program if that's required)
+  //   location: can be obtained from uniformLocationType()
+  //   args:     the value(s) to be uploaded
   //
-  template <typename FnDSA, typename FnNonDSA, typename... Args>
-  auto uploadUniform(
-      bool has_dsa, FnDSA fn_dsa, FnNonDSA fn_non_dsa,
-      UniformLocation location, Args&&... args
-    ) -> GLProgram&
+  template <typename Fn, typename... Args>
+  auto uploadUniform(Fn fn, UniformLocation location, Args&&... args) -> GLProgram&
   {
     assert(id_ != GLNullId);
     assert(linked_ &&
@@ -255,14 +271,7 @@ private:
     //   uniforms which were optimized out (unused)
     if(location == InvalidLocation) return *this;
 
-    // Use direct state access if it's available...
-    if(has_dsa) {
-      fn_dsa(id_, location, args...);
-    } else {     // ...and fall back to the old path otherwise
-      use();
-
-      fn_non_dsa(location, args...);
-    }
+    fn(id_, location, args...);
 
     return *this;
   }
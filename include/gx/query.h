@@ -0,0 +1,81 @@
+#pragma once
+
+#include <gx/gx.h>
+#include <gx/object.h>
+
+#include <exception>
+#include <stdexcept>
+
+namespace brdrive {
+
+class GLQuery : public GLObject {
+public:
+  enum Type {
+    TypeInvalid,
+
+    Timestamp,          // GL_TIMESTAMP, used via timestamp()
+    TimeElapsed,        // GL_TIME_ELAPSED
+    SamplesPassed,      // GL_SAMPLES_PASSED
+    AnySamplesPassed,   // GL_ANY_SAMPLES_PASSED
+    PrimitivesGenerated,// GL_PRIMITIVES_GENERATED
+  };
+
+  struct InvalidQueryTypeError : public std::runtime_error {
+    InvalidQueryTypeError() :
+      std::runtime_error("the requested operation isn't valid for this GLQuery's type!"
+          " (timestamp() requires a Timestamp query, begin()/end() require any other type)")
+    { }
+  };
+
+  struct NoResultError : public std::runtime_error {
+    NoResultError() :
+      std::runtime_error("attempted to get the result of a GLQuery which was never issued!")
+    { }
+  };
+
+  GLQuery(Type type);
+  GLQuery(GLQuery&& other);
+  virtual ~GLQuery();
+
+  auto operator=(GLQuery&& other) -> GLQuery&;
+
+  // Records the GPU's time (in nanoseconds) after all the
+  //   previously issued commands have been executed
+  //  - Only valid for Timestamp queries
+  auto timestamp() -> GLQuery&;
+
+  // Starts and stops the query, only valid for
+  //   types other than Timestamp
+  auto begin() -> GLQuery&;
+  auto end() -> GLQuery&;
+
+  // Returns 'true' when result() can be called without
+  //   stalling the CPU (i.e. it never blocks)
+  auto resultAvailable() -> bool;
+
+  // Blocks until the result is available and returns it, for
+  //   Timestamp/TimeElapsed queries it's expressed in nanoseconds
+  auto result() -> u64;
+
+  // Returns 'true' if the query was issued at least once
+  //   (via timestamp() or begin()/end())
+  auto issued() const -> bool;
+
+  auto type() const -> Type;
+
+protected:
+  auto swap(GLQuery& other) -> GLQuery&;
+
+  virtual auto doDestroy() -> GLObject& final;
+
+private:
+  // Lazily creates the OpenGL query object
+  void initGLObject();
+
+  Type type_;
+  GLEnum target_;
+
+  bool issued_;
+};
+
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <gx/gx.h>
+
+#include <array>
+
+namespace brdrive {
+
+// Forward declaration
+class GLContext;
+
+// Shadows the binding state of a GLContext - the VAO, the buffers
+//   bound to each of the non-indexed targets, the framebuffers,
+//   the active texture unit and the program - so the bind*()
+//   methods only call OpenGL when the binding actually changes
+//  - Every GLContext owns one, which can be accessed through
+//    GLContext::state() or, for the current context, via
+//    GLStateTracker::current()
+//  - GL_ELEMENT_ARRAY_BUFFER is a part of the VAO's state, so
+//    it's binding becomes unknown (and the next bindBuffer() is
+//    never elided) every time the VAO changes
+//  - OpenGL reverts the bindings of deleted objects to 0 (and
+//    their names can be reused), so the forget*() methods MUST
+//    be called when they're deleted
+//  - The state must also be invalidate()'d after binding objects
+//    without going through the GLStateTracker
+class GLStateTracker {
+public:
+  // Indices of the non-indexed buffer targets
+  enum BufferTarget : unsigned {
+    ArrayBuffer, ElementArrayBuffer,
+    CopyReadBuffer, CopyWriteBuffer,
+    PixelPackBuffer, PixelUnpackBuffer,
+    DrawIndirectBuffer, DispatchIndirectBuffer,
+    TextureBuffer, UniformBuffer, ShaderStorageBuffer,
+    AtomicCounterBuffer, QueryBuffer, TransformFeedbackBuffer,
+
+    NumBufferTargets,
+    BufferTargetInvalid = NumBufferTargets,
+  };
+
+  struct Stats {
+    u64 num_binds;     // Number of glBind*()/glUseProgram()/glActiveTexture() calls made
+    u64 num_elided;    // Number of the calls which were skipped
+  };
+
+  GLStateTracker();
+  GLStateTracker(const GLStateTracker&) = delete;
+
+  // Returns the GLStateTracker of GLContext::current()
+  static auto current() -> GLStateTracker&;
+
+  auto bindVertexArray(GLId array) -> GLStateTracker&;
+
+  // - 'target' can be any of the non-indexed GL_*_BUFFER targets
+  auto bindBuffer(GLEnum target, GLId buffer) -> GLStateTracker&;
+  // Must be called after glBindBuffer{Base,Range}(), which
+  //   also change the generic binding of the 'target'
+  auto boundBufferIndexed(GLEnum target, GLId buffer) -> GLStateTracker&;
+
+  // - 'target' is one of GL_FRAMEBUFFER (which binds both
+  //   the draw and read framebuffer), GL_DRAW_FRAMEBUFFER
+  //   or GL_READ_FRAMEBUFFER
+  auto bindFramebuffer(GLEnum target, GLId framebuffer) -> GLStateTracker&;
+
+  auto activeTexture(unsigned slot) -> GLStateTracker&;
+
+  auto useProgram(GLId program) -> GLStateTracker&;
+
+  auto vertexArray() const -> GLId;
+  auto buffer(GLEnum target) const -> GLId;
+  auto drawFramebuffer() const -> GLId;
+  auto readFramebuffer() const -> GLId;
+  auto activeTextureSlot() const -> unsigned;
+  auto program() const -> GLId;
+
+  auto forgetVertexArray(GLId array) -> GLStateTracker&;
+  auto forgetBuffer(GLId buffer) -> GLStateTracker&;
+  auto forgetFramebuffer(GLId framebuffer) -> GLStateTracker&;
+  auto forgetProgram(GLId program) -> GLStateTracker&;
+
+  // Marks all the bindings as unknown, so the
+  //   next bind*() of each never gets elided
+  auto invalidate() -> GLStateTracker&;
+
+  auto stats() const -> Stats;
+
+private:
+  enum : GLId {
+    // Binding which never matches a real object
+    Unknown = ~0u,
+  };
+
+  // Returns 'true' (and increments Stats::num_elided) when 'bound' == 'id',
+  //   otherwise sets 'bound' to 'id' and increments Stats::num_binds
+  auto elide(GLId& bound, GLId id) -> bool;
+
+  GLId vertex_array_;
+  std::array<GLId, NumBufferTargets> buffers_;
+  GLId draw_framebuffer_, read_framebuffer_;
+  unsigned active_texture_;
+  GLId program_;
+
+  Stats stats_;
+};
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <gx/gx.h>
+#include <gx/fence.h>
+
+#include <deque>
+#include <vector>
+#include <functional>
+#include <utility>
+
+namespace brdrive {
+
+// Tracks the GPU's progress in units of whole frames by
+//   inserting a single fence at the end of every frame
+//  - Frames are numbered starting at 1, the frame whose
+//    commands are currently being issued is currentFrame(),
+//    completedFrame() == 0 means no frame has completed yet
+//  - endFrame() blocks only when more than maxFramesInFlight()
+//    frames would be left in flight after it returns
+//  - Resources which the GPU could still be using (ex. regions
+//    of streaming buffers or objects pending deletion) can
+//    be tagged with the currentFrame() and reused/destroyed
+//    once frameCompleted() returns 'true' for that frame,
+//    or their cleanup can be defer()'red
+//  - All the methods must be called on the thread which
+//    owns the GLContext
+class GLFrameTimeline {
+public:
+  using FrameIndex = u64;
+  using DeferredFn = std::function<void()>;
+
+  enum : FrameIndex {
+    NoFrame = 0,
+  };
+
+  GLFrameTimeline(unsigned max_frames_in_flight = 2);
+  GLFrameTimeline(const GLFrameTimeline&) = delete;
+
+  // Fences the current frame and starts the next one, first
+  //   blocking until at most maxFramesInFlight()-1 of the
+  //   previous frames remain in flight (so the new frame
+  //   brings the count up to maxFramesInFlight())
+  //  - Returns the index of the new current frame
+  auto endFrame() -> FrameIndex;
+
+  auto currentFrame() const -> FrameIndex;
+
+  // Polls the fences of the frames in flight and returns
+  //   the index of the newest completed frame
+  auto completedFrame() -> FrameIndex;
+
+  // Returns 'true' when all of the GPU commands issued
+  //   during 'frame' have finished executing
+  auto frameCompleted(FrameIndex frame) -> bool;
+
+  // Blocks until 'frame' has completed
+  //   - 'frame' can't be the currentFrame() as it
+  //     doesn't have a fence yet
+  auto waitFrame(FrameIndex frame, u64 timeout = GLFence::TimeoutInfinite) -> GLFence::WaitStatus;
+
+  // Calls 'fn' once the currentFrame() has completed (during
+  //   one of the subsequent endFrame()/completedFrame() calls)
+  auto defer(DeferredFn fn) -> GLFrameTimeline&;
+
+  // Blocks until every frame which has been ended completes,
+  //   running all the deferred functions for those frames
+  auto drain() -> GLFrameTimeline&;
+
+  auto framesInFlight() const -> unsigned;
+  auto maxFramesInFlight() const -> unsigned;
+
+private:
+  struct FrameInFlight {
+    FrameIndex frame;
+    GLFence *fence;
+  };
+
+  // Retires all the frames up to and including 'frame',
+  //   returning their fences to the pool
+  void retireFrames(FrameIndex frame);
+
+  void runDeferred();
+
+  unsigned max_frames_in_flight_;
+
+  FrameIndex current_frame_;
+  FrameIndex completed_frame_;
+
+  GLFencePool fence_pool_;
+
+  // Ordered from the oldest to the newest frame
+  std::deque<FrameInFlight> in_flight_;
+
+  // Ordered by the frame index
+  std::deque<std::pair<FrameIndex, DeferredFn>> deferred_;
+};
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <gx/gx.h>
+#include <gx/fence.h>
+
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace brdrive {
+
+// Forward declarations
+class GLContext;
+class IEventLoop;
+
+// Waits on GLFences on a helper thread and reports their completion
+//   by post()'ing a UserEvent to an IEventLoop, so the main thread
+//   can keep sleeping in IEventLoop::event(IEventLoop::Block) and
+//   still react as soon as the GPU is done
+//  - The helper thread makes the 'context' passed to the constructor
+//    current, so it must've been acquire()'d with the main context
+//    as 'share' (and without a window) and must not be current on
+//    any other thread
+//  - The fences are waited on in the order of the wait() calls,
+//    which is also the order in which the GPU signals them
+class GLFenceWaiter {
+public:
+  enum : u64 {
+    // block() on the fences for at most this many nanoseconds
+    //   at a time, so the destructor doesn't have to wait on
+    //   the GPU for too long
+    WaitSliceNs = 1'000'000,
+  };
+
+  // - The UserEvents will have UserEvent::code() == 'event_code'
+  GLFenceWaiter(IEventLoop& event_loop, GLContext& context, u32 event_code);
+  GLFenceWaiter(const GLFenceWaiter&) = delete;
+  ~GLFenceWaiter();
+
+  // Takes ownership of the 'fence' and post()'s a UserEvent with
+  //   UserEvent::data() == 'data' once it gets signaled
+  //  - Must be called on the thread which created the fence
+  //    (it has to be flushed before another context can wait
+  //    on it)
+  auto wait(GLFence&& fence, uptr data = 0) -> GLFenceWaiter&;
+
+  // Returns the number of fences which are yet to be signaled
+  auto numPending() const -> unsigned;
+
+private:
+  struct Pending {
+    GLFence fence;
+    uptr data;
+  };
+
+  void workerMain();
+
+  IEventLoop& event_loop_;
+  GLContext& context_;
+  u32 event_code_;
+
+  std::thread worker_;
+
+  std::mutex mutex_;
+  std::condition_variable pending_available_;
+
+  std::deque<Pending> pending_;     // Protected by 'mutex_'
+
+  std::atomic<unsigned> num_pending_;
+  std::atomic<bool> quit_;
+};
+
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <osd/osd.h>
+#include <osd/drawcall.h>
+
+#include <gx/gx.h>
+
+#include <array>
+#include <vector>
+#include <utility>
+#include <type_traits>
+
+namespace brdrive {
+
+// Forward declarations
+class GLContext;
+class GLProgram;
+class GLTexture;
+class GLSampler;
+class GLVertexArray;
+class GLIndexBuffer;
+class GLDrawIndirectBuffer;
+class GLShaderStorageBuffer;
+class GLFence;
+
+// A flat list of POD commands (program/texture/buffer/vertex array binds,
+//   uniform uploads by location and draws) recorded once from
+//   OSDDrawCalls and replayed any number of times afterwards
+//  - Redundant binds are dropped while recording (a bind which
+//    matches the state set by the previously recorded commands
+//    doesn't produce a new command) and all the uniform names
+//    are resolved to locations during the first replay(), so
+//    subsequent replays do no lookups
+//  - Each record() returns a DrawHandle through which the draw's
+//    dynamic parameters (offsets, counts) can be patch()'ed in
+//    place, without re-recording any of the commands
+//  - Like OSDDrawCall - any pointers stored in the commands will
+//    NOT be freed by the command buffer and must stay valid for
+//    as long as the commands referencing them can be replay()'ed
+class OSDCommandBuffer {
+public:
+  enum Opcode : u32 {
+    OpInvalid,
+
+    OpUseProgram,       // 'program'
+    OpBindTexture,      // 'texture', Command::arg is the tex image unit
+    OpBindStorageBuffer,  // 'storage_buffer', Command::arg is the ShaderStorageType bind point's index
+    OpUniformInt,       // 'uniform', Command::arg is the uniform's location (or UnresolvedLocation)
+    OpBindVertexArray,  // 'vertex_array'
+    OpDraw,             // 'draw', Command::arg is the OSDDrawCall::DrawCommandType
+  };
+
+  enum : u32 {
+    // Uniform locations are resolved by the first replay()
+    //   (see the comment above record())
+    UnresolvedLocation = ~0u,
+  };
+
+  struct Command {
+    Opcode op;
+    u32 arg;
+
+    union {
+      GLProgram *program;
+
+      struct {
+        GLTexture *tex;
+        GLSampler *sampler;   // Can be nullptr
+      } texture;
+
+      GLShaderStorageBuffer *storage_buffer;
+
+      struct {
+        GLProgram *program;
+        const char *name;     // Must have static storage duration
+        int type;             // GLProgram::UniformType
+        int value;
+      } uniform;
+
+      struct {
+        GLVertexArray *verts;
+        GLIndexBuffer *inds;  // Can be nullptr
+      } vertex_array;
+
+      struct {
+        GLDrawIndirectBuffer *indirect;   // Only for OSDDrawCall::MultiDrawArrayIndirect
+
+        GLSizePtr offset;
+        GLType inds_type;
+        GLSize count;
+        GLSize base_instance;   // Only for OSDDrawCall::DrawArrayInstancedBaseInstance
+        GLSize instance_count;
+        GLSize draw_count;
+      } draw;
+    };
+  };
+  static_assert(std::is_trivially_copyable_v<Command>,
+      "OSDCommandBuffer::Command must be a POD!");
+
+  // Indices of the commands in the buffer which
+  //   depend on the draw's dynamic parameters
+  struct DrawHandle {
+    enum : u32 {
+      None = ~0u,
+    };
+
+    u32 draw;
+
+    // The OpUniformInt which uploads OSDDrawCall::base_instance
+    //   (for OSDDrawCall::DrawString and the other draw types
+    //   which use uiStringAttributesBaseOffset), otherwise == None
+    u32 base_instance;
+  };
+
+  OSDCommandBuffer();
+  OSDCommandBuffer(const OSDCommandBuffer&) = delete;
+
+  // Appends the commands needed to submit 'drawcall' i.e. produces
+  //   the same result as osd_submit_drawcall(), when replay()'ed
+  //  - Doesn't make any GL calls, so it can be called on threads
+  //    other than the one which owns the GLContext (as long as a
+  //    given OSDCommandBuffer is used by one thread at a time)
+  auto record(const OSDDrawCall& drawcall) -> DrawHandle;
+
+  // Updates the offset, count, base_instance, instance_count
+  //   and draw_count of a previously recorded draw to the values
+  //   from 'drawcall' (all of it's other state MUST be the same
+  //   as the one of the OSDDrawCall which was record()'ed)
+  auto patch(DrawHandle handle, const OSDDrawCall& drawcall) -> OSDCommandBuffer&;
+
+  // Executes all the recorded commands in order
+  //   and returns a primed fence (like osd_submit_drawcall())
+  //  - Can only be called on the thread which owns the GLContext
+  auto replay(GLContext& gl_context) -> GLFence;
+
+  // Same as replay() above, except no fence is created, which
+  //   allows replaying several buffers back-to-back and fencing
+  //   only after the last one
+  auto replayNoFence(GLContext& gl_context) -> OSDCommandBuffer&;
+
+  // Removes all the recorded commands (which invalidates
+  //   all the DrawHandles) and bumps the generation()
+  auto clear() -> OSDCommandBuffer&;
+
+  auto empty() const -> bool;
+
+  // Returns the number of recorded commands
+  auto size() const -> size_t;
+  auto numDraws() const -> size_t;
+
+  // Incremented on every clear(), which allows the code which
+  //   holds DrawHandles to check if they're still valid
+  auto generation() const -> u32;
+
+private:
+  // State set by the previously recorded commands
+  struct RecordState {
+    GLProgram *program;
+
+    std::array<OSDDrawCall::TextureAndSampler, GLNumTexImageUnits> textures;
+    OSDDrawCall::StorageBufferBindings storage_buffers;
+
+    GLVertexArray *verts;
+    GLIndexBuffer *inds;
+
+    // Sampler uniforms are a part of the program's state,
+    //   so they only need to be uploaded once per recording
+    std::vector<std::pair<GLProgram *, const char * /* name */>> sampler_uniforms;
+  };
+
+  auto append(const Command& command) -> u32;
+
+  void resetRecordState();
+
+  std::vector<Command> commands_;
+  size_t num_draws_;
+
+  u32 generation_;
+
+  RecordState record_state_;
+};
+
+}
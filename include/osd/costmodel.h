@@ -0,0 +1,61 @@
+#pragma once
+
+#include <osd/osd.h>
+
+#include <vector>
+
+namespace brdrive {
+
+// Estimates the GPU time of drawing a bucket of strings with
+//   a single instanced draw, where every instance runs
+//   <length of the bucket's longest string>*4 vertex shader
+//   invocations (the glyphs past the end of the shorter strings
+//   get culled, so their invocations are wasted), i.e.
+//       cost = draw_ns + vertex_ns * 4*max_length*count
+//  - OSDSurface chooses the bucket boundaries which minimize the
+//    total cost i.e. it trades off more draws for fewer culled
+//    glyphs and vice versa
+//  - Drawing one instance per glyph instead (in a single draw)
+//    wastes no invocations on culled glyphs, but every one of
+//    them does an extra fetch, i.e.
+//       cost = draw_ns + glyph_vertex_ns * 4*num_glyphs
+//    and OSDSurface picks whichever of the two is cheaper
+//  - The defaults are rough guesses, OSDSurface::calibrateCostModel()
+//    replaces them with values measured on the current GPU
+struct OSDStringCostModel {
+  enum : u32 {
+    VerticesPerGlyph = 4,
+  };
+
+  float draw_ns;      // Fixed cost of a single draw
+  float vertex_ns;    // Cost of a single vertex shader invocation
+
+  // Cost of a single vertex shader invocation
+  //   when drawing one instance per glyph
+  float glyph_vertex_ns;
+
+  // Incremented every time the constants change, so the
+  //   surfaces know when they need to recompute their buckets
+  u32 generation;
+
+  // Returns the OSDStringCostModel used by all the OSDSurfaces
+  static auto global() -> OSDStringCostModel&;
+
+  auto bucketCost(u32 count, u32 max_length) const -> float;
+  auto glyphsCost(u32 num_glyphs) const -> float;
+
+  // Splits the strings, given as the number of strings of each
+  //   length ('length_histogram[n]' == number of strings n
+  //   characters long) into at most 'max_buckets' buckets of
+  //   successive lengths with the lowest total bucketCost()
+  //   and returns the max length of each bucket (in ascending
+  //   order, no bucket is empty)
+  //  - Only the lengths which actually occur are considered as
+  //    boundaries, so for 'n' distinct lengths it takes O(n^2)
+  //    time - regardless of the number of strings
+  auto partition(
+      const std::vector<u32>& length_histogram, unsigned max_buckets
+    ) const -> std::vector<u32>;
+};
+
+}
@@ -22,10 +22,13 @@ class GLIndexBuffer;
 class GLBufferTexture;
 class GLPixelBuffer;
 class GLFence;
+class GLDrawIndirectBuffer;
+class GLShaderStorageBuffer;
 
 // Any pointers stored in this object
 //   will NOT be freed by it i.e. it is
 //   the responsibility of the CALLER
+//  - All the commands draw triangle strips
 struct OSDDrawCall {
   enum DrawCommandType {
     DrawInvalid,
@@ -34,6 +37,16 @@ struct OSDDrawCall {
     DrawIndexed,
     DrawArrayInstanced,
     DrawIndexedInstanced,
+
+    // Same as DrawArrayInstanced, except the per-instance vertex
+    //   attributes are fetched starting at 'base_instance'
+    //   (requires ARB_base_instance)
+    DrawArrayInstancedBaseInstance,
+
+    // Issues 'draw_count' GLDrawIndirectBuffer::DrawArraysCommands
+    //   stored in 'indirect' starting at byte 'offset' via a single
+    //   glMultiDrawArraysIndirect() call
+    MultiDrawArrayIndirect,
   };
 
   enum DrawType : int {
@@ -43,6 +56,47 @@ struct OSDDrawCall {
     DrawRectangle,
     DrawShadedQuad,
 
+    // Same as DrawString, except the per-bucket string
+    //   attributes offset is sourced from each indirect
+    //   command's 'base_instance' (gl_BaseInstanceARB)
+    //   instead of a uniform, which allows drawing all
+    //   the buckets with a single MultiDrawArrayIndirect
+    //  - Only available with ARB_multi_draw_indirect and
+    //    ARB_shader_draw_parameters (the program is
+    //    nullptr otherwise)
+    DrawStringIndirect,
+
+    // Same as DrawString, except every instance is a single
+    //   glyph instead of a whole string, so no vertices are
+    //   wasted on the glyphs past the ends of shorter strings
+    //   (see osd_drawcall_string_glyphs())
+    DrawStringGlyphs,
+
+    // Same as DrawString, except the string attributes are
+    //   per-instance vertex attributes sourced from 'verts'
+    //   (instead of a texture buffer), the bucket's offset
+    //   is the draw's 'base_instance'
+    //  - Drawn with either DrawArrayInstancedBaseInstance
+    //    or MultiDrawArrayIndirect commands (see
+    //    osd_drawcall_strings_instanced())
+    //  - Only available with ARB_base_instance (the
+    //    program is nullptr otherwise), the indirect
+    //    commands additionally need ARB_multi_draw_indirect
+    DrawStringInstanced,
+
+    // Same as DrawString, DrawStringIndirect and DrawStringGlyphs
+    //   respectively, except the characters, attributes and
+    //   glyphs are read from the 'storage_buffers' (instead of
+    //   texture buffers, see osd_drawcall_strings_storage()
+    //   and osd_drawcall_string_glyphs_storage())
+    //  - Only available with ARB_shader_storage_buffer_object
+    //    (DrawStringStorageIndirect additionally requires the
+    //    same extensions as DrawStringIndirect), the programs
+    //    are nullptr otherwise
+    DrawStringStorage,
+    DrawStringStorageIndirect,
+    DrawStringStorageGlyphs,
+
     NumDrawTypes,
   };
 
@@ -61,6 +115,10 @@ struct OSDDrawCall {
   GLSize base_instance;
   GLSize instance_count;
 
+  // Used only by MultiDrawArrayIndirect commands
+  GLDrawIndirectBuffer *indirect;
+  GLSize draw_count;
+
   using TextureAndSampler = std::tuple<GLTexture *, GLSampler *>;
   using TextureBindings = std::array<TextureAndSampler, GLNumTexImageUnits>;
 
@@ -68,54 +126,173 @@ struct OSDDrawCall {
   // 1 past the offset after which no more entries are present in 'textures'
   size_t textures_end;
 
+  // Bound to the GLBufferBindPoints of the ShaderStorageType
+  //   with the same indices as the entries' (empty slots
+  //   are nullptr)
+  using StorageBufferBindings = std::array<GLShaderStorageBuffer *, GLNumBufferBindPoints>;
+
+  StorageBufferBindings storage_buffers;
+  // Same as 'textures_end', for 'storage_buffers'
+  size_t storage_buffers_end;
+
 /*
 semi-private:
 */
   class SubmitFriendKey {
     SubmitFriendKey() { }
 
-    friend auto osd_submit_drawcall(
+    friend auto osd_submit_drawcall_no_fence(
         GLContext& gl_context, const OSDDrawCall& drawcall
-      ) -> GLFence;
+      ) -> void;
   };
 
-  auto submit(SubmitFriendKey, GLContext& gl_context) const -> GLFence;
+  // Doesn't insert any fences, see osd_submit_drawcall()
+  auto submit(SubmitFriendKey, GLContext& gl_context) const -> void;
 };
 
-// - 'verts_' should contain an ivec4 attribute at location 0, where:
-//        attr.xy is this string's position relative to the top-left corner
-//          expressed in screen pixels
-//        attr.z is the 0-based offset at which this string's data starts
-//          in the 'strings_' texture buffer
-//        attr.w is the length of the string expressed in characters
-// - The index Buffer MUST contain 5 vertices per glyph formed in this fasion:
-//       n+0, n+1, n+2, n+3, 0xFFFF, n+4, n+5, n+6, n+7, 0xFFFF...
+// - No index buffer is needed - the glyphs' quads are generated from
+//   gl_VertexID alone, as a triangle strip with 4 vertices per glyph
+//   (see s_osd_vs_src), so 'verts_' can be an empty vertex array
 // - The max_string_len_ must be the maximum length of all the strings residing
 //   in the strings_ texture buffer, given in number of characters
 // - The 'font_sampler_' is optional and can be set to 'nullptr'
+// - 'strings_' must be an rgba8ui texture buffer (with four characters
+//   per texel) and 'attrs_' an rgba32ui one, with one texel - an
+//   osd_detail::StringAttributes (see osd/layout.h) - per string,
+//   'base_offset' is the index of the first string's attributes
 // - 'strings_' should contain successive characters of tightly packed strings ex.
 //       auto string1 = "hello";
 //       auto string2 = "John Doe!";
 //
 //       strings_  =>  "helloJohn Doe!"
-//   * Example 'verts_' buffer data which fits the above 'strings_' buffer
-//       i16[] = {
+//   * Example 'attrs_' buffer data which fits the above 'strings_' buffer
+//       osd_detail::StringAttributes[] = {
 //         // instance[0]  =>  string1
-//         20 /* screen_x */, 10 /* screen_y */, 0 /* offset */, sizeof(string1)-1, /* size */
+//         { 20 /* x */, 10 /* y */, 0 /* offset */, sizeof(string1)-1 /* length */, 0xFFFFFFFF /* color */ },
 //
 //         // instance[1]  =>  string2
-//         20, 100, sizeof(string1) /* comes right after string1 */, sizeof(string2)-1,
+//         { 20, 100, sizeof(string1) /* comes right after string1 */, sizeof(string2)-1, 0xFF0000FF },
 //       };
 auto osd_drawcall_strings(
-    GLVertexArray *verts_, GLType inds_type_, GLIndexBuffer *inds_, GLSizePtr base_offset,
+    GLVertexArray *verts_, GLSizePtr base_offset,
     GLSize max_string_len_, GLSize num_strings_,
     GLTexture2D *font_tex_, GLSampler *font_sampler_, GLTextureBuffer *strings_, GLTextureBuffer *attrs_
   ) -> OSDDrawCall;
 
+// Multi-draw indirect variant of osd_drawcall_strings()
+//   - 'indirect_' must contain 'num_buckets_' tightly packed
+//     GLDrawIndirectBuffer::DrawArraysCommands starting at
+//     'indirect_offset', one per bucket of strings, where:
+//        count          = <max string length in the bucket> * 4
+//        instance_count = <number of strings in the bucket>
+//        first          = 0
+//        base_instance  = <offset of the bucket's first string's
+//                          attributes in 'attrs_'> (in texels)
+//   - The rest of the parameters have the same meaning as the
+//     ones of osd_drawcall_strings()
+auto osd_drawcall_strings_indirect(
+    GLVertexArray *verts_,
+    GLDrawIndirectBuffer *indirect_, GLSizePtr indirect_offset, GLSize num_buckets_,
+    GLTexture2D *font_tex_, GLSampler *font_sampler_, GLTextureBuffer *strings_, GLTextureBuffer *attrs_
+  ) -> OSDDrawCall;
+
+// Per-glyph variant of osd_drawcall_strings(), which draws
+//   'num_glyphs_' instances - one per character of 'strings_'
+//   (starting from the first one) - with a single quad each
+//   - 'glyphs_' must be an rgba16ui texture buffer with the
+//     index of the attributes (in 'attrs_') of the string each
+//     character belongs to, packed four per texel, characters
+//     which don't belong to any string must be marked with
+//     osd_detail::NoGlyphString (see osd/layout.h)
+//   - The rest of the parameters have the same meaning as the
+//     ones of osd_drawcall_strings()
+auto osd_drawcall_string_glyphs(
+    GLVertexArray *verts_, GLSize num_glyphs_,
+    GLTexture2D *font_tex_, GLSampler *font_sampler_,
+    GLTextureBuffer *strings_, GLTextureBuffer *attrs_, GLTextureBuffer *glyphs_
+  ) -> OSDDrawCall;
+
+// Variant of osd_drawcall_strings() (and, when 'indirect_' isn't
+//   nullptr, of osd_drawcall_strings_indirect()) which sources
+//   the strings' attributes from per-instance vertex attributes
+//   - 'verts_' must have a single uvec4 per-instance attribute at
+//     location 0 - an osd_detail::StringAttributes - per string
+//   - 'base_instance' is the index of the first string's attributes,
+//     ignored for indirect draws (where the commands' base_instance
+//     is used instead)
+//   - The rest of the parameters have the same meaning as the
+//     ones of osd_drawcall_strings()/osd_drawcall_strings_indirect()
+auto osd_drawcall_strings_instanced(
+    GLVertexArray *verts_, GLSize base_instance,
+    GLSize max_string_len_, GLSize num_strings_,
+    GLDrawIndirectBuffer *indirect_, GLSizePtr indirect_offset, GLSize num_buckets_,
+    GLTexture2D *font_tex_, GLSampler *font_sampler_, GLTextureBuffer *strings_
+  ) -> OSDDrawCall;
+
+// Variant of osd_drawcall_strings() (and, when 'indirect_' isn't
+//   nullptr, of osd_drawcall_strings_indirect()) which reads the
+//   strings from shader storage buffers
+//   - 'strings_' and 'attrs_' must contain the same data as the
+//     texture buffers passed to osd_drawcall_strings() would
+//     (i.e. four characters per u32 and an array of
+//     osd_detail::StringAttributes), they get bound to the
+//     osd_detail::String<Characters,Attributes>StorageBinding
+//   - The rest of the parameters have the same meaning as the
+//     ones of osd_drawcall_strings()/osd_drawcall_strings_indirect()
+auto osd_drawcall_strings_storage(
+    GLVertexArray *verts_, GLSizePtr base_offset,
+    GLSize max_string_len_, GLSize num_strings_,
+    GLDrawIndirectBuffer *indirect_, GLSizePtr indirect_offset, GLSize num_buckets_,
+    GLTexture2D *font_tex_, GLSampler *font_sampler_,
+    GLShaderStorageBuffer *strings_, GLShaderStorageBuffer *attrs_
+  ) -> OSDDrawCall;
+
+// Shader storage buffer variant of osd_drawcall_string_glyphs()
+//   - 'glyphs_' must contain an array of u16 (two per u32) with
+//     the same meaning as the texels of osd_drawcall_string_glyphs()'
+//     'glyphs_', it gets bound to osd_detail::StringGlyphsStorageBinding
+//   - The rest of the parameters have the same meaning as the
+//     ones of osd_drawcall_strings_storage()
+auto osd_drawcall_string_glyphs_storage(
+    GLVertexArray *verts_, GLSize num_glyphs_,
+    GLTexture2D *font_tex_, GLSampler *font_sampler_,
+    GLShaderStorageBuffer *strings_, GLShaderStorageBuffer *attrs_, GLShaderStorageBuffer *glyphs_
+  ) -> OSDDrawCall;
+
+namespace osd_detail {
+
+// Issues the GL draw call described by the parameters (which
+//   have the same meaning as the OSDDrawCall members)
+//  - All the required state (program, textures, vertex array,
+//    index and indirect buffers) MUST already be set up
+void issue_draw(
+    int /* OSDDrawCall::DrawCommandType */ command, GLType inds_type,
+    GLSizePtr offset, GLSize count, GLSize base_instance, GLSize instance_count, GLSize draw_count
+  );
+
+// Returns the name of the sampler uniform which the texture
+//   bound to 'slot' of an OSDDrawCall of type 'draw_type'
+//   is accessed through in OSDSurface::renderProgram(draw_type)
+auto texture_uniform_name(int /* OSDDrawCall::DrawType */ draw_type, unsigned slot) -> const char *;
+
+}
+
 // Sets up the proper state and calls glDraw<Arrays,Elements>[Instanced]()
+//   (or glMultiDrawArraysIndirect())
 //   according to the provided 'drawcall'
+//  - Returns a primed fence, which creates (and, once it's
+//    destroyed, deletes) a GL sync object for every draw -
+//    when submitting more than one draw call prefer
+//    osd_submit_drawcall_no_fence() and fencing the batch
+//    once (see OSDRenderQueue::flushFenced())
 auto osd_submit_drawcall(
     GLContext& gl_context,  const OSDDrawCall& drawcall
   ) -> GLFence;
 
+// Same as osd_submit_drawcall() above, except no fence is created
+//   (analogous to OSDCommandBuffer::replayNoFence())
+auto osd_submit_drawcall_no_fence(
+    GLContext& gl_context,  const OSDDrawCall& drawcall
+  ) -> void;
+
 }
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <osd/osd.h>
+
+#include <cstddef>
+
+namespace brdrive::osd_detail {
+
+// Layout of a single string's attributes in the OSDSurface's
+//   attributes buffers, each string takes up exactly ONE rgba32ui
+//   texel - OSDSurface memcpy()'s these into the buffer and the
+//   DrawString vertex shader unpacks them with the GLSL below
+//  - Both are defined here, so any change to one of them has
+//    to go along with the other (the static_asserts catch
+//    changes to the C++ side)
+struct StringAttributes {
+  u16 x, y;         // Position in pixels relative to the top-left corner
+  u32 offset;       // Offset of the string's first character in the strings buffer
+  u32 length;       // In characters
+  u32 color;        // Packed RGBA8 (with R in the lowest byte)
+};
+static_assert(sizeof(StringAttributes) == 4*sizeof(u32),
+    "StringAttributes must fill exactly one rgba32ui texel!");
+static_assert(offsetof(StringAttributes, x) == 0 && offsetof(StringAttributes, y) == 2,
+    "StringAttributes.x/y must be packed into the texel's .x component!");
+static_assert(offsetof(StringAttributes, offset) == 4 && offsetof(StringAttributes, length) == 8,
+    "StringAttributes.offset/length must be the texel's .y/.z components!");
+static_assert(offsetof(StringAttributes, color) == 12,
+    "StringAttributes.color must be the texel's .w component!");
+
+// The characters are packed four per rgba8ui texel i.e. character
+//   'n' of the strings buffer is component (n & 3) of texel (n >> 2)
+enum : u32 {
+  StringCharactersPerTexel = 4,
+};
+
+// When a page of strings is drawn with one instance per glyph
+//   (see OSDSurface::StringDrawPerGlyph) each character of the
+//   strings buffer is an instance, the string it belongs to is
+//   looked up in a parallel buffer of u16 attributes indices
+//   (packed four per rgba16ui texel, like the characters)
+//  - Characters which don't belong to any string (the unused
+//    parts of the strings buffer) are marked with NoGlyphString
+enum : u16 {
+  NoGlyphString = 0xFFFF,
+};
+
+enum : u32 {
+  StringGlyphsPerTexel = 4,
+};
+
+// When the strings are read from shader storage buffers (see
+//   OSDSurface::StringAttributesStorageBuffer) the buffers hold
+//   the exact same data as the texture buffers - the characters
+//   (four per uint), an array of PackedStringAttributes (which
+//   has the std430 layout of a StringAttributes) and the glyphs'
+//   strings (two per uint) - bound to these GLBufferBindPoints
+//   of the ShaderStorageType
+enum : unsigned {
+  StringCharactersStorageBinding = 0,
+  StringAttributesStorageBinding = 1,
+  StringGlyphsStorageBinding     = 2,
+
+  NumStringStorageBindings,
+};
+
+// Defines:
+//   - struct StringAttributes { vec2 position; int offset, length; vec3 color; }
+//   - struct PackedStringAttributes { uint position, offset, length, color; }
+//   - StringAttributes UnpackStringAttributes(uvec4 packed)
+//   - StringAttributes UnpackStringAttributes(PackedStringAttributes packed)
+//   - int FetchCharacter(usamplerBuffer strings, int character_num)
+//   - int FetchGlyphString(usamplerBuffer glyphs, int character_num)
+//   - int UnpackCharacter(uint characters, int character_num)
+//   - int UnpackGlyphString(uint glyphs, int character_num)
+inline constexpr const char *s_string_attributes_glsl = R"GLSL(
+struct StringAttributes {
+  vec2 position;
+  int offset, length;
+
+  vec3 color;
+};
+
+StringAttributes UnpackStringAttributes(uvec4 packed)
+{
+  StringAttributes attrs;
+
+  attrs.position = vec2(float(packed.x & 0xFFFFu), float(packed.x >> 16));
+  attrs.offset = int(packed.y);
+  attrs.length = int(packed.z);
+
+  attrs.color = vec3((uvec3(packed.w) >> uvec3(0u, 8u, 16u)) & 0xFFu) * (1.0f/255.0f);
+
+  return attrs;
+}
+
+// A StringAttributes as it's laid out in a std430 buffer block
+struct PackedStringAttributes {
+  uint position;
+  uint offset;
+  uint length;
+  uint color;
+};
+
+StringAttributes UnpackStringAttributes(PackedStringAttributes packed)
+{
+  return UnpackStringAttributes(uvec4(packed.position, packed.offset, packed.length, packed.color));
+}
+
+int FetchCharacter(usamplerBuffer strings, int character_num)
+{
+  uvec4 texel = texelFetch(strings, character_num >> 2);
+
+  return int(texel[character_num & 3]);
+}
+
+const int NoGlyphString = 0xFFFF;
+
+int FetchGlyphString(usamplerBuffer glyphs, int character_num)
+{
+  uvec4 texel = texelFetch(glyphs, character_num >> 2);
+
+  return int(texel[character_num & 3]);
+}
+
+// 'characters' is the uint of a storage buffer which
+//   contains the character, i.e. element (character_num >> 2)
+int UnpackCharacter(uint characters, int character_num)
+{
+  return int((characters >> uint((character_num & 3) * 8)) & 0xFFu);
+}
+
+// 'glyphs' is element (character_num >> 1) of the storage buffer
+int UnpackGlyphString(uint glyphs, int character_num)
+{
+  return int((glyphs >> uint((character_num & 1) * 16)) & 0xFFFFu);
+}
+)GLSL";
+
+}
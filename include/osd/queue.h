@@ -0,0 +1,127 @@
+#pragma once
+
+#include <osd/osd.h>
+#include <osd/drawcall.h>
+
+#include <gx/gx.h>
+
+#include <exception>
+#include <stdexcept>
+#include <vector>
+
+namespace brdrive {
+
+// Forward declarations
+class GLContext;
+class GLPipeline;
+class GLFence;
+
+// Collects OSDDrawCalls for a whole frame and submits them in an
+//   order which minimizes the number of state changes
+//  - Every draw call gets a packed 64-bit sort key:
+//      MSB                                                 LSB
+//      [ pipeline:8 | program:10 | textures:12 | vao:10 | depth:24 ]
+//    where each of the state fields is a dense id assigned (in order
+//    of first appearance) to each distinct pipeline, program, set of
+//    texture bindings and vertex array pushed since the last flush()
+//  - The keys are radix-sorted during flush(), so draw calls which
+//    share state end up next to each other, and draws with identical
+//    state are ordered by their 'depth' (ties keep the push() order)
+class OSDRenderQueue {
+public:
+  enum : u64 {
+    DepthBits    = 24,
+    VertsBits    = 10,
+    TexturesBits = 12,
+    ProgramBits  = 10,
+    PipelineBits = 8,
+
+    DepthShift    = 0,
+    VertsShift    = DepthShift + DepthBits,
+    TexturesShift = VertsShift + VertsBits,
+    ProgramShift  = TexturesShift + TexturesBits,
+    PipelineShift = ProgramShift + ProgramBits,
+
+    MaxDepth = (1ull<<DepthBits) - 1,
+  };
+
+  struct TooManyStatesError : public std::runtime_error {
+    TooManyStatesError() :
+      std::runtime_error("the number of distinct pipelines/programs/texture sets/vertex arrays"
+          " pushed to an OSDRenderQueue exceeded the number representable in the sort key!")
+    { }
+  };
+
+  // Number of state switches done by the last flush()
+  struct Stats {
+    unsigned num_drawcalls;
+
+    unsigned pipeline_switches;
+    unsigned program_switches;
+    unsigned texture_switches;
+    unsigned verts_switches;
+  };
+
+  OSDRenderQueue();
+  OSDRenderQueue(const OSDRenderQueue&) = delete;
+
+  // - 'pipeline' can be nullptr, in which case the currently
+  //   used pipeline is left as-is when submitting the draw call
+  // - 'depth' must be <= MaxDepth, draw calls which share all of
+  //   the state are submitted in ascending order of their depth
+  auto push(const OSDDrawCall& drawcall, GLPipeline *pipeline = nullptr, u32 depth = 0) -> OSDRenderQueue&;
+
+  // Convenience overload which pushes all the 'drawcalls'
+  //   with the same 'pipeline' and 'depth'
+  auto push(
+      const std::vector<OSDDrawCall>& drawcalls, GLPipeline *pipeline = nullptr, u32 depth = 0
+    ) -> OSDRenderQueue&;
+
+  // Sorts and submits all of the draw calls pushed since
+  //   the last flush() and empties the queue
+  //  - No fences are inserted in between the draw calls
+  auto flush(GLContext& gl_context) -> OSDRenderQueue&;
+
+  // Same as flush() above, except a single fence is inserted after
+  //   the last draw call and returned (primed), which is signaled
+  //   once the whole batch completes
+  auto flushFenced(GLContext& gl_context) -> GLFence;
+
+  // Discards all the pushed draw calls without submitting them
+  auto clear() -> OSDRenderQueue&;
+
+  auto empty() const -> bool;
+
+  auto stats() const -> Stats;
+
+private:
+  struct Item {
+    u64 key;
+    u32 index;
+  };
+
+  // Returns the dense id of 'value' in 'values', appending
+  //   it when it hasn't been seen before
+  template <typename T>
+  static auto denseId(std::vector<T>& values, const T& value, unsigned bits) -> u64;
+
+  // LSD radix sort of 'items_' by Item::key (stable)
+  void sortItems();
+
+  std::vector<OSDDrawCall> drawcalls_;
+  std::vector<GLPipeline *> pipelines_;  // Parallel to 'drawcalls_'
+
+  std::vector<Item> items_;
+  std::vector<Item> items_scratch_;      // Scratch memory for sortItems()
+
+  // Values of the state seen since the last flush(),
+  //   their indices are the dense ids
+  std::vector<GLPipeline *> seen_pipelines_;
+  std::vector<GLId> seen_programs_;
+  std::vector<OSDDrawCall::TextureBindings> seen_textures_;
+  std::vector<GLId> seen_verts_;
+
+  Stats stats_;
+};
+
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <osd/osd.h>
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <exception>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace brdrive {
+
+// Forward declarations
+class GLContext;
+class GLFence;
+class OSDSurface;
+class OSDCommandBuffer;
+
+// Records OSDCommandBuffers on a pool of worker threads,
+//   while all the GL calls stay on the thread which owns
+//   the GLContext (which is the only thread allowed to
+//   call the OSDRecorder's methods)
+//  - Every record() call gets assigned the next one of the
+//    recorder's OSDCommandBuffers, submit() then waits for
+//    all the recording to finish and replays the buffers in
+//    the order in which the record() calls were made
+//  - The command buffers are reused across frames i.e. the
+//    n-th record() after a submit() always gets the same
+//    OSDCommandBuffer, so the commands recorded during the
+//    previous frame are still there (which OSDSurface::record()
+//    takes advantage of) - Jobs which don't need that should
+//    clear() the buffer first
+//  - Jobs MUST NOT make any GL calls
+class OSDRecorder {
+public:
+  using Job = std::function<void(OSDCommandBuffer& cmdbuf)>;
+
+  // - When 'num_threads' == 0 one thread less than the number
+  //   of hardware threads is used (but always at least 1)
+  OSDRecorder(unsigned num_threads = 0);
+  OSDRecorder(const OSDRecorder&) = delete;
+  ~OSDRecorder();
+
+  // Queues the 'job' which will be run on one of the worker threads
+  auto record(Job job) -> OSDRecorder&;
+
+  // Calls surface.prepareRecord() (which maps the surface's
+  //   buffers) on the calling thread and queues a Job which
+  //   does the rest of OSDSurface::record()
+  //  - The 'surface' must not be used until submit() returns
+  auto record(OSDSurface& surface) -> OSDRecorder&;
+
+  // Waits for all the queued Jobs to finish, finishes the
+  //   OSDSurface recordings and replays all the command
+  //   buffers in order
+  //  - No fences are inserted (see submitFenced())
+  //  - If any of the Jobs threw an exception the first one
+  //    gets rethrown here (after all the Jobs are done)
+  auto submit(GLContext& gl_context) -> OSDRecorder&;
+
+  // Same as submit() above, except a single fence is inserted
+  //   after the last command buffer and returned (primed)
+  //  - Analogous to OSDRenderQueue::flushFenced()
+  auto submitFenced(GLContext& gl_context) -> GLFence;
+
+  auto numThreads() const -> unsigned;
+
+private:
+  struct WorkItem {
+    Job job;
+    OSDCommandBuffer *cmdbuf;
+  };
+
+  void workerMain();
+
+  // Returns the OSDCommandBuffer for the next record()
+  auto nextCommandBuffer() -> OSDCommandBuffer *;
+
+  std::vector<std::thread> workers_;
+
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable work_done_;
+
+  // The members below are protected by 'mutex_'
+  std::deque<WorkItem> queue_;
+  unsigned num_unfinished_;
+  std::exception_ptr job_exception_;
+  bool quit_;
+
+  // The members below are only ever accessed by the thread
+  //   which calls record()/submit()
+  std::vector<std::unique_ptr<OSDCommandBuffer>> cmdbufs_;
+  unsigned num_recorded_;
+
+  std::vector<OSDSurface *> surfaces_;
+};
+
+}
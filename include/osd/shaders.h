@@ -9,6 +9,12 @@ namespace osd_detail {
 auto init_DrawString_program() -> GLProgram*;
 auto init_DrawRectangle_program() -> GLProgram*;
 auto init_DrawShadedQuad_program() -> GLProgram*;
+auto init_DrawStringIndirect_program() -> GLProgram*;
+auto init_DrawStringGlyphs_program() -> GLProgram*;
+auto init_DrawStringInstanced_program() -> GLProgram*;
+auto init_DrawStringStorage_program() -> GLProgram*;
+auto init_DrawStringStorageIndirect_program() -> GLProgram*;
+auto init_DrawStringStorageGlyphs_program() -> GLProgram*;
 }
 
 }
@@ -2,6 +2,8 @@
 
 #include <osd/osd.h>
 #include <osd/util.h>
+#include <osd/cmdbuf.h>
+#include <osd/layout.h>
 
 #include <window/geometry.h>
 #include <window/color.h>
@@ -9,12 +11,14 @@
 
 #include <exception>
 #include <stdexcept>
+#include <string>
 #include <vector>
 #include <memory>
 
 namespace brdrive {
 
 // Forward declarations
+class GLContext;
 class OSDBitmapFont;
 class OSDDrawCall;
 class GLVertexArray;
@@ -26,8 +30,10 @@ class GLSampler;
 class GLBuffer;
 class GLVertexBuffer;
 class GLBufferTexture;
-class GLIndexBuffer;
 class GLPixelBuffer;
+class GLDrawIndirectBuffer;
+class GLShaderStorageBuffer;
+class GLBufferMapping;
 
 // PIMPL struct
 struct pOSDSurface;
@@ -46,25 +52,199 @@ public:
     { }
   };
 
+  struct StringAttributesSourceUnsupportedError : public std::runtime_error {
+    StringAttributesSourceUnsupportedError() :
+      std::runtime_error("the requested StringAttributesSource isn't supported by the GLContext"
+          " (see stringAttributesSourceSupported())")
+    { }
+  };
+
+  // Identifies a string written to the surface, stays valid
+  //   until the string is removeString()'ed or the surface
+  //   is clear()'ed (using it afterwards is a programmer error)
+  struct StringHandle {
+    enum : u32 {
+      Invalid = ~0u,
+    };
+
+    u32 id;
+
+    // Catches handles to strings which were removed
+    //   (and which's id was then reused)
+    u32 generation;
+  };
+
+  // How the strings are split up into instances
+  enum StringDrawMode {
+    // Chosen separately for every page of strings according to
+    //   the distribution of the strings' lengths - whichever
+    //   mode the OSDStringCostModel estimates to be cheaper
+    //   (the default)
+    StringDrawAuto,
+
+    // One instance per string, with the strings sorted by length
+    //   and split into buckets drawn with a separate draw each (or
+    //   a single multi-draw indirect one), every instance runs the
+    //   vertices of <the bucket's longest string's length> glyphs
+    StringDrawBucketed,
+
+    // One instance per glyph and a single draw per page, no
+    //   vertices are wasted on shorter strings, but every glyph
+    //   costs an extra fetch and the unused characters of the
+    //   page (e.g. after removals) get drawn as empty instances
+    StringDrawPerGlyph,
+  };
+
+  // Where the vertex shader gets the strings' attributes (position,
+  //   offset of the characters, length and color) from - which
+  //   one is faster depends on the driver, see 'brdrive --bench'
+  enum StringAttributesSource {
+    // StringAttributesStorageBuffer when it's supported,
+    //   StringAttributesTextureBuffer otherwise (the default)
+    //  - Resolved by create(), i.e. stringAttributesSource()
+    //    never returns it
+    StringAttributesAuto,
+
+    // A texture buffer read with texelFetch()
+    StringAttributesTextureBuffer,
+
+    // Per-instance vertex attributes read by the vertex fetch
+    //   - Requires ARB_base_instance (ARB_multi_draw_indirect
+    //     is used for drawing the buckets when it's available)
+    //   - The strings are always drawn bucketed (i.e. the
+    //     StringDrawMode is ignored), as the per-glyph
+    //     instances need to fetch the attributes by index
+    StringAttributesInstanced,
+
+    // Shader storage buffers read directly as std430 arrays (the
+    //   characters and the glyphs of StringDrawPerGlyph pages too),
+    //   so no texture units or format conversions are involved
+    //   - Requires ARB_shader_storage_buffer_object
+    StringAttributesStorageBuffer,
+  };
+
   OSDSurface();
   ~OSDSurface();
 
   //  - 'font' must be valid only until the return of
   //    this function call
+  //  - Throws StringAttributesSourceUnsupportedError when
+  //    the 'attrs_source' isn't supported
   auto create(
       ivec2 width_height, const OSDBitmapFont *font = nullptr,
-      const Color& bg = Color::transparent()
+      const Color& bg = Color::transparent(),
+      StringAttributesSource attrs_source = StringAttributesAuto
+    ) -> OSDSurface&;
+
+  // Same as create() above, except the glyphs are sampled from the
+  //   'font_atlas' instead of a texture uploaded by the surface
+  //   itself, so the upload can be done ahead of time off the
+  //   rendering thread (e.g. by a GLResourceLoader's LoadFn)
+  //  - The 'font_atlas' must've been filled by uploadFontAtlas()
+  //    with the same 'font' (which is still required) and
+  //    must outlive the surface
+  auto create(
+      ivec2 width_height, const OSDBitmapFont *font, GLTexture2D *font_atlas,
+      const Color& bg = Color::transparent(),
+      StringAttributesSource attrs_source = StringAttributesAuto
     ) -> OSDSurface&;
 
-  auto writeString(ivec2 pos, const char *string, const Color& color) -> OSDSurface&;
+  // Allocates the 'font_atlas' and uploads the 'font''s glyphs into
+  //   it, doesn't depend on any other OSD state, so it can be called
+  //   on any thread with a context which shares objects with the
+  //   rendering one current
+  //  - GL_UNPACK_ALIGNMENT must be 1
+  static auto uploadFontAtlas(const OSDBitmapFont& font, GLTexture2D& font_atlas) -> void;
+
+  // Returns 'true' if surfaces can be create()'d with the 'source'
+  //   - osd_init() must've been called beforehand
+  static auto stringAttributesSourceSupported(StringAttributesSource source) -> bool;
+
+  auto stringAttributesSource() const -> StringAttributesSource;
+
+  // The surface retains the strings written to it, so only
+  //   the strings which are changed through their handles get
+  //   re-uploaded to the gpu (by the next draw() or record())
+  //  - Changing a string's length or adding/removing strings
+  //    also causes the per-string attributes (of the string's
+  //    page) to be re-sorted and rewritten, moving or recoloring
+  //    a string only rewrites that string's attributes
+  //  - The strings are stored in pages of gpu buffers, which are
+  //    created as needed, so the number of strings is unlimited
+  //    (every non-empty page needs at least one draw)
+  auto writeString(ivec2 pos, const char *string, const Color& color) -> StringHandle;
+
+  auto updateString(StringHandle handle, const char *string) -> OSDSurface&;
+  auto moveString(StringHandle handle, ivec2 pos) -> OSDSurface&;
+  auto recolorString(StringHandle handle, const Color& color) -> OSDSurface&;
+  auto removeString(StringHandle handle) -> OSDSurface&;
+
+  // Overrides the StringDrawMode (StringDrawAuto by default),
+  //   which takes effect on the next draw()/record()
+  auto stringDrawMode(StringDrawMode mode) -> OSDSurface&;
+  auto stringDrawMode() const -> StringDrawMode;
 
   auto draw() -> std::vector<OSDDrawCall>;
 
+  // Records the commands needed to draw the surface into
+  //   'cmdbuf', intended for surfaces which are redrawn
+  //   every frame while rarely changing:
+  //    - When nothing was written to (or clear()'ed from)
+  //      the surface since the last record() into the same
+  //      'cmdbuf' this is a no-op (no data gets uploaded)
+  //      and the previously recorded commands can simply
+  //      be replay()'ed again
+  //    - When the contents changed, but the surface still
+  //      needs the same number of draws - only their
+  //      parameters get patch()'ed
+  //    - Otherwise 'cmdbuf' is clear()'ed and re-recorded
+  //  - 'cmdbuf' should be used exclusively by this surface
+  //  - Equivalent to:
+  //        if(prepareRecord(cmdbuf)) recordPrepared(cmdbuf);
+  //        finishRecord();
+  auto record(OSDCommandBuffer& cmdbuf) -> OSDSurface&;
+
+  // record() split up into the parts which need to be done on
+  //   the thread which owns the GLContext (mapping and unmapping
+  //   the gpu buffers) and the part which can be done on any
+  //   other thread (writing the surface's contents into the
+  //   mapped buffers and recording the commands):
+  //    - prepareRecord() maps the buffers (GL thread), returns
+  //      'false' if there's nothing to record, in which case
+  //      recordPrepared() doesn't have to be called
+  //    - recordPrepared() can be called on any thread, makes
+  //      no GL calls
+  //    - finishRecord() unmaps the buffers (GL thread), it must
+  //      be called after every prepareRecord(), but only once
+  //      recordPrepared() has returned
+  //  - The surface must not be used in any other way between
+  //    the prepareRecord() and finishRecord() calls
+  auto prepareRecord(const OSDCommandBuffer& cmdbuf) -> bool;
+  auto recordPrepared(OSDCommandBuffer& cmdbuf) -> OSDSurface&;
+  auto finishRecord() -> OSDSurface&;
+
   // Clears any objects written to the surface up to
   //   this point i.e. after this call draw() is gua-
   //   -ranteed to return an empty vector
+  //  - Invalidates all the StringHandles
   auto clear() -> OSDSurface&;
 
+  // Measures the constants of the OSDStringCostModel::global() used
+  //   to split the strings into buckets on the GPU (with
+  //   GL_TIME_ELAPSED queries), by issuing draws of generated strings
+  //   (written into a page of the surface's which holds no strings,
+  //   creating one if needed) with rasterization disabled
+  //    - Many single-glyph draws give the cost of a draw
+  //    - A single draw of long strings (i.e. a lot of vertex
+  //      shader invocations) gives the cost of a vertex
+  //  - Blocks until the results are available, so it should
+  //    only be called once e.g. during startup
+  //  - Must be called on the thread which owns the GLContext and
+  //    not while any of the surfaces are being recorded
+  //  - The surface can't use StringAttributesInstanced (as
+  //    there are no per-glyph draws of it)
+  auto calibrateCostModel(GLContext& gl_context) -> OSDSurface&;
+
   static auto renderProgram(int /* OSDDrawCall::DrawType */ draw_type) -> GLProgram&;
 
 private:
@@ -74,10 +254,24 @@ private:
 
   enum {
     SurfaceVertexBufSize = 4 * 1024,
-    SurfaceIndexBufSize  = 4 * 1024,
 
-    StringsGPUBufSize     = 256 * 1024, // 256KiB
-    StringAttrsGPUBufSize = 4 * 1024,   // 4KiB
+    // The strings are stored in pages, each of which has it's own
+    //   set of gpu buffers, new pages are created on demand when
+    //   a string doesn't fit in any of the existing ones
+    //  - The sizes are within the minimum GL_MAX_TEXTURE_BUFFER_SIZE
+    //    (65536 texels, with 4 characters or 1 string's attributes
+    //    per texel)
+    StringsPageSize     = 256 * 1024, // 256KiB
+    StringAttrsPageSize = 32 * 1024,  // 32KiB
+
+    MaxStringsPerPage = StringAttrsPageSize / sizeof(osd_detail::StringAttributes),
+
+    // Enough for one GLDrawIndirectBuffer::DrawArraysCommand
+    //   per bucket of strings, OSDStringCostModel::partition()
+    //   never creates more than that (per page)
+    MaxStringBuckets      = 64,
+
+    NoPage = ~0u,
   };
 
   void initGLObjects();
@@ -94,8 +288,60 @@ private:
   void destroyCommonGLObjects();
   void destroyFontGLObjects();
 
+  // Maps the buffers of all the pages which have uploads pending
+  //   (i.e. the ones appendStringDrawcalls() will write to),
+  //   the mappings are kept until unmapStringBuffers() is called
+  void mapStringBuffers();
+  void unmapStringBuffers();
+
+  // Returns 'true' if any of the strings' characters or attributes
+  //   still have to be written into the gpu buffers
+  auto stringUploadsPending() const -> bool;
+
+  // Writes the changed strings into the buffers mapped by
+  //   mapStringBuffers() (re-sorting them first if needed)
+  //   and appends the draw calls which draw them to 'drawcalls'
+  //   (at least one per non-empty page)
+  //  - Doesn't make any GL calls
   void appendStringDrawcalls(std::vector<OSDDrawCall>& drawcalls);
 
+  // Sorts the page's 'draw_order' by the strings' lengths (with
+  //   a counting sort), splits it into 'buckets' according to the
+  //   OSDStringCostModel, assigns every string it's 'attrs_slot'
+  //   and picks whether the page is drawn 'per_glyph'
+  void rebuildStringLayout(u32 page_idx);
+
+  // Writes the characters and/or attributes of all the strings
+  //   in 'dirty_strings_' (and ALL the attributes - and for pages
+  //   drawn 'per_glyph' the glyphs - of the pages which had their
+  //   layout rebuilt, see StringPage::layout_rebuilt) into the
+  //   mapped buffers
+  void uploadDirtyStrings();
+
+  // Finds a page with room for the string (creating a new one if
+  //   needed) and reserves 'length' characters in it for the string,
+  //   which MUST NOT be on any page (see releaseString())
+  void placeString(u32 id, u32 length, u32 preferred_page = NoPage);
+
+  // Removes the string from it's page, after which the space
+  //   it's characters took up can be reclaimed by compaction
+  void releaseString(u32 id);
+
+  // Packs all of the page's strings' characters together
+  void compactStringPage(u32 page_idx);
+
+  // Creates a page with empty buffers and returns it's index
+  auto newStringPage() -> u32;
+
+  // Queues the string for upload by the next draw()/record()
+  void markStringDirty(u32 id, bool chars, bool attrs);
+
+  // Returns 'true' when all the buckets of a page of strings can
+  //   be drawn with a single OSDDrawCall::DrawStringIndirect (or
+  //   DrawStringInstanced/DrawStringStorageIndirect) draw call
+  //   (and the pages' 'draws_buf' are created)
+  auto useMultiDrawIndirect() const -> bool;
+
   // Array of GLProgram *[OSDDrawCall::NumDrawTypes]
   //   - NOTE: pointers in this array CAN be nullptr
   //      (done for ease of indexing)
@@ -105,6 +351,13 @@ private:
   const OSDBitmapFont *font_;
   Color bg_;
 
+  StringDrawMode string_draw_mode_;
+  StringAttributesSource attrs_source_;
+
+  // Whether the buckets of a page are drawn with a single
+  //   multi-draw indirect draw, queried by create()
+  bool multi_draw_indirect_;
+
   // Set to 'true' after create() is called
   bool created_;
 
@@ -113,9 +366,166 @@ private:
     ivec2 position;
     std::string str;
     Color color;
+
+    // Index of the page the string is stored on
+    //   in 'string_pages_' (NoPage when removed)
+    u32 page;
+
+    // The strings' characters are stored at stable offsets in the
+    //   page's 'strings_buf' (which are reused when the length of
+    //   the string doesn't exceed 'chars_capacity')
+    u32 chars_offset;
+    u32 chars_capacity;
+
+    // Index of the string's attributes in the page's 'attrs_buf',
+    //   which is also the string's position in it's 'draw_order'
+    u32 attrs_slot;
+
+    // Index of the string's id in the page's 'string_ids'
+    u32 page_entry;
+
+    u32 generation;
+    bool live;      // 'false' once removeString()'ed
+
+    // Set when the string is waiting in 'dirty_strings_'
+    //   to get it's characters/attributes uploaded
+    bool chars_dirty;
+    bool attrs_dirty;
   };
 
+  // Returns the StringObject the 'handle' refers to
+  auto stringObject(StringHandle handle) -> StringObject&;
+
+  // Indexed by StringHandle::id
   std::vector<StringObject> string_objects_;
+  // Ids of removed strings, reused by writeString()
+  std::vector<u32> free_strings_;
+  // Ids of the strings with pending uploads (can
+  //   contain removed strings, which get skipped)
+  std::vector<u32> dirty_strings_;
+
+  // A contiguous range of a page's 'draw_order'
+  //   drawn with a single (instanced) draw
+  struct StringBucket {
+    u32 first;
+    u32 count;
+    u32 max_length;
+  };
+
+  struct StringPage {
+    // NOTE: the buffers and textures which aren't used with
+    //   the surface's StringAttributesSource are nullptr
+
+    //  * string data (i.e. the strings themselves)
+    GLBufferTexture *strings_buf;
+    GLTextureBuffer *strings_tex;
+
+    //  * string attributes:
+    //      position, offset in 'strings_buf', size, color
+    //    in a texture buffer...
+    GLBufferTexture *attrs_buf;
+    GLTextureBuffer *attrs_tex;
+
+    //    ...or a per-instance vertex buffer and a vertex array
+    //    which sources them from it (with StringAttributesInstanced)
+    GLVertexBuffer *attrs_verts;
+    GLVertexArrayHandle attrs_array;
+
+    //  * per-bucket draw commands, only created when
+    //    useMultiDrawIndirect() == true (nullptr otherwise)
+    GLDrawIndirectBuffer *draws_buf;
+
+    //  * the 'attrs_slot' of the string every character of
+    //    'strings_buf' belongs to, used only when the page
+    //    is drawn 'per_glyph' (see osd_drawcall_string_glyphs())
+    GLBufferTexture *glyphs_buf;
+    GLTextureBuffer *glyphs_tex;
+
+    //  * the shader storage buffers which take the place of
+    //    all the texture buffers above (with
+    //    StringAttributesStorageBuffer)
+    GLShaderStorageBuffer *strings_storage;
+    GLShaderStorageBuffer *attrs_storage;
+    GLShaderStorageBuffer *glyphs_storage;
+
+    // Mappings created by mapStringBuffers()
+    std::unique_ptr<GLBufferMapping> strings_mapping;
+    std::unique_ptr<GLBufferMapping> attrs_mapping;
+    std::unique_ptr<GLBufferMapping> draws_mapping;
+    std::unique_ptr<GLBufferMapping> glyphs_mapping;
+
+    u32 num_strings;
+
+    // Ids of all the strings stored on the page (in no particular
+    //   order), so the page's strings can be found without going
+    //   through all of the surface's 'string_objects_'
+    //  - Maintained by placeString() and releaseString()
+    std::vector<u32> string_ids;
+
+    // End of the allocated part of 'strings_buf' and the number
+    //   of characters in it which belong to the page's strings
+    //   (the rest can be reclaimed by compactStringPage())
+    u32 chars_end;
+    u32 chars_used;
+
+    // Ids of the page's strings sorted by length, the n-th
+    //   string's attributes are stored at slot 'n'
+    std::vector<u32> draw_order;
+    std::vector<StringBucket> buckets;
+
+    // Set when the page is drawn with one instance per glyph
+    //   (in which case the 'buckets' are unused)
+    bool per_glyph;
+
+    // Set when 'draw_order' has to be rebuilt i.e. when strings
+    //   were added, removed or changed length
+    bool layout_dirty;
+
+    // Set when some of the page's strings are in 'dirty_strings_'
+    bool upload_pending;
+
+    // Set by appendStringDrawcalls() when the page's layout was
+    //   rebuilt, until uploadDirtyStrings() rewrites the attributes
+    bool layout_rebuilt;
+
+    // OSDStringCostModel::generation the 'buckets'
+    //   were computed with
+    u32 cost_model_generation;
+  };
+
+  auto pageUploadsPending(const StringPage& page) const -> bool;
+
+  // Return the draw calls which draw the page's strings from the
+  //   buffers of the surface's StringAttributesSource, i.e. the
+  //   osd_drawcall_strings[_indirect,_instanced,_storage]()
+  //   or osd_drawcall_string_glyphs[_storage]() one
+  //  - 'num_draws' is the number of commands in the 'draws_buf'
+  auto stringsDrawcall(
+      StringPage& page, GLSize base_offset, GLSize max_length, GLSize num_strings
+    ) -> OSDDrawCall;
+  auto stringsIndirectDrawcall(StringPage& page, GLSize num_draws) -> OSDDrawCall;
+  auto stringGlyphsDrawcall(StringPage& page, GLSize num_glyphs) -> OSDDrawCall;
+
+  // Pages are never destroyed before the surface, empty
+  //   pages get reused for new strings
+  std::vector<StringPage> string_pages_;
+
+  // Scratch space for rebuildStringLayout()'s counting sort
+  std::vector<u32> string_length_histogram_;
+
+  // Set when the surface's contents change, cleared by record()
+  bool dirty_;
+
+  // Set by prepareRecord() when recordPrepared() has work to do
+  bool record_pending_;
+
+  // The command buffer (along with it's generation()) last
+  //   record()'ed into, handles to the draws in it and the
+  //   draw calls they were recorded from
+  const OSDCommandBuffer *recorded_cmdbuf_;
+  u32 recorded_generation_;
+  std::vector<OSDCommandBuffer::DrawHandle> recorded_draws_;
+  std::vector<OSDDrawCall> recorded_drawcalls_;
 
   mat4 m_projection;
 
@@ -124,20 +534,14 @@ private:
 
   //   * attached to 'empty_vertex_array_'
   GLVertexBuffer *surface_object_verts_;
-  GLIndexBuffer *surface_object_inds_;
 
   // String-related gx objects
   GLTexture2D *font_tex_;
   GLSampler *font_sampler_;
 
-  //  * string data (i.e. the strings themselves)
-  GLBufferTexture *strings_buf_;
-  GLTextureBuffer *strings_tex_;
-
-  //  * string attributes:
-  //      position, offset in 'strings_buf_', size, color
-  GLBufferTexture *string_attrs_buf_;
-  GLTextureBuffer *string_attrs_tex_;
+  // 'false' when the 'font_tex_' is a 'font_atlas' passed
+  //   to create() (which is owned by the caller)
+  bool owns_font_tex_;
 };
 
 }
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <types.h>
+
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+namespace brdrive {
+
+// Low-overhead instrumentation, which records timed zones
+//   into per-thread buffers and exports them in the Chrome
+//   trace event format (which can be opened with Perfetto
+//   or chrome://tracing)
+//  - Recording a zone never takes a lock - every thread
+//    appends to it's own fixed-size buffer (allocated and
+//    registered the first time the thread records a zone),
+//    once the buffer fills up further zones are dropped
+//  - The zones' names MUST be string literals (or otherwise
+//    outlive the trace), as only the pointer gets recorded
+//  - Nothing gets recorded until trace_enable() is called
+
+enum TraceCategory : u8 {
+  TraceCPU,     // CPU work (the default)
+  TraceGPU,     // GPU execution, see trace_gpu_zone()
+  TraceSwap,    // Presentation i.e. swapBuffers()
+  TraceWait,    // Blocking - on the event loop, fences etc.
+
+  NumTraceCategories,
+};
+
+struct TraceExportError : public std::runtime_error {
+  TraceExportError() :
+    std::runtime_error("failed to write the trace file!")
+  { }
+};
+
+auto trace_enable(bool enabled = true) -> void;
+auto trace_enabled() -> bool;
+
+// Returns the number of nanoseconds since the
+//   first call to any of the trace_*() functions
+auto trace_now() -> u64;
+
+// Names the calling thread in the exported trace
+auto trace_thread_name(const char *name) -> void;
+
+// Records a zone spanning [begin_ns; end_ns] (as
+//   returned by trace_now()) on the calling thread
+auto trace_zone(const char *name, TraceCategory category, u64 begin_ns, u64 end_ns) -> void;
+
+// Records a zone on the separate 'GPU' timeline, with
+//   'begin_ns' already converted to the trace_now() clock
+//  - Unlike the other zones, the name gets copied
+//  - The GPU timeline has the same capacity as a thread's
+//    buffer, further zones are dropped (and counted)
+auto trace_gpu_zone(const std::string& name, u64 begin_ns, u64 duration_ns) -> void;
+
+// Writes all the zones recorded so far to the file at 'path' as
+//   Chrome trace event format JSON, throws TraceExportError
+//   when the file can't be written
+//  - Can be called at any point, zones which are being
+//    recorded concurrently may or may not be included
+auto trace_export_chrome(const char *path) -> void;
+
+// Records a zone lasting from the TraceZone's construction
+//   to it's destruction on the calling thread
+class TraceZone {
+public:
+  TraceZone(const char *name, TraceCategory category = TraceCPU) :
+    name_(trace_enabled() ? name : nullptr), category_(category),
+    begin_(name_ ? trace_now() : 0)
+  { }
+  TraceZone(const TraceZone&) = delete;
+
+  ~TraceZone()
+  {
+    if(!name_) return;
+
+    trace_zone(name_, category_, begin_, trace_now());
+  }
+
+private:
+  const char *name_;    // nullptr when tracing was disabled
+  TraceCategory category_;
+
+  u64 begin_;
+};
+
+}
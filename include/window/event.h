@@ -7,6 +7,7 @@
 #include <stdexcept>
 #include <memory>
 #include <deque>
+#include <mutex>
 
 namespace brdrive {
 
@@ -21,6 +22,9 @@ public:
     Quit,
     KeyDown, KeyUp,
     MouseMove, MouseDown, MouseUp,
+
+    // Events posted via IEventLoop::post()
+    User,
   };
 
   using Ptr = std::unique_ptr<Event>;
@@ -65,6 +69,22 @@ public:
   static auto alloc() -> Event::Ptr { return Event::Ptr(new QuitEvent()); }
 };
 
+// Generic event for IEventLoop::post(), the meaning
+//   of 'code' and 'data' is up to the poster
+class UserEvent : public Event {
+public:
+  UserEvent(u32 code, uptr data);
+
+  static auto alloc(u32 code, uptr data) -> Event::Ptr { return Event::Ptr(new UserEvent(code, data)); }
+
+  auto code() const -> u32;
+  auto data() const -> uptr;
+
+private:
+  u32 code_;
+  uptr data_;
+};
+
 class IKeyEvent {
 public:
   virtual ~IKeyEvent();
@@ -130,6 +150,12 @@ public:
 
   auto queueEmpty() const -> bool;
 
+  // Queues the 'event' to be returned by a future event() call
+  //   and wakes up event() if it's blocked waiting
+  //  - Unlike all the other methods, can be called
+  //    from any thread
+  auto post(Event::Ptr event) -> IEventLoop&;
+
 protected:
   // Should return 'false' if initialization fails
   virtual auto initInternal() -> bool = 0;
@@ -145,17 +171,29 @@ protected:
   virtual auto pollEvent() -> Event::Ptr = 0;
 
   // Blocking version of pollEvent()
-  //   - Must NEVER return 'nullptr'
+  //   - Must return 'nullptr' ONLY when it was woken
+  //     up by wakeupInternal()
   virtual auto waitEvent() -> Event::Ptr = 0;
 
+  // Should cause a waitEvent() call blocked on another
+  //   thread (or the next one if none is) to return
+  //  - Called by post(), so it must be thread-safe
+  virtual void wakeupInternal() = 0;
+
   auto window() -> IWindow*;
 
 private:
   void fillQueue();
 
+  // Moves the events from 'posted_' to the end of 'queue_'
+  void takePosted();
+
   bool was_init_;
   IWindow *window_;
   std::deque<Event::Ptr> queue_;
+
+  mutable std::mutex posted_mutex_;
+  std::deque<Event::Ptr> posted_;   // Protected by 'posted_mutex_'
 };
 
 }
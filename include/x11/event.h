@@ -77,6 +77,10 @@ protected:
   virtual auto pollEvent() -> Event::Ptr;
   virtual auto waitEvent() -> Event::Ptr;
 
+  // Sends a ClientMessage (of type 'wakeup_atom_') to the
+  //   window, which makes xcb_wait_for_event() return
+  virtual void wakeupInternal();
+
 private:
   friend X11KeyEvent;
   friend X11MouseEvent;
@@ -85,12 +89,17 @@ private:
     InvalidCoord = ~0,
   };
 
+  // Returns 'true' for the ClientMessages sent by wakeupInternal()
+  auto isWakeup(X11EventHandle ev) const -> bool;
+
   void processInternal(X11EventHandle ev);
   void updateInternalData(const Event *event);
 
   Vec2<i16> mouse_last_;
   u16 mouse_buttons_last_;
   u32 key_modifiers_;
+
+  u32 /* xcb_atom_t */ wakeup_atom_;
 };
 
 }
@@ -13,9 +13,65 @@ struct pGLXContext;
 
 class GLXContext : public GLContext {
 public:
+  enum SwapInterval : int {
+    // Swaps as soon as possible (tears)
+    SwapImmediate = 0,
+    // Waits for the vertical blank (the default)
+    SwapVsync = 1,
+    // Waits for the vertical blank, unless the frame
+    //   missed it - in which case it swaps immediately
+    //   (requires GLX_EXT_swap_control_tear)
+    SwapAdaptiveVsync = -1,
+  };
+
+  // The timing of the presented frames, as reported by
+  //   GLX_OML_sync_control (see presentTimingSupported())
+  //  - UST (the timestamps) are CLOCK_MONOTONIC microseconds
+  //    on all known implementations, which is what the
+  //    latency is measured against
+  //  - MSC is the count of vertical blanks
+  struct PresentStats {
+    u64 num_presented;    // Number of frames which were actually presented
+    u64 num_missed;       // Number of vertical blanks without a new frame (which should've had one)
+
+    u64 last_ust;         // When the last frame was presented
+    u64 last_msc;
+
+    // Time from swapBuffers() being called to the frame
+    //   being presented (of the last frame, and the
+    //   average of all of them)
+    u64 last_latency_us;
+    u64 avg_latency_us;
+  };
+
+  // Minimum requirements for the window's FBConfig, out of the
+  //   ones which meet them the one with the fewest excess bits
+  //   (and without multisampling or accumulation buffers, unless
+  //   those were requested) is chosen
+  struct FramebufferConfig {
+    int red_bits = 8, green_bits = 8, blue_bits = 8, alpha_bits = 8;
+    int depth_bits = 0, stencil_bits = 0;
+    int samples = 0;    // 0 - no multisampling
+  };
+
+  // The X visual which windows must be created with
+  //   to be used with the chosen FBConfig
+  struct Visual {
+    u8 depth;
+    u32 visual_id;
+  };
+
   GLXContext();
+  GLXContext(const FramebufferConfig& config);
   virtual ~GLXContext();
 
+  // Chooses the FBConfig for acquire() according to the FramebufferConfig
+  //   and returns the Visual of it, throws NoSuitableFramebufferConfigError
+  //  - Can be called after x11_init() and BEFORE creating the window,
+  //    so it can be created with the right visual from the start (see
+  //    X11Window::visual()) - otherwise acquire() has to recreate it
+  auto chooseVisual() -> Visual;
+
   virtual auto acquire(
       IWindow *window, GLContext *share = nullptr
     ) -> GLContext&;
@@ -26,7 +82,41 @@ public:
 
   virtual auto handle() -> GLContextHandle;
 
+  // Returns 'false' when the 'interval' isn't supported (in which
+  //   case the previous interval remains in effect)
+  //  - Positive values mean swapping every 'interval' vertical blanks,
+  //    negative ones - the same with adaptive vsync, see SwapInterval
+  //  - The context must've been acquire()'d with a window
+  auto swapInterval(int interval) -> bool;
+  auto swapInterval() const -> int;
+
+  auto adaptiveVsyncSupported() const -> bool;
+
+  // Returns 'true' when GLX_OML_sync_control is available,
+  //   otherwise presentStats() always returns all zeroes
+  auto presentTimingSupported() const -> bool;
+
+  // Picks up the timing of frames which were presented since
+  //   the last call (or swapBuffers(), which also does that)
+  //   without blocking
+  auto presentStats() -> PresentStats;
+
 private:
+  // Records the timing of the swaps which have completed
+  auto collectPresentTiming() -> void;
+
+  // Called by acquire() when 'window' == nullptr, in which case
+  //   a 1x1 pbuffer is used as the drawable, so the context can
+  //   only be used to render into framebuffer objects (or not
+  //   render at all - e.g. contexts for worker threads)
+  auto acquireOffscreen(GLContext *share) -> GLContext&;
+
+  FramebufferConfig config_;
+
+  // The FBConfig chosen by chooseVisual()
+  void *fb_config_;
+  Visual visual_;
+
   pGLXContext *p;
 };
 
@@ -45,16 +45,30 @@ public:
   virtual auto drawString(const std::string& str, const Geometry& geom, const Color& color,
       const std::string& font = "") -> IWindow&;
 
+  // Makes create() use the given visual instead of the root
+  //   window's one (pass 'visual_id' == 0 to reset it)
+  //  - Pass the GLXContext::chooseVisual() result here to
+  //    avoid having to recreate the window in acquire()
+  auto visual(u8 depth, u32 visual_id) -> X11Window&;
+
   auto windowHandle() -> X11WindowHandle;
 
+  // Returns the visual which the window was created with
+  //   (which is the root window's one by default)
+  auto visualId() const -> u32;
+
 private:
   friend X11EventLoop;
   friend GLXContext;
 
   // Used by GLXContext to make sure the window has
-  //   the visual required by the chosen FBConfig
+  //   the visual required by the chosen FBConfig,
+  //   when visual() wasn't called prior to create()
   auto recreateWithVisualId(u8 depth, u32 visual_id) -> bool;
 
+  u8 visual_depth_;
+  u32 visual_id_;
+
   pX11Window *p;
 };
 
@@ -16,15 +16,29 @@
 #include <gx/program.h>
 #include <gx/pipeline.h>
 #include <gx/fence.h>
+#include <gx/timeline.h>
+#include <gx/profiler.h>
+#include <gx/waiter.h>
+#include <gx/loader.h>
+#include <gx/framebuffer.h>
+#include <gx/state.h>
+#include <gx/query.h>
+#include <util/trace.h>
 #include <x11/x11.h>
 #include <x11/connection.h>
 #include <x11/window.h>
 #include <x11/event.h>
 #include <x11/glx.h>
+#include <egl/egl.h>
 #include <osd/osd.h>
 #include <osd/font.h>
 #include <osd/drawcall.h>
 #include <osd/surface.h>
+#include <osd/layout.h>
+#include <osd/costmodel.h>
+#include <osd/queue.h>
+#include <osd/cmdbuf.h>
+#include <osd/recorder.h>
 
 #include <unistd.h>
 #include <fcntl.h>
@@ -39,8 +53,10 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
-#include <chrono>
 #include <optional>
+#include <memory>
+#include <algorithm>
+#include <iterator>
 
 auto load_font(const std::string& file_name) -> std::optional<std::vector<uint8_t>>
 {
@@ -60,9 +76,397 @@ auto load_font(const std::string& file_name) -> std::optional<std::vector<uint8_
   return std::move(font);
 }
 
+// Returns the average GPU time (in nanoseconds) of submitting
+//   all the 'drawcalls' once (with rasterization disabled)
+static auto bench_drawcalls_ns(
+    brdrive::GLContext& gl_context, const std::vector<brdrive::OSDDrawCall>& drawcalls
+  ) -> double
+{
+  using namespace brdrive;
+
+  enum : unsigned {
+    NumRepeats = 16,
+  };
+
+  glEnable(GL_RASTERIZER_DISCARD);
+
+  GLQuery query(GLQuery::TimeElapsed);
+  query.begin();
+  for(unsigned i = 0; i < NumRepeats; i++) {
+    for(const auto& drawcall : drawcalls) osd_submit_drawcall_no_fence(gl_context, drawcall);
+  }
+  query.end();
+
+  glDisable(GL_RASTERIZER_DISCARD);
+
+  return (double)query.result() / NumRepeats;
+}
+
+// Returns the average GPU time (in nanoseconds) of drawing
+//   the 'surface' (with rasterization disabled), the strings
+//   are uploaded before the measurement
+static auto bench_surface_draw_ns(brdrive::GLContext& gl_context, brdrive::OSDSurface& surface) -> double
+{
+  return bench_drawcalls_ns(gl_context, surface.draw());
+}
+
+// Measures the vertex throughput of drawing strings of various
+//   lengths and prints the results, comparing:
+//    - The triangle strip path - every glyph is a quad of 4
+//      vertices in the string's strip, generated from gl_VertexID
+//      alone (what OSDSurface draws)
+//    - The indexed path it replaced - every glyph is a separate
+//      strip of 4 indices followed by a primitive restart index
+//      (5 indices per glyph), the vertex shader decodes the index
+//      into the glyph and its corner the same way, so it's drawn
+//      with the same program
+//  - Both paths draw the same strings with a single instanced draw
+//    per repeat, which OSDSurface doesn't guarantee (multi-draw
+//    indirect, pages), hence the strings' buffers are set up here
+static auto bench_string_throughput(brdrive::GLContext& gl_context) -> void
+{
+  using namespace brdrive;
+
+  enum : unsigned {
+    NumStrings = 256,
+
+    // Same as the index buffer OSDSurface used to allocate
+    RestartIndex = 0xFFFF,
+  };
+
+  // The last two were over the limit of the (removed) index buffer
+  static const unsigned s_string_lengths[] = { 8, 64, 256, 1024, 4096 };
+
+  const unsigned max_string_length = *std::max_element(
+      std::begin(s_string_lengths), std::end(s_string_lengths)
+  );
+
+  // The indices follow the pattern:
+  //    0 1 2 3 0xFFFF 4 5 6 7 0xFFFF 8 9 10 11 0xFFFF...
+  std::vector<u16> inds(max_string_length * 5);
+  for(unsigned i = 0; i < inds.size(); i++) {
+    inds[i] = (i % 5) < 4 ? (u16)((i % 5)+(i/5)*4) : (u16)RestartIndex;
+  }
+
+  GLIndexBuffer string_inds;
+  string_inds
+    .alloc(inds.size() * sizeof(u16), GLBuffer::StaticRead, inds.data());
+
+  // The glyphs are never rasterized, so the font texture is never
+  //   sampled - an empty one only satisfies the program's bindings
+  GLTexture2D font_tex;
+  font_tex
+    .alloc(1, 1, 1, r8);
+
+  auto empty_vertex_array = GLVertexFormat().newVertexArray();
+
+  GLPipeline strip_pipeline;
+  strip_pipeline
+    .inputAssembly(GLPrimitive::TriangleStrip);
+
+  GLPipeline restart_pipeline;
+  restart_pipeline
+    .inputAssembly(GLPrimitive::TriangleStrip, RestartIndex);
+
+  printf("String vertex throughput (%u strings per draw, strip vs. indexed with primitive restart):\n", NumStrings);
+
+  for(auto length : s_string_lengths) {
+    // Every string has the same characters, so
+    //   all of them can share a single copy
+    std::string string(length, 'A');
+
+    GLBufferTexture strings_buf;
+    strings_buf
+      .alloc(length, GLBuffer::StaticRead, string.data());
+
+    GLTextureBuffer strings_tex;
+    strings_tex
+      .buffer(rgba8ui, strings_buf);
+
+    std::vector<osd_detail::StringAttributes> attrs(NumStrings);
+    for(unsigned i = 0; i < NumStrings; i++) {
+      attrs[i] = osd_detail::StringAttributes {
+        0, (u16)((i % 16) * 16), 0 /* offset */, length, 0xFFFFFFFFu /* color */,
+      };
+    }
+
+    GLBufferTexture attrs_buf;
+    attrs_buf
+      .alloc(attrs.size() * sizeof(osd_detail::StringAttributes), GLBuffer::StaticRead, attrs.data());
+
+    GLTextureBuffer attrs_tex;
+    attrs_tex
+      .buffer(rgba32ui, attrs_buf);
+
+    auto strip_drawcall = osd_drawcall_strings(
+        empty_vertex_array.get(), 0,
+        length, NumStrings,
+        &font_tex, nullptr, &strings_tex, &attrs_tex
+    );
+
+    auto indexed_drawcall = strip_drawcall;
+
+    indexed_drawcall.command = OSDDrawCall::DrawIndexedInstanced;
+    indexed_drawcall.inds_type = GLType::u16;
+    indexed_drawcall.inds = &string_inds;
+    indexed_drawcall.count = length*5;
+
+    strip_pipeline.use();
+    auto strip_ns = bench_drawcalls_ns(gl_context, { strip_drawcall });
+
+    restart_pipeline.use();
+    auto indexed_ns = bench_drawcalls_ns(gl_context, { indexed_drawcall });
+
+    // All the strings are the same length, so none of the
+    //   vertices are culled
+    const u64 num_vertices = (u64)length*4 * NumStrings;
+    const double num_glyphs = (double)length * NumStrings;
+
+    printf("  %4u chars:\n", length);
+    for(auto [ns, path_name] : { std::pair(strip_ns, "strip"), std::pair(indexed_ns, "indexed") }) {
+      printf("    %-8s %9.1fus/repeat  %8.1f Mvertices/s  %6.3fns/glyph\n",
+          path_name, ns/1000.0, num_vertices / ns * 1000.0, ns / num_glyphs);
+    }
+  }
+
+  strip_pipeline.use();
+
+  printf("\n");
+}
+
+// Compares the OSDSurface::StringDrawModes on strings with
+//   various distributions of lengths and prints the results
+static auto bench_string_draw_modes(
+    brdrive::GLContext& gl_context, const brdrive::OSDBitmapFont& font
+  ) -> void
+{
+  using namespace brdrive;
+
+  enum : unsigned {
+    NumStrings = 1024,
+  };
+
+  struct Distribution {
+    const char *name;
+    unsigned (*length)(unsigned string_idx);
+  };
+
+  static const Distribution s_distributions[] = {
+    { "uniform (16 chars)", [](unsigned) -> unsigned { return 16; } },
+    { "spread (1-256 chars)", [](unsigned i) -> unsigned { return 1 + (i*97) % 256; } },
+    { "mostly short (8 chars, every 64th 1024)", [](unsigned i) -> unsigned { return i % 64 ? 8 : 1024; } },
+  };
+
+  static const std::pair<OSDSurface::StringDrawMode, const char *> s_modes[] = {
+    { OSDSurface::StringDrawBucketed, "bucketed" },
+    { OSDSurface::StringDrawPerGlyph, "per-glyph" },
+    { OSDSurface::StringDrawAuto,     "auto" },
+  };
+
+  printf("String draw modes (%u strings per surface):\n", NumStrings);
+
+  for(const auto& distribution : s_distributions) {
+    printf("  %s:\n", distribution.name);
+
+    for(auto [mode, mode_name] : s_modes) {
+      OSDSurface surface;
+      surface
+        .create({ 256, 256 }, &font)
+        .stringDrawMode(mode);
+
+      u64 num_glyphs = 0;
+      for(unsigned i = 0; i < NumStrings; i++) {
+        auto length = distribution.length(i);
+
+        std::string string(length, 'A');
+        surface.writeString({ 0, (int)(i % 16) * 16 }, string.data(), Color::white());
+
+        num_glyphs += length;
+      }
+
+      auto ns = bench_surface_draw_ns(gl_context, surface);
+
+      printf("    %-10s %9.1fus  %6.3fns/glyph\n", mode_name, ns/1000.0, ns / num_glyphs);
+    }
+  }
+
+  printf("\n");
+}
+
+// Compares the OSDSurface::StringAttributesSources (the ones
+//   supported by the context) and prints the results
+//  - The attributes are fetched once per vertex, so the
+//    difference is the most visible with short strings
+static auto bench_string_attributes_sources(
+    brdrive::GLContext& gl_context, const brdrive::OSDBitmapFont& font
+  ) -> void
+{
+  using namespace brdrive;
+
+  enum : unsigned {
+    NumStrings = 2048,
+  };
+
+  static const unsigned s_string_lengths[] = { 4, 16, 64 };
+
+  static const std::pair<OSDSurface::StringAttributesSource, const char *> s_sources[] = {
+    { OSDSurface::StringAttributesTextureBuffer, "texture buffer" },
+    { OSDSurface::StringAttributesInstanced,     "instanced" },
+    { OSDSurface::StringAttributesStorageBuffer, "storage buffer" },
+  };
+
+  printf("String attributes sources (%u strings per surface):\n", NumStrings);
+
+  for(auto length : s_string_lengths) {
+    printf("  %u chars:\n", length);
+
+    for(auto [source, source_name] : s_sources) {
+      if(!OSDSurface::stringAttributesSourceSupported(source)) {
+        printf("    %-16s unsupported\n", source_name);
+        continue;
+      }
+
+      OSDSurface surface;
+      surface
+        .create({ 256, 256 }, &font, Color::transparent(), source)
+        .stringDrawMode(OSDSurface::StringDrawBucketed);
+
+      std::string string(length, 'A');
+      for(unsigned i = 0; i < NumStrings; i++) {
+        surface.writeString({ 0, (int)(i % 16) * 16 }, string.data(), Color::white());
+      }
+
+      auto ns = bench_surface_draw_ns(gl_context, surface);
+
+      printf("    %-16s %9.1fus  %6.3fns/glyph\n", source_name, ns/1000.0, ns / ((double)length*NumStrings));
+    }
+  }
+
+  printf("\n");
+}
+
+// Renders 'num_frames' frames of an OSDSurface into a GLFramebuffer
+//   via an EGLContext (so no X server is needed) and reports the
+//   average frame time, the trace is exported to 'brdrive.headless.trace.json'
+//  - When 'bench' == true the OSD string benchmarks are run first
+static auto headless_main(unsigned num_frames, bool bench) -> int
+{
+  using namespace brdrive;
+
+  trace_enable();
+  trace_thread_name("main");
+
+  EGLContext gl_context;
+  gl_context
+    .acquire()
+    .makeCurrent();
+
+  gx_init(EGLContext::get_proc_address);
+  osd_init();
+
+  printf("OpenGL %s (EGL, %s)\n\n", gl_context.versionString().data(),
+      gl_context.mode() == EGLContext::Surfaceless ? "surfaceless" : "pbuffer");
+
+  const ivec2 dimensions = { 256, 256 };
+
+  GLTexture2D color_tex;
+  color_tex
+    .alloc(dimensions.x, dimensions.y, 1, rgba8);
+  color_tex.label("t2d.Headless.Color");
+
+  GLFramebuffer framebuffer;
+  framebuffer
+    .color(0, color_tex)
+    .use();
+  framebuffer.label("fb.Headless");
+
+  GLPipeline pipeline;
+  pipeline
+    .viewport(0, 0, dimensions.x, dimensions.y)
+    .noScissor()
+    .noDepth()
+    .alphaBlend()
+    .inputAssembly(GLPrimitive::TriangleStrip);
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glClearColor(1.0f, 1.0f, 0.0f, 0.5f);
+
+  auto topaz_1bpp = load_font("Topaz.raw");
+  if(!topaz_1bpp) {
+    puts("couldn't load font file `Topaz.raw'!");
+    return -1;
+  }
+
+  auto topaz = OSDBitmapFont().loadBitmap1bpp(topaz_1bpp->data(), topaz_1bpp->size());
+
+  if(bench) {
+    // The auto mode relies on the cost model
+    OSDSurface calibration_surface;
+    calibration_surface
+      .create(dimensions, &topaz)
+      .calibrateCostModel(gl_context);
+
+    bench_string_throughput(gl_context);
+    bench_string_draw_modes(gl_context, topaz);
+    bench_string_attributes_sources(gl_context, topaz);
+  }
+
+  OSDSurface surface;
+  surface
+    .create(dimensions, &topaz);
+
+  surface.writeString({ 0, 30 }, "hello, world!", Color::red());
+  surface.writeString({ 0, 0 }, "ASDF1234567890", Color::red());
+
+  GLFrameTimeline frame_timeline(2);
+  OSDRecorder recorder;
+
+  auto start = trace_now();
+  for(unsigned frame = 0; frame < num_frames; frame++) {
+    TraceZone trace_frame_zone("frame");
+
+    pipeline.use();
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    recorder
+      .record(surface)
+      .submit(gl_context);
+
+    gl_context.swapBuffers();
+
+    TraceZone trace_zone("GLFrameTimeline::endFrame", TraceWait);
+    frame_timeline.endFrame();
+  }
+  frame_timeline.drain();
+  auto end = trace_now();
+
+  printf("%u frames, average frame time: %.3fus\n",
+      num_frames, (end - start)/1000.0 / std::max(num_frames, 1u));
+
+  trace_export_chrome("brdrive.headless.trace.json");
+
+  gl_context.destroy();
+
+  return 0;
+}
+
 int main(int argc, char *argv[])
 {
   using namespace brdrive;
+
+  // Usage: brdrive --headless [num_frames] [--bench]
+  if(argc >= 2 && !strcmp(argv[1], "--headless")) {
+    auto num_frames = argc >= 3 ? (unsigned)atoi(argv[2]) : 1000u;
+    auto bench = argc >= 4 && !strcmp(argv[3], "--bench");
+
+    return headless_main(num_frames, bench);
+  }
+
+  // Press 't' to export the trace recorded up to that point,
+  //   it's also exported at exit
+  trace_enable();
+  trace_thread_name("main");
+
   x11_init();
 
   X11Window window;
@@ -70,7 +474,13 @@ int main(int argc, char *argv[])
 
   Geometry window_geometry = { 0, 0, 256, 256 };
 
+  // Choose the FBConfig up front, so the window gets created
+  //   with it's visual and acquire() doesn't have to recreate it
+  GLXContext gl_context;
+  auto gl_visual = gl_context.chooseVisual();
+
   window
+    .visual(gl_visual.depth, gl_visual.visual_id)
     .geometry(window_geometry)
     .background(Color(1.0f, 0.0f, 1.0f, 0.0f))
     .create()
@@ -79,8 +489,6 @@ int main(int argc, char *argv[])
   event_loop
     .init(&window);
 
-  GLXContext gl_context;
-
   gl_context
     .acquire(&window)
     .makeCurrent();
@@ -88,10 +496,28 @@ int main(int argc, char *argv[])
   gx_init();
   osd_init();
 
-  GLPipeline pipeline;
+  // Shares the fences with 'gl_context' so the GLFenceWaiter's
+  //   thread can wait on them
+  GLXContext fence_waiter_context;
+  fence_waiter_context
+    .acquire(nullptr, &gl_context);
+
+  // ...and the GLResourceLoader's thread fills textures
+  //   which are then used by 'gl_context'
+  GLXContext resource_loader_context;
+  resource_loader_context
+    .acquire(nullptr, &gl_context);
 
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  GLResourceLoader resource_loader(resource_loader_context);
+
+  // All the fixed-function state is owned by the pipeline
+  GLPipeline pipeline;
+  pipeline
+    .viewport(0, 0, window_geometry.w, window_geometry.h)
+    .noScissor()
+    .noDepth()
+    .alphaBlend()
+    .inputAssembly(GLPrimitive::TriangleStrip);
 
   gl_context
     .dbg_EnableMessages();
@@ -167,31 +593,27 @@ void main()
     .uniform("uiComputeOut", gl_context.texImageUnit(0))
     .uniform("ufWavePeriod", 1024.0f);
 
-  std::chrono::high_resolution_clock clock;
-  auto start = clock.now();
-
-  compute_shader_program.use();
-  glDispatchCompute(4096, 1, 1);
+  {
+    TraceZone trace_zone("Compute.dispatch");
 
-  auto end = clock.now();
-
-  auto ms_counts = std::chrono::milliseconds(1).count(); 
-
-  printf("\ncompute_shader_program took: %ldus\n\n",
-      std::chrono::duration_cast<std::chrono::microseconds>(end-start).count());
+    compute_shader_program.use();
+    glDispatchCompute(4096, 1, 1);
+  }
 
   GLFence compute_fence;
-  compute_fence
-    .fence()
-    .label("f.Compute")
-    .block();
+  {
+    TraceZone trace_zone("Compute.block", TraceWait);
+
+    compute_fence
+      .fence()
+      .label("f.Compute")
+      .block();
+  }
 
   gl_context
     .dbg_PopCallGroup()
     .dbg_PushCallGroup("OSD");
 
-  glDisable(GL_DEPTH_TEST);
-
   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
   glPixelStorei(GL_PACK_ALIGNMENT, 1);
 
@@ -209,24 +631,88 @@ void main()
 
   auto c = x11().connection<xcb_connection_t>();
 
-  glEnable(GL_PRIMITIVE_RESTART);
-  glPrimitiveRestartIndex(0xFFFF);
+  // The surface samples the glyphs from this atlas, which is uploaded
+  //   in the background - the surface is only created (and drawn)
+  //   once the GPU is done with it, so rendering never waits on it
+  //  - Declared before 'some_surface' so it outlives it
+  auto topaz_atlas = std::make_shared<GLTexture2D>();
 
   OSDSurface some_surface;
-  some_surface
-    .create({ window_geometry.w, window_geometry.h }, &topaz)
-    .writeString({ 0, 30 }, "hello, world!", Color::red())
-    .writeString({ 0, 0 }, "ASDF1234567890", Color::red())
-    .writeString({ 128, 100 }, "xyz", Color::blue())
-    .writeString({ 128, 200 }, "!#@$", Color::green());
-
-  glViewport(0, 0, window_geometry.w, window_geometry.h);
-  
+  OSDSurface::StringHandle frame_counter_string = { OSDSurface::StringHandle::Invalid, 0 };
+  bool some_surface_ready = false;
+
+  resource_loader.load(
+      [topaz_atlas, &topaz]() {
+        // The pixel store state isn't shared between contexts
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        OSDSurface::uploadFontAtlas(topaz, *topaz_atlas);
+
+        topaz_atlas->label("t2d.TopazAtlas");
+      },
+      [&, topaz_atlas]() {
+        some_surface
+          .create({ window_geometry.w, window_geometry.h }, &topaz, topaz_atlas.get());
+
+        some_surface.writeString({ 0, 30 }, "hello, world!", Color::red());
+        some_surface.writeString({ 0, 0 }, "ASDF1234567890", Color::red());
+        some_surface.writeString({ 128, 100 }, "xyz", Color::blue());
+        some_surface.writeString({ 128, 200 }, "!#@$", Color::green());
+
+        // Updated every frame - only this string's characters
+        //   (and attributes when it's length changes) get
+        //   re-uploaded, the rest of the surface stays as-is
+        frame_counter_string = some_surface.writeString({ 0, 230 }, "frame 0", Color::white());
+
+        // Measure how expensive draws are compared to the culled glyphs'
+        //   vertices, which determines how the strings get bucketed
+        some_surface.calibrateCostModel(gl_context);
+
+        const auto& cost_model = OSDStringCostModel::global();
+        printf("OSD string cost model: %.1fns/draw %.4fns/vertex %.4fns/vertex (per-glyph)\n",
+            cost_model.draw_ns, cost_model.vertex_ns, cost_model.glyph_vertex_ns);
+
+        some_surface_ready = true;
+      });
+
+  OSDRenderQueue render_queue;
+
+  // Keeps the CPU from running more than 2 frames ahead of the GPU
+  GLFrameTimeline frame_timeline(2);
+
+  // The surface barely changes, so the commands only need to
+  //   get patch()'ed (on one of the recorder's worker threads)
+  OSDRecorder recorder;
+
+  // Times the call groups pushed inside the loop on the GPU,
+  //   press 'p' to print the most recent results
+  GLProfiler profiler;
+  gl_context.attachProfiler(&profiler);
+
+  // Press 'w' to get notified when the GPU finishes
+  //   the frame which was submitted last
+  enum : u32 { FrameDoneEventCode = 1 };
+  GLFenceWaiter fence_waiter(event_loop, fence_waiter_context, FrameDoneEventCode);
+
+  // Press 'v' to cycle between vsync, adaptive vsync and no vsync
+  const int swap_intervals[] = {
+    GLXContext::SwapVsync, GLXContext::SwapAdaptiveVsync, GLXContext::SwapImmediate,
+  };
+  unsigned swap_interval_idx = 0;
+
   bool running = true;
   bool change = false;
-  bool use_fence = false;
-  while(auto ev = event_loop.event(IEventLoop::Block)) {
-    bool use_fence_initial = use_fence;
+  bool wait_for_frame = false;
+  bool use_cmdbuf = true;
+  bool print_gpu_times = false;
+  while(true) {
+    Event::Ptr ev;
+    {
+      TraceZone trace_zone("IEventLoop::event", TraceWait);
+
+      ev = event_loop.event(IEventLoop::Block);
+    }
+    if(!ev) break;
 
     switch(ev->type()) {
     case Event::KeyDown: {
@@ -240,7 +726,23 @@ void main()
 
       if(sym == 'q') running = false;
 
-      if(sym == 'f') use_fence = !use_fence;
+      if(sym == 'c') use_cmdbuf = !use_cmdbuf;
+      if(sym == 'p') print_gpu_times = true;
+      if(sym == 'w') wait_for_frame = true;
+      if(sym == 'v') {
+        // Skip the intervals which aren't supported
+        for(unsigned i = 0; i < std::size(swap_intervals); i++) {
+          swap_interval_idx = (swap_interval_idx + 1) % std::size(swap_intervals);
+
+          if(gl_context.swapInterval(swap_intervals[swap_interval_idx])) break;
+        }
+
+        printf("swap interval: %d\n", gl_context.swapInterval());
+      }
+      if(sym == 't') {
+        trace_export_chrome("brdrive.trace.json");
+        printf("trace exported to 'brdrive.trace.json'\n");
+      }
       break;
     }
 
@@ -265,13 +767,28 @@ void main()
       break;
     }
 
+    case Event::User: {
+      auto event = (UserEvent *)ev.get();
+
+      if(event->code() == FrameDoneEventCode) {
+        printf("GPU finished frame %lu\n", (u64)event->data());
+      }
+
+      break;
+    }
+
     case Event::Quit:
       running = false;
       break;
     }
 
+    // Hand over the resources which finished loading
+    resource_loader.collect();
+
     gl_context.dbg_PushCallGroup("OSD.some_surface");
 
+    pipeline.use();
+
     glClear(GL_COLOR_BUFFER_BIT);
 
     /*
@@ -285,35 +802,94 @@ void main()
     osd_submit_drawcall(gl_context, drawcall);
     */
 
-    auto surface_drawcalls = some_surface.draw();
-    for(auto& drawcall : surface_drawcalls) {
-      osd_submit_drawcall(gl_context, drawcall);
+    TraceZone trace_frame_zone("frame");
+
+    char frame_counter[32];
+    snprintf(frame_counter, sizeof(frame_counter), "frame %lu", frame_timeline.currentFrame());
+
+    // Until the font's atlas finishes uploading
+    //   only the background gets cleared
+    if(some_surface_ready) some_surface.updateString(frame_counter_string, frame_counter);
+
+    // Only fence the frames which are actually waited on
+    if(!some_surface_ready) {
+      // Nothing to draw yet
+    } else if(use_cmdbuf) {
+      recorder
+        .record(some_surface);
+
+      if(wait_for_frame) {
+        fence_waiter.wait(recorder.submitFenced(gl_context), frame_timeline.currentFrame());
+      } else {
+        recorder.submit(gl_context);
+      }
+    } else {
+      render_queue.push(some_surface.draw(), &pipeline);
+
+      if(wait_for_frame) {
+        fence_waiter.wait(render_queue.flushFenced(gl_context), frame_timeline.currentFrame());
+      } else {
+        render_queue.flush(gl_context);
+      }
     }
+    wait_for_frame = false;
 
-    std::chrono::high_resolution_clock clock;
-    auto start = clock.now();
+    {
+      TraceZone trace_zone("swapBuffers", TraceSwap);
 
-    gl_context.swapBuffers();
-
-    auto end = clock.now();
+      gl_context.swapBuffers();
+    }
 
-    auto ms_counts = std::chrono::milliseconds(1).count(); 
+    {
+      TraceZone trace_zone("GLFrameTimeline::endFrame", TraceWait);
 
-    if(use_fence_initial != use_fence && !use_fence) {
-      printf("\nswapBuffers() without blocking on a fence took: %ldus\n\n",
-          std::chrono::duration_cast<std::chrono::microseconds>(end-start).count());
-    } else if(use_fence_initial) {
-      printf("\nswapBuffers() AFTER BLOCKING on a fence took: %ldus\n\n",
-          std::chrono::duration_cast<std::chrono::microseconds>(end-start).count());
+      frame_timeline.endFrame();
     }
 
     gl_context.dbg_PopCallGroup();
 
+    profiler.endFrame();
+
+    if(print_gpu_times) {
+      printf("\nGPU times (frame %lu):\n", profiler.latestResultsFrame());
+      for(const auto& timing : profiler.latestResults()) {
+        printf("  %*s%s: %luns\n", timing.depth*2, "", timing.name.data(), timing.gpu_ns);
+      }
+      printf("\n");
+
+      if(gl_context.presentTimingSupported()) {
+        auto present_stats = gl_context.presentStats();
+        printf("presented %lu frames (%lu vblanks missed), latency: %luus (avg. %luus)\n\n",
+            present_stats.num_presented, present_stats.num_missed,
+            present_stats.last_latency_us, present_stats.avg_latency_us);
+      }
+
+      print_gpu_times = false;
+    }
+
     if(!running) break;
   }
 
 glPopDebugGroup();
 
+  gl_context.attachProfiler(nullptr);
+
+  frame_timeline.drain();
+  resource_loader.finish();
+
+  // Pick up the GPU timings of the last frames
+  profiler.endFrame();
+
+  trace_export_chrome("brdrive.trace.json");
+
+  auto pipeline_stats = GLPipeline::stats();
+  printf("pipeline state changes: %lu applied, %lu elided\n",
+      pipeline_stats.num_applied, pipeline_stats.num_elided);
+
+  auto state_stats = gl_context.state().stats();
+  printf("binds: %lu made, %lu elided\n",
+      state_stats.num_binds, state_stats.num_elided);
+
   gl_context
     .destroy();
 
@@ -0,0 +1,267 @@
+#include <egl/egl.h>
+
+// EGL headers
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+// OpenGL/gl3w
+#include <GL/gl3w.h>
+
+#include <cassert>
+#include <cstring>
+
+// EGL_NO_CONTEXT expands to a cast to 'EGLContext', which inside
+//   of namespace brdrive refers to brdrive::EGLContext instead
+static const ::EGLContext EGL_NoContext = EGL_NO_CONTEXT;
+
+namespace brdrive {
+
+static int EGL_SurfacelessConfigAttribs[] = {
+  EGL_SURFACE_TYPE, EGL_DONT_CARE,
+  EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+
+  EGL_RED_SIZE,   8,
+  EGL_GREEN_SIZE, 8,
+  EGL_BLUE_SIZE,  8,
+  EGL_ALPHA_SIZE, 8,
+
+  EGL_NONE,
+};
+
+static int EGL_PbufferConfigAttribs[] = {
+  EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+  EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+
+  EGL_RED_SIZE,   8,
+  EGL_GREEN_SIZE, 8,
+  EGL_BLUE_SIZE,  8,
+  EGL_ALPHA_SIZE, 8,
+
+  EGL_NONE,
+};
+
+static int EGL_PbufferAttribs[] = {
+  EGL_WIDTH,  1,
+  EGL_HEIGHT, 1,
+
+  EGL_NONE,
+};
+
+// All the EGLContexts share a single EGLDisplay (contexts
+//   can only share objects when created on the same display),
+//   which is terminated along with the last context
+static EGLDisplay g_display = EGL_NO_DISPLAY;
+static unsigned g_display_refs = 0;
+
+static auto egl_has_extension(const char *extensions, const char *name) -> bool
+{
+  if(!extensions) return false;
+
+  auto name_len = strlen(name);
+  for(auto ext = strstr(extensions, name); ext; ext = strstr(ext+name_len, name)) {
+    // Make sure 'name' isn't only a prefix of another extension
+    auto ext_end = ext[name_len];
+    if(ext_end == ' ' || ext_end == '\0') return true;
+  }
+
+  return false;
+}
+
+static auto egl_acquire_display() -> EGLDisplay
+{
+  if(g_display_refs++) return g_display;
+
+  // Prefer the surfaceless platform, which doesn't require
+  //   an X server (or any other windowing system)...
+  auto client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  if(egl_has_extension(client_extensions, "EGL_MESA_platform_surfaceless")) {
+    auto eglGetPlatformDisplayEXT = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+      eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+    if(eglGetPlatformDisplayEXT) {
+      g_display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+  }
+
+  // ...and fall back to the default one (e.g. X11 on Xvfb)
+  if(g_display == EGL_NO_DISPLAY) g_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+  if(g_display == EGL_NO_DISPLAY || !eglInitialize(g_display, nullptr, nullptr)) {
+    g_display = EGL_NO_DISPLAY;
+    g_display_refs--;
+
+    throw EGLContext::NoDisplayError();
+  }
+
+  return g_display;
+}
+
+static auto egl_release_display() -> void
+{
+  assert(g_display_refs);
+
+  if(--g_display_refs) return;
+
+  eglTerminate(g_display);
+  g_display = EGL_NO_DISPLAY;
+}
+
+struct pEGLContext {
+  EGLDisplay display = EGL_NO_DISPLAY;
+
+  ::EGLContext context = EGL_NoContext;
+  EGLSurface pbuffer = EGL_NO_SURFACE;    // Only created in Pbuffer mode
+
+  ~pEGLContext();
+};
+
+pEGLContext::~pEGLContext()
+{
+  if(display == EGL_NO_DISPLAY) return;
+
+  if(pbuffer != EGL_NO_SURFACE) eglDestroySurface(display, pbuffer);
+  if(context != EGL_NoContext) eglDestroyContext(display, context);
+
+  egl_release_display();
+}
+
+EGLContext::EGLContext(Mode mode) :
+  mode_(mode),
+  p(nullptr)
+{
+}
+
+EGLContext::~EGLContext()
+{
+  delete p;
+}
+
+auto EGLContext::acquire(IWindow *window, GLContext *share) -> GLContext&
+{
+  assert(!window && "EGLContext only supports headless rendering (the 'window' must be nullptr)!");
+
+  p = new pEGLContext();
+
+  try {
+    p->display = egl_acquire_display();
+  } catch(...) {
+    delete p;
+    p = nullptr;
+
+    throw;
+  }
+
+  auto display = p->display;
+
+  auto display_extensions = eglQueryString(display, EGL_EXTENSIONS);
+  bool has_surfaceless = egl_has_extension(display_extensions, "EGL_KHR_surfaceless_context");
+
+  if(mode_ == Auto) mode_ = has_surfaceless ? Surfaceless : Pbuffer;
+
+  if(mode_ == Surfaceless && !has_surfaceless) {
+    delete p;
+    p = nullptr;
+
+    throw SurfacelessUnsupportedError();
+  }
+
+  auto cleanup_and_throw = [this](auto error) {
+    delete p;
+    p = nullptr;
+
+    throw error;
+  };
+
+  auto config_attribs = mode_ == Pbuffer ? EGL_PbufferConfigAttribs : EGL_SurfacelessConfigAttribs;
+
+  EGLConfig config = nullptr;
+  EGLint num_configs = 0;
+  if(!eglChooseConfig(display, config_attribs, &config, 1, &num_configs) || !num_configs) {
+    cleanup_and_throw(NoSuitableFramebufferConfigError());
+  }
+
+  if(!eglBindAPI(EGL_OPENGL_API)) cleanup_and_throw(AcquireError());
+
+  const EGLint context_attribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 3,
+    EGL_CONTEXT_MINOR_VERSION, 3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+
+    EGL_CONTEXT_OPENGL_FORWARD_COMPATIBLE, EGL_TRUE,
+#if !defined(NDEBUG)
+    EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE,
+#endif
+
+    EGL_NONE,
+  };
+
+  p->context = eglCreateContext(
+      display, config,
+      /* share_context */ share ? (::EGLContext)share->handle() : EGL_NoContext,
+      context_attribs
+  );
+  if(p->context == EGL_NoContext) cleanup_and_throw(AcquireError());
+
+  if(mode_ == Pbuffer) {
+    p->pbuffer = eglCreatePbufferSurface(display, config, EGL_PbufferAttribs);
+    if(p->pbuffer == EGL_NO_SURFACE) cleanup_and_throw(AcquireError());
+  }
+
+  // Mark the context as successfully acquired
+  was_acquired_ = true;
+
+  return *this;
+}
+
+auto EGLContext::makeCurrent() -> GLContext&
+{
+  assert(was_acquired_ && "the context must've been acquire()'d to makeCurrent()!");
+
+  auto success = eglMakeCurrent(p->display, p->pbuffer, p->pbuffer, p->context);
+  if(!success) throw AcquireError();
+
+  postMakeCurrentHook();
+
+  return *this;
+}
+
+auto EGLContext::swapBuffers() -> GLContext&
+{
+  assert(was_acquired_ && "the context must've been acquire()'d to swapBuffers()!");
+
+  // There's no default framebuffer to swap (a pbuffer
+  //   isn't double-buffered), but make sure the frame's
+  //   commands reach the GPU like they would on a swap
+  glFlush();
+
+  return *this;
+}
+
+auto EGLContext::destroy() -> GLContext&
+{
+  if(!p) return *this;
+
+  delete p;
+  p = nullptr;
+
+  return *this;
+}
+
+auto EGLContext::handle() -> GLContextHandle
+{
+  if(!p) return nullptr;
+
+  return p->context;
+}
+
+auto EGLContext::mode() const -> Mode
+{
+  return mode_;
+}
+
+auto EGLContext::get_proc_address(const char *name) -> GLProc
+{
+  return (GLProc)eglGetProcAddress(name);
+}
+
+}
@@ -2,6 +2,8 @@
 #include <gx/vertex.h>
 #include <gx/texture.h>
 #include <gx/context.h>
+#include <gx/state.h>
+#include <gx/dispatch.h>
 #include <gx/extensions.h>
 
 // OpenGL/gl3w
@@ -176,13 +178,7 @@ auto GLBuffer::upload(const void *data) -> GLBuffer&
   // Make sure the buffer was created with proper usage
   if(GLBufferUsage_is_static(usage_)) throw UploadToStaticBufferError();
 
-  if(ARB::direct_state_access || EXT::direct_state_access) {
-    glNamedBufferSubData(id_, 0, size_, data);
-  } else {
-    bindSelf();   // glBindBuffer(...)
-    glBufferSubData(bind_target_, 0, size_, data);
-    unbindSelf();
-  }
+  GLDispatch::current().bufferSubData(id_, bind_target_, 0, size_, data);
 
   assert(glGetError() == GL_NO_ERROR);
 
@@ -269,30 +265,14 @@ auto GLBuffer::map(u32 flags, intptr_t offset, GLSizePtr size) -> GLBufferMappin
   auto access = GLBufferMapFlags_to_GLbitfield(flags);
 
   void *ptr = nullptr;
-  if(ARB::direct_state_access || EXT::direct_state_access) {
-    if(!offset && !size) {
-      ptr = glMapNamedBufferRange(id_, 0, size_, access);
-    } else if(!size) {
-      size = size_ - offset;
+  if(!offset && !size) {
+    ptr = GLDispatch::current().mapBufferRange(id_, bind_target_, 0, size_, access);
+  } else if(!size) {
+    size = size_ - offset;
 
-      glMapNamedBufferRange(id_, offset, size, access);
-    } else {
-      glMapNamedBufferRange(id_, offset, size, access);
-    }
+    GLDispatch::current().mapBufferRange(id_, bind_target_, offset, size, access);
   } else {
-    bindSelf();
-
-    if(!offset && !size) {
-      ptr = glMapBufferRange(bind_target_, 0, size_, access);
-    } else if(!size) {
-      size = size_ - offset;
-
-      glMapBufferRange(bind_target_, offset, size, access);
-    } else {
-      glMapBufferRange(bind_target_, offset, size, access);
-    }
-
-    unbindSelf();
+    GLDispatch::current().mapBufferRange(id_, bind_target_, offset, size, access);
   }
 
   if(!ptr || (glGetError() != GL_NO_ERROR)) throw MapFailedError();
@@ -327,13 +307,7 @@ auto GLBuffer::doUnmap(MappingFriendKey, bool force) -> GLBuffer&
   //   has to be destroyed or the mapping recreated
   if(!force && (mapping.flags & MapCoherent)) return *this;
 
-  if(ARB::direct_state_access || EXT::direct_state_access) {
-    glUnmapNamedBuffer(id_);
-  } else {
-    bindSelf();
-    glUnmapBuffer(bind_target_);
-    unbindSelf();
-  }
+  GLDispatch::current().unmapBuffer(id_, bind_target_);
   assert(glGetError() == GL_NO_ERROR);
 
   // ...and clear it's related data stored
@@ -370,13 +344,7 @@ void GLBuffer::doFlushMapping(MappingFriendKey, intptr_t offset, GLSizePtr lengt
     if(mapping_coherent) return;
   }
 
-  if(ARB::direct_state_access || EXT::direct_state_access) {
-    glFlushMappedNamedBufferRange(id(), offset, length);
-  } else {
-    glBindBuffer(bindTarget(), id());
-    glFlushMappedBufferRange(bindTarget(), offset, length);
-    glBindBuffer(bindTarget(), 0);    // unbind
-  }
+  GLDispatch::current().flushMappedBufferRange(id_, bind_target_, offset, length);
 }
 
 auto GLBuffer::bindTarget() const -> GLEnum
@@ -393,12 +361,12 @@ void GLBuffer::bindSelf()
 {
   assert(id_ != GLNullId && "attempted to use a null buffer!");
 
-  glBindBuffer(bind_target_, id_);
+  GLStateTracker::current().bindBuffer(bind_target_, id_);
 }
 
 void GLBuffer::unbindSelf()
 {
-  glBindBuffer(bind_target_, 0);
+  GLStateTracker::current().bindBuffer(bind_target_, GLNullId);
 }
 
 auto GLBuffer::doDestroy() -> GLBuffer&
@@ -410,6 +378,9 @@ auto GLBuffer::doDestroy() -> GLBuffer&
 
   glDeleteBuffers(1, &id_);
 
+  // The buffer was unbound from all the targets of the current context
+  if(auto context = GLContext::current()) context->state().forgetBuffer(id_);
+
   return *this;
 }
 
@@ -470,6 +441,11 @@ GLUniformBuffer::GLUniformBuffer() :
 {
 }
 
+GLShaderStorageBuffer::GLShaderStorageBuffer() :
+  GLBuffer(GL_SHADER_STORAGE_BUFFER)
+{
+}
+
 [[using gnu: always_inline]]
 static constexpr auto XferDirection_to_bind_target(
     GLPixelBuffer::XferDirection xfer_direction
@@ -704,6 +680,16 @@ GLBufferTexture::GLBufferTexture() :
 {
 }
 
+GLDrawIndirectBuffer::GLDrawIndirectBuffer() :
+  GLBuffer(GL_DRAW_INDIRECT_BUFFER)
+{
+}
+
+static_assert(sizeof(GLDrawIndirectBuffer::DrawArraysCommand) == 4*sizeof(u32),
+    "GLDrawIndirectBuffer::DrawArraysCommand has incorrect layout!");
+static_assert(sizeof(GLDrawIndirectBuffer::DrawElementsCommand) == 5*sizeof(u32),
+    "GLDrawIndirectBuffer::DrawElementsCommand has incorrect layout!");
+
 [[using gnu: always_inline]]
 static constexpr auto GLBufferBindPointType_to_target(GLBufferBindPointType type) -> GLEnum
 {
@@ -758,6 +744,9 @@ auto GLBufferBindPoint::bind(
   }
   bound_buffer_ = bufferid;
 
+  // Both functions also bind the buffer to the generic 'target_'
+  context_->state().boundBufferIndexed(target_, bufferid);
+
   return *this;
 }
   
@@ -0,0 +1,94 @@
+#include <gx/caps.h>
+
+// OpenGL/gl3w
+#include <GL/gl3w.h>
+
+#include <cassert>
+
+namespace brdrive {
+
+// Names of the GLCaps::Extensions, in the same order
+static const char *GLCaps_ExtensionNames[GLCaps::NumExtensions] = {
+  "GL_ARB_vertex_attrib_binding",
+  "GL_ARB_separate_shader_objects",
+  "GL_ARB_tessellation_shader",
+  "GL_ARB_compute_shader",
+  "GL_ARB_texture_storage",
+  "GL_ARB_buffer_storage",
+  "GL_ARB_direct_state_access",
+  "GL_ARB_texture_filter_anisotropic",
+  "GL_ARB_multi_draw_indirect",
+  "GL_ARB_shader_draw_parameters",
+  "GL_ARB_shader_storage_buffer_object",
+  "GL_ARB_base_instance",
+
+  "GL_EXT_direct_state_access",
+  "GL_EXT_texture_filter_anisotropic",
+};
+
+auto GLCaps::query() -> GLCaps
+{
+  assert(gx_was_init() && "gx_init() must be called before querying the GLCaps!");
+
+  GLCaps caps;
+
+  int num_extensions = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+
+  caps.all_extensions_.reserve(num_extensions);
+  for(int i = 0; i < num_extensions; i++) {
+    caps.all_extensions_.emplace((const char *)glGetStringi(GL_EXTENSIONS, i));
+  }
+
+  for(unsigned i = 0; i < NumExtensions; i++) {
+    caps.extensions_[i] = caps.has(GLCaps_ExtensionNames[i]);
+  }
+
+  caps.dsa_ = caps.has(ARB_direct_state_access) || caps.has(EXT_direct_state_access);
+
+  auto get = [](GLEnum pname, int *value) {
+    glGetIntegerv(pname, value);
+  };
+
+  get(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &caps.max_texture_image_units);
+  get(GL_MAX_TEXTURE_SIZE, &caps.max_texture_size);
+  get(GL_MAX_3D_TEXTURE_SIZE, &caps.max_3d_texture_size);
+  get(GL_MAX_ARRAY_TEXTURE_LAYERS, &caps.max_array_texture_layers);
+
+  if(caps.has(ARB_texture_filter_anisotropic) || caps.has(EXT_texture_filter_anisotropic)) {
+    // Both extensions define the same enum value
+    glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &caps.max_texture_max_anisotropy);
+  }
+
+  get(GL_MAX_VERTEX_ATTRIBS, &caps.max_vertex_attribs);
+  if(caps.has(ARB_vertex_attrib_binding)) {
+    get(GL_MAX_VERTEX_ATTRIB_BINDINGS, &caps.max_vertex_attrib_bindings);
+  }
+
+  get(GL_MAX_UNIFORM_BUFFER_BINDINGS, &caps.max_uniform_buffer_bindings);
+  get(GL_MAX_UNIFORM_BLOCK_SIZE, &caps.max_uniform_block_size);
+  get(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &caps.uniform_buffer_offset_alignment);
+
+  if(caps.has(ARB_shader_storage_buffer_object)) {
+    get(GL_MAX_SHADER_STORAGE_BUFFER_BINDINGS, &caps.max_shader_storage_buffer_bindings);
+    get(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &caps.shader_storage_buffer_offset_alignment);
+  }
+
+  // The number of indexed GL_TRANSFORM_FEEDBACK_BUFFER bindings
+  get(GL_MAX_TRANSFORM_FEEDBACK_SEPARATE_ATTRIBS, &caps.max_transform_feedback_buffers);
+
+  get(GL_MAX_COLOR_ATTACHMENTS, &caps.max_color_attachments);
+  get(GL_MAX_DRAW_BUFFERS, &caps.max_draw_buffers);
+  get(GL_MAX_SAMPLES, &caps.max_samples);
+
+  assert(glGetError() == GL_NO_ERROR);
+
+  return caps;
+}
+
+auto GLCaps::has(const char *name) const -> bool
+{
+  return all_extensions_.find(name) != all_extensions_.end();
+}
+
+}
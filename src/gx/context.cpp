@@ -1,6 +1,9 @@
 #include <gx/context.h>
 #include <gx/texture.h>
 #include <gx/buffer.h>
+#include <gx/profiler.h>
+#include <gx/state.h>
+#include <gx/debuglog.h>
 
 // OpenGL/gl3w
 #include <GL/gl3w.h>
@@ -15,28 +18,15 @@ namespace brdrive {
 
 thread_local GLContext *g_current_context = nullptr;
 
-static void dbg_message_callback(
-    GLenum source, GLenum type, GLuint id, GLenum severity,
-    GLsizei length, const GLchar* message, const void* userParam
-  )
-{
-  // Discard debug group messages
-  if(source == GL_DEBUG_SOURCE_APPLICATION) return;
-
-  auto prefix = type == GL_DEBUG_TYPE_ERROR ? "** GL ERROR **" : "";
-
-  fprintf(stderr,
-    "OpenGL: %s type = 0x%x, severity = 0x%x, message = %s\n",
-    prefix, type, severity, message
-  );
-}
-
 GLContext::GLContext() :
   was_acquired_(false),
   tex_image_units_(nullptr),
-  active_texture_(0),
   buffer_bind_points_(nullptr),
-  dbg_group_id_(1)
+  dbg_group_id_(1),
+  state_(new GLStateTracker()),
+  caps_queried_(false),
+  dispatch_(),
+  profiler_(nullptr)
 {
   // Allocate backing memory via malloc() because GLTexImageUnit's constructor requires
   //   an argument and new[] doesn't support passing per-instance args
@@ -83,6 +73,8 @@ GLContext::~GLContext()
   }
 
   free(buffer_bind_points_);
+
+  delete state_;
 }
 
 auto GLContext::current() -> GLContext *
@@ -90,7 +82,7 @@ auto GLContext::current() -> GLContext *
   return g_current_context;
 }
 
-auto GLContext::dbg_EnableMessages() -> GLContext&
+auto GLContext::dbg_EnableMessages(DebugOutput output, GLDebugLog *log) -> GLContext&
 {
 #if !defined(NDEBUG)
   int context_flags = -1;
@@ -98,11 +90,17 @@ auto GLContext::dbg_EnableMessages() -> GLContext&
 
   if(!(context_flags & GL_CONTEXT_FLAG_DEBUG_BIT)) throw NotADebugContextError();
 
+  if(!log) log = &GLDebugLog::global();
+
   // Enable debug output
   glEnable(GL_DEBUG_OUTPUT);
-  glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+  if(output == DebugOutputSync) {
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+  } else {
+    glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+  }
 
-  glDebugMessageCallback(dbg_message_callback, nullptr);
+  glDebugMessageCallback(GLDebugLog::callback, log);
 #endif
 
   return *this;
@@ -115,6 +113,8 @@ auto GLContext::dbg_PushCallGroup(const char *name) -> GLContext&
   dbg_group_id_++;
 #endif
 
+  if(profiler_) profiler_->pushGroup(name);
+
   return *this;
 }
 
@@ -124,9 +124,23 @@ auto GLContext::dbg_PopCallGroup() -> GLContext&
   glPopDebugGroup();
 #endif
 
+  if(profiler_) profiler_->popGroup();
+
   return *this;
 }
 
+auto GLContext::attachProfiler(GLProfiler *profiler) -> GLContext&
+{
+  profiler_ = profiler;
+
+  return *this;
+}
+
+auto GLContext::profiler() const -> GLProfiler *
+{
+  return profiler_;
+}
+
 auto GLContext::versionString() -> std::string
 {
   assert(gx_was_init() && "gx_init() must be called before using this method!");
@@ -146,17 +160,38 @@ auto GLContext::version() -> GLVersion
   return version;
 }
 
+auto GLContext::caps() const -> const GLCaps&
+{
+  assert(caps_queried_ && "gx_init() must be called before using this method!");
+
+  return caps_;
+}
+
+auto GLContext::dispatch() const -> const GLDispatch&
+{
+  assert(caps_queried_ && "gx_init() must be called before using this method!");
+
+  return dispatch_;
+}
+
 auto GLContext::texImageUnit(unsigned slot) -> GLTexImageUnit&
 {
   assert(was_acquired_ && "the context must've been acquire()'d to use it's texImageUnits!");
   assert(slot < GLNumTexImageUnits && "'slot' must be < GLNumTexImageUnits!");
+  assert((int)slot < caps().max_texture_image_units &&
+      "'slot' must be < GLCaps::max_texture_image_units!");
 
   return tex_image_units_[slot];
 }
 
+auto GLContext::state() -> GLStateTracker&
+{
+  return *state_;
+}
+
 auto GLContext::activeTexture() const -> unsigned
 {
-  return active_texture_;
+  return state_->activeTextureSlot();
 }
 
 auto GLContext::bufferBindPoint(
@@ -166,6 +201,17 @@ auto GLContext::bufferBindPoint(
   assert(was_acquired_ && "the context must've been acquire()'d to use it's texImageUnits!");
   assert((unsigned)bind_point < GLBufferBindPointType::NumTypes && "'bind_point' is invalid!");
   assert(index < GLNumBufferBindPoints && "'index' must be < GLNumBufferBindPoints!");
+  assert([&]() {
+    switch(bind_point) {
+    case UniformType:       return (int)index < caps().max_uniform_buffer_bindings;
+    case ShaderStorageType: return (int)index < caps().max_shader_storage_buffer_bindings;
+    case XformFeedbackType: return (int)index < caps().max_transform_feedback_buffers;
+
+    default: ;    // Fallthrough
+    }
+
+    return false;
+  }() && "'index' exceeds the GLCaps limit of the 'bind_point'!");
 
   return buffer_bind_points_[bind_point*GLNumBufferBindPoints + index];
 }
@@ -173,6 +219,18 @@ auto GLContext::bufferBindPoint(
 void GLContext::postMakeCurrentHook()
 {
   g_current_context = this;
+
+  // Contexts made current before gx_init() get
+  //   their GLCaps queried by gx_init() itself
+  if(!caps_queried_ && gx_was_init()) queryCaps();
+}
+
+void GLContext::queryCaps()
+{
+  caps_ = GLCaps::query();
+  dispatch_ = GLDispatch::select(caps_);
+
+  caps_queried_ = true;
 }
 
 }
@@ -0,0 +1,278 @@
+#include <gx/debuglog.h>
+
+#include <util/trace.h>
+
+// OpenGL/gl3w
+#include <GL/gl3w.h>
+
+#include <cassert>
+#include <cstring>
+
+#include <algorithm>
+#include <chrono>
+
+namespace brdrive {
+
+// How often the logging thread checks the ring for new messages
+static constexpr auto LoggerPollInterval = std::chrono::milliseconds(10);
+
+// Number of consecutive empty polls after which the repeat
+//   count of the last message is printed (if it's non-zero)
+static constexpr unsigned LoggerIdlePollsBeforeRepeats = 100;
+
+static_assert((GLDebugLog::RingSize & (GLDebugLog::RingSize-1)) == 0,
+    "GLDebugLog::RingSize must be a power of 2!");
+static_assert((GLDebugLog::RateTableSize & (GLDebugLog::RateTableSize-1)) == 0,
+    "GLDebugLog::RateTableSize must be a power of 2!");
+
+GLDebugLog::GLDebugLog(FILE *out, u32 rate_limit) :
+  out_(out), rate_limit_(rate_limit),
+  write_pos_(0),
+  num_rate_limited_(0), num_dropped_(0),
+  quit_(false),
+  read_pos_(0),
+  last_source_(0), last_type_(0), last_id_(0), last_repeats_(0),
+  reported_rate_limited_(0), reported_dropped_(0),
+  num_logged_(0), num_repeated_(0)
+{
+  for(u32 i = 0; i < RingSize; i++) {
+    ring_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  for(auto& entry : rates_) {
+    entry.key.store(~0ull, std::memory_order_relaxed);
+    entry.second.store(0, std::memory_order_relaxed);
+    entry.count.store(0, std::memory_order_relaxed);
+  }
+
+  last_message_.fill('\0');
+
+  logger_ = std::thread(&GLDebugLog::loggerMain, this);
+}
+
+GLDebugLog::~GLDebugLog()
+{
+  {
+    std::lock_guard<std::mutex> lock(drain_mutex_);
+    quit_ = true;
+  }
+  quit_requested_.notify_one();
+
+  // The logging thread prints out whatever is left before exiting
+  logger_.join();
+}
+
+auto GLDebugLog::global() -> GLDebugLog&
+{
+  static GLDebugLog log;
+
+  return log;
+}
+
+void GLDebugLog::callback(
+    GLEnum source, GLEnum type, GLId id, GLEnum severity,
+    GLSize length, const char *message, const void *user
+  )
+{
+  // Discard debug group messages
+  if(source == GL_DEBUG_SOURCE_APPLICATION) return;
+
+  auto self = (GLDebugLog *)user;
+  if(!self->admit(source, id)) return;
+
+  self->push(source, type, id, severity, length, message);
+}
+
+auto GLDebugLog::flush() -> GLDebugLog&
+{
+  std::lock_guard<std::mutex> lock(drain_mutex_);
+
+  drain();
+  printRepeats();
+
+  fflush(out_);
+
+  return *this;
+}
+
+auto GLDebugLog::stats() const -> Stats
+{
+  return Stats {
+    num_logged_.load(), num_repeated_.load(),
+    num_rate_limited_.load(), num_dropped_.load(),
+  };
+}
+
+auto GLDebugLog::admit(GLEnum source, GLId id) -> bool
+{
+  using namespace std::chrono;
+
+  auto key = ((u64)source << 32) | id;
+  auto second = (u64)duration_cast<seconds>(steady_clock::now().time_since_epoch()).count();
+
+  // Fibonacci hashing spreads the (usually small and
+  //   sequential) ids over the whole table
+  auto hash = (key * 0x9E3779B97F4A7C15ull) >> 32;
+  auto& entry = rates_[hash & (RateTableSize-1)];
+
+  // When many threads race on the same entry at the start
+  //   of a second a few extra messages can get through, which
+  //   is fine - all that matters is the log can't be flooded
+  if(entry.key.load(std::memory_order_relaxed) != key ||
+      entry.second.load(std::memory_order_relaxed) != second) {
+    entry.key.store(key, std::memory_order_relaxed);
+    entry.second.store(second, std::memory_order_relaxed);
+    entry.count.store(0, std::memory_order_relaxed);
+  }
+
+  if(entry.count.fetch_add(1, std::memory_order_relaxed) < rate_limit_) return true;
+
+  num_rate_limited_.fetch_add(1, std::memory_order_relaxed);
+
+  return false;
+}
+
+auto GLDebugLog::push(
+    GLEnum source, GLEnum type, GLId id, GLEnum severity,
+    GLSize length, const char *message
+  ) -> void
+{
+  // Claim a free slot - a bounded multi-producer queue where
+  //   each slot's 'sequence' says whether it can be written to
+  auto pos = write_pos_.load(std::memory_order_relaxed);
+  Message *msg = nullptr;
+  while(true) {
+    msg = &ring_[pos & (RingSize-1)];
+
+    auto sequence = msg->sequence.load(std::memory_order_acquire);
+    auto diff = (i64)sequence - (i64)pos;
+
+    if(!diff) {
+      // The slot is free - try to claim it
+      if(write_pos_.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) break;
+    } else if(diff < 0) {
+      // The slot still holds a message which wasn't
+      //   drained yet i.e. the ring is full
+      num_dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      // Another thread claimed the slot in the meantime
+      pos = write_pos_.load(std::memory_order_relaxed);
+    }
+  }
+
+  msg->source = source;
+  msg->type = type;
+  msg->id = id;
+  msg->severity = severity;
+
+  // 'length' can be negative, in which case 'message' is null-terminated
+  size_t message_len = length >= 0 ? (size_t)length : strlen(message);
+  message_len = std::min<size_t>(message_len, MaxMessageLength-1);
+
+  memcpy(msg->message, message, message_len);
+  msg->message[message_len] = '\0';
+
+  // Publish the message to the logging thread
+  msg->sequence.store(pos+1, std::memory_order_release);
+}
+
+auto GLDebugLog::drain() -> unsigned
+{
+  unsigned num_drained = 0;
+  while(true) {
+    auto& msg = ring_[read_pos_ & (RingSize-1)];
+    if(msg.sequence.load(std::memory_order_acquire) != read_pos_+1) break;
+
+    bool repeat = msg.source == last_source_ && msg.type == last_type_ && msg.id == last_id_ &&
+      !strcmp(msg.message, last_message_.data());
+
+    if(repeat) {
+      last_repeats_++;
+      num_repeated_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      printRepeats();
+      print(msg);
+    }
+
+    // Hand the slot back to the producers for the next lap of the ring
+    msg.sequence.store(read_pos_ + RingSize, std::memory_order_release);
+    read_pos_++;
+
+    num_drained++;
+  }
+
+  // Report the messages which never made it into the ring
+  auto num_dropped = num_dropped_.load(std::memory_order_relaxed);
+  if(num_dropped != reported_dropped_) {
+    fprintf(out_, "OpenGL: %lu message(s) dropped (the log's ring buffer was full)\n",
+        num_dropped - reported_dropped_);
+
+    reported_dropped_ = num_dropped;
+  }
+
+  auto num_rate_limited = num_rate_limited_.load(std::memory_order_relaxed);
+  if(num_rate_limited != reported_rate_limited_) {
+    fprintf(out_, "OpenGL: %lu message(s) suppressed (over %u/s with the same id)\n",
+        num_rate_limited - reported_rate_limited_, rate_limit_);
+
+    reported_rate_limited_ = num_rate_limited;
+  }
+
+  return num_drained;
+}
+
+auto GLDebugLog::print(const Message& msg) -> void
+{
+  auto prefix = msg.type == GL_DEBUG_TYPE_ERROR ? "** GL ERROR **" : "";
+
+  fprintf(out_,
+    "OpenGL: %s type = 0x%x, severity = 0x%x, id = %u, message = %s\n",
+    prefix, msg.type, msg.severity, msg.id, msg.message
+  );
+
+  last_source_ = msg.source;
+  last_type_ = msg.type;
+  last_id_ = msg.id;
+  strcpy(last_message_.data(), msg.message);
+
+  num_logged_.fetch_add(1, std::memory_order_relaxed);
+}
+
+auto GLDebugLog::printRepeats() -> void
+{
+  if(!last_repeats_) return;
+
+  fprintf(out_, "OpenGL: (the last message was repeated %lu more time(s))\n", last_repeats_);
+
+  last_repeats_ = 0;
+}
+
+void GLDebugLog::loggerMain()
+{
+  trace_thread_name("GLDebugLog");
+
+  unsigned idle_polls = 0;
+
+  std::unique_lock<std::mutex> lock(drain_mutex_);
+  while(true) {
+    quit_requested_.wait_for(lock, LoggerPollInterval, [this]() { return quit_; });
+
+    if(drain()) {
+      idle_polls = 0;
+    } else if(++idle_polls == LoggerIdlePollsBeforeRepeats) {
+      // Don't hold on to the repeat count forever when
+      //   the messages stop coming in
+      printRepeats();
+    }
+
+    fflush(out_);
+
+    if(quit_) break;
+  }
+
+  printRepeats();
+  fflush(out_);
+}
+
+}
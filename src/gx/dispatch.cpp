@@ -0,0 +1,225 @@
+#include <gx/dispatch.h>
+#include <gx/caps.h>
+#include <gx/context.h>
+#include <gx/state.h>
+#include <gx/texture.h>
+
+// OpenGL/gl3w
+#include <GL/gl3w.h>
+
+#include <cassert>
+
+namespace brdrive {
+
+// Direct state access implementations
+namespace dsa {
+
+static void bufferSubData(GLId buffer, GLEnum, intptr_t offset, GLSizePtr size, const void *data)
+{
+  glNamedBufferSubData(buffer, offset, size, data);
+}
+
+static auto mapBufferRange(GLId buffer, GLEnum, intptr_t offset, GLSizePtr size, u32 access) -> void *
+{
+  return glMapNamedBufferRange(buffer, offset, size, access);
+}
+
+static void unmapBuffer(GLId buffer, GLEnum)
+{
+  glUnmapNamedBuffer(buffer);
+}
+
+static void flushMappedBufferRange(GLId buffer, GLEnum, intptr_t offset, GLSizePtr length)
+{
+  glFlushMappedNamedBufferRange(buffer, offset, length);
+}
+
+static void bindTextureUnit(unsigned unit, GLEnum, GLId texture)
+{
+  glBindTextureUnit(unit, texture);
+}
+
+static void textureSubImage2D(
+    GLId texture, unsigned level, unsigned width, unsigned height,
+    GLEnum format, GLEnum type, const void *data
+  )
+{
+  glTextureSubImage2D(texture, level, 0, 0, width, height, format, type, data);
+}
+
+}
+
+// glProgramUniform*() implementations - available with
+//   either direct state access or separate shader objects
+namespace program_uniform {
+
+static void programUniform1i(GLId program, int location, int i)
+{
+  glProgramUniform1i(program, location, i);
+}
+
+static void programUniform1f(GLId program, int location, float f)
+{
+  glProgramUniform1f(program, location, f);
+}
+
+static void programUniform2f(GLId program, int location, float x, float y)
+{
+  glProgramUniform2f(program, location, x, y);
+}
+
+static void programUniform3f(GLId program, int location, float x, float y, float z)
+{
+  glProgramUniform3f(program, location, x, y, z);
+}
+
+static void programUniformMatrix4fv(
+    GLId program, int location, GLSize count, bool transpose, const float *value
+  )
+{
+  glProgramUniformMatrix4fv(program, location, count, transpose, value);
+}
+
+}
+
+// Bind-to-edit implementations
+//  - Buffers are unbound afterwards, as leaving ones bound to
+//    e.g. GL_PIXEL_UNPACK_BUFFER alters the meaning of other calls
+namespace bind_to_edit {
+
+static void bufferSubData(GLId buffer, GLEnum target, intptr_t offset, GLSizePtr size, const void *data)
+{
+  GLStateTracker::current().bindBuffer(target, buffer);
+  glBufferSubData(target, offset, size, data);
+  GLStateTracker::current().bindBuffer(target, GLNullId);
+}
+
+static auto mapBufferRange(GLId buffer, GLEnum target, intptr_t offset, GLSizePtr size, u32 access) -> void *
+{
+  auto& state = GLStateTracker::current();
+
+  state.bindBuffer(target, buffer);
+  auto ptr = glMapBufferRange(target, offset, size, access);
+  state.bindBuffer(target, GLNullId);
+
+  return ptr;
+}
+
+static void unmapBuffer(GLId buffer, GLEnum target)
+{
+  GLStateTracker::current().bindBuffer(target, buffer);
+  glUnmapBuffer(target);
+  GLStateTracker::current().bindBuffer(target, GLNullId);
+}
+
+static void flushMappedBufferRange(GLId buffer, GLEnum target, intptr_t offset, GLSizePtr length)
+{
+  GLStateTracker::current().bindBuffer(target, buffer);
+  glFlushMappedBufferRange(target, offset, length);
+  GLStateTracker::current().bindBuffer(target, GLNullId);
+}
+
+static void bindTextureUnit(unsigned unit, GLEnum target, GLId texture)
+{
+  GLStateTracker::current().activeTexture(unit);
+  glBindTexture(target, texture);
+}
+
+static void textureSubImage2D(
+    GLId texture, unsigned level, unsigned width, unsigned height,
+    GLEnum format, GLEnum type, const void *data
+  )
+{
+  auto context = GLContext::current();
+  assert(context);
+
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, format, type, data);
+
+  // Restore the texture which the GLTexImageUnit thinks is bound
+  auto& tex_unit = context->texImageUnit(context->activeTexture());
+  glBindTexture(GL_TEXTURE_2D, tex_unit.boundTexture());
+}
+
+static void programUniform1i(GLId program, int location, int i)
+{
+  GLStateTracker::current().useProgram(program);
+  glUniform1i(location, i);
+}
+
+static void programUniform1f(GLId program, int location, float f)
+{
+  GLStateTracker::current().useProgram(program);
+  glUniform1f(location, f);
+}
+
+static void programUniform2f(GLId program, int location, float x, float y)
+{
+  GLStateTracker::current().useProgram(program);
+  glUniform2f(location, x, y);
+}
+
+static void programUniform3f(GLId program, int location, float x, float y, float z)
+{
+  GLStateTracker::current().useProgram(program);
+  glUniform3f(location, x, y, z);
+}
+
+static void programUniformMatrix4fv(
+    GLId program, int location, GLSize count, bool transpose, const float *value
+  )
+{
+  GLStateTracker::current().useProgram(program);
+  glUniformMatrix4fv(location, count, transpose, value);
+}
+
+}
+
+auto GLDispatch::current() -> const GLDispatch&
+{
+  auto context = GLContext::current();
+  assert(context && "attempted to use the GLDispatch without a current GLContext!");
+
+  return context->dispatch();
+}
+
+auto GLDispatch::select(const GLCaps& caps) -> GLDispatch
+{
+  GLDispatch dispatch;
+
+  if(caps.directStateAccess()) {
+    dispatch.bufferSubData = dsa::bufferSubData;
+    dispatch.mapBufferRange = dsa::mapBufferRange;
+    dispatch.unmapBuffer = dsa::unmapBuffer;
+    dispatch.flushMappedBufferRange = dsa::flushMappedBufferRange;
+
+    dispatch.bindTextureUnit = dsa::bindTextureUnit;
+    dispatch.textureSubImage2D = dsa::textureSubImage2D;
+  } else {
+    dispatch.bufferSubData = bind_to_edit::bufferSubData;
+    dispatch.mapBufferRange = bind_to_edit::mapBufferRange;
+    dispatch.unmapBuffer = bind_to_edit::unmapBuffer;
+    dispatch.flushMappedBufferRange = bind_to_edit::flushMappedBufferRange;
+
+    dispatch.bindTextureUnit = bind_to_edit::bindTextureUnit;
+    dispatch.textureSubImage2D = bind_to_edit::textureSubImage2D;
+  }
+
+  if(caps.directStateAccess() || caps.has(GLCaps::ARB_separate_shader_objects)) {
+    dispatch.programUniform1i = program_uniform::programUniform1i;
+    dispatch.programUniform1f = program_uniform::programUniform1f;
+    dispatch.programUniform2f = program_uniform::programUniform2f;
+    dispatch.programUniform3f = program_uniform::programUniform3f;
+    dispatch.programUniformMatrix4fv = program_uniform::programUniformMatrix4fv;
+  } else {
+    dispatch.programUniform1i = bind_to_edit::programUniform1i;
+    dispatch.programUniform1f = bind_to_edit::programUniform1f;
+    dispatch.programUniform2f = bind_to_edit::programUniform2f;
+    dispatch.programUniform3f = bind_to_edit::programUniform3f;
+    dispatch.programUniformMatrix4fv = bind_to_edit::programUniformMatrix4fv;
+  }
+
+  return dispatch;
+}
+
+}
@@ -1,70 +1,40 @@
 #include <gx/extensions.h>
-
-// OpenGL/gl3w
-#include <GL/gl3w.h>
-
-#include <unordered_set>
-#include <string_view>
-#include <utility>
+#include <gx/context.h>
 
 #include <cassert>
 
 namespace brdrive {
 
-// 'g_num_extensions' and 'g_extension' are lazy-initialized
-//   by queryExtension(), since the required data can only
-//   be queried after acquiring a GLContext and querying
-//   for GL function's pointers (which is gx_init()'s
-//   responsibility)
-thread_local int g_num_extensions = -1;
-thread_local std::unordered_set<std::string_view> g_extensions;
-
-auto queryExtension(const char *name) -> bool
+// The extensions are queried only once per-context (see the
+//   comment above GLCaps), so both queryExtension() and the
+//   CachedExtensionQueries only need to look them up
+static auto current_caps() -> const GLCaps&
 {
   assert(gx_was_init() && "gx_init() must be called before this function can be used!");
 
-  [[using gnu: cold]] 
-  if(g_num_extensions < 0) {    // Need to initialize the 'g_extensions' set
-    glGetIntegerv(GL_NUM_EXTENSIONS, &g_num_extensions);
-    assert(g_num_extensions >= 0);
-
-    for(int i = 0; i < g_num_extensions; i++) {
-      std::string_view extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
-      g_extensions.emplace(extension);
-    }
-  }
+  auto context = GLContext::current();
+  assert(context && "extensions can only be queried with a current GLContext!");
 
-  return g_extensions.find(name) != g_extensions.end();
+  return context->caps();
 }
 
-// - 'ext' initially has a value < 0 to indicate it hasn't
-//   been initialized yet
-// - Otherwise, if 'ext' >= 0 it's value interpreted as a
-//   boolean indicates the avilability of the extension
-inline auto query_extension_cached(const char *name, int *ext) -> bool
+auto queryExtension(const char *name) -> bool
 {
-  // HOT path - the avilability of the extension has already been cached
-  [[using gnu: hot]] if(*ext >= 0) return *ext;
-
-  // Need to query 'g_extensions'
-  return *ext = queryExtension(name);
+  return current_caps().has(name);
 }
 
 namespace extensions_detail {
 
-// Defined here to avoid exposing query_extension_cached() in extensions.h
-auto CachedExtensionQuery::operator()() -> bool
+auto CachedExtensionQuery::operator()() const -> bool
 {
-  return query_extension_cached(extension_, &query_result_);
+  return current_caps().has(extension_);
 }
 
 }
 
-#define STRINGIFIED(str) #str
-
 namespace ARB {
 #define DEFINE_ARB_ExtensionQuery(name) \
-  thread_local extensions_detail::CachedExtensionQuery name("GL_ARB_" STRINGIFIED(name));
+  const extensions_detail::CachedExtensionQuery name(GLCaps::ARB_##name);
 
 DEFINE_ARB_ExtensionQuery(vertex_attrib_binding);
 DEFINE_ARB_ExtensionQuery(separate_shader_objects);
@@ -74,13 +44,17 @@ DEFINE_ARB_ExtensionQuery(texture_storage);
 DEFINE_ARB_ExtensionQuery(buffer_storage);
 DEFINE_ARB_ExtensionQuery(direct_state_access);
 DEFINE_ARB_ExtensionQuery(texture_filter_anisotropic);
+DEFINE_ARB_ExtensionQuery(multi_draw_indirect);
+DEFINE_ARB_ExtensionQuery(shader_draw_parameters);
+DEFINE_ARB_ExtensionQuery(shader_storage_buffer_object);
+DEFINE_ARB_ExtensionQuery(base_instance);
 
 #undef DEFINE_ARB_ExtensionQuery
 }
 
 namespace EXT {
 #define DEFINE_EXT_ExtensionQuery(name) \
-  thread_local extensions_detail::CachedExtensionQuery name("GL_EXT_" STRINGIFIED(name));
+  const extensions_detail::CachedExtensionQuery name(GLCaps::EXT_##name);
 
 DEFINE_EXT_ExtensionQuery(direct_state_access);
 DEFINE_EXT_ExtensionQuery(texture_filter_anisotropic);
@@ -88,6 +62,4 @@ DEFINE_EXT_ExtensionQuery(texture_filter_anisotropic);
 #undef DEFINE_EXT_ExtensionQuery
 }
 
-#undef STRINGIFIED
-
 }
@@ -51,11 +51,32 @@ auto GLFence::operator=(GLFence&& other) -> GLFence&
 
 auto GLFence::fence() -> GLFence&
 {
+  // Make sure the old fence doesn't leak
+  if(sync_) glDeleteSync((GLsync)sync_);
+
   sync_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  flushed_ = false;
+
+  return *this;
+}
+
+auto GLFence::reset() -> GLFence&
+{
+  if(!sync_) return *this;
+
+  glDeleteSync((GLsync)sync_);
+
+  sync_ = nullptr;
+  flushed_ = false;
 
   return *this;
 }
 
+auto GLFence::fenced() const -> bool
+{
+  return sync_;
+}
+
 auto GLFence::block(u64 timeout) -> WaitStatus
 {
   assert(sync_ && "attempted to block() on a null fence!");
@@ -91,6 +112,18 @@ auto GLFence::sync(u64 timeout) -> GLFence&
   return *this;
 }
 
+auto GLFence::flush() -> GLFence&
+{
+  assert(sync_ && "attempted to flush() a null fence!");
+
+  if(flushed_) return *this;
+
+  glFlush();
+  flushed_ = true;
+
+  return *this;
+}
+
 auto GLFence::signaled() -> bool
 {
   // A null fence is always considered unsignaled
@@ -130,4 +163,27 @@ auto GLFence::label(const char *name) -> GLFence&
   return *this;
 }
 
+auto GLFencePool::acquire() -> GLFence&
+{
+  if(free_.empty()) return fences_.emplace_back();
+
+  auto fence = free_.back();
+  free_.pop_back();
+
+  return *fence;
+}
+
+auto GLFencePool::release(GLFence& fence) -> GLFencePool&
+{
+  fence.reset();
+  free_.push_back(&fence);
+
+  return *this;
+}
+
+auto GLFencePool::size() const -> size_t
+{
+  return fences_.size();
+}
+
 }
@@ -0,0 +1,181 @@
+#include <gx/framebuffer.h>
+#include <gx/extensions.h>
+#include <gx/texture.h>
+#include <gx/context.h>
+#include <gx/state.h>
+
+// OpenGL/gl3w
+#include <GL/gl3w.h>
+
+#include <cassert>
+
+#include <array>
+#include <utility>
+
+namespace brdrive {
+
+[[using gnu: always_inline]]
+static constexpr auto framebuffer_status_to_Status(GLEnum status) -> GLFramebuffer::Status
+{
+  switch(status) {
+  case GL_FRAMEBUFFER_COMPLETE:                      return GLFramebuffer::Complete;
+  case GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT:         return GLFramebuffer::IncompleteAttachment;
+  case GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT: return GLFramebuffer::IncompleteMissingAttachment;
+  case GL_FRAMEBUFFER_UNSUPPORTED:                   return GLFramebuffer::Unsupported;
+
+  case 0: return GLFramebuffer::StatusInvalid;    // An error occured
+
+  default: ;    // Fallthrough
+  }
+
+  return GLFramebuffer::IncompleteOther;
+}
+
+GLFramebuffer::GLFramebuffer() :
+  GLObject(GL_FRAMEBUFFER),
+  color_attachments_(0),
+  status_(StatusInvalid)
+{
+}
+
+GLFramebuffer::GLFramebuffer(GLFramebuffer&& other) :
+  GLFramebuffer()
+{
+  other.swap(*this);
+}
+
+GLFramebuffer::~GLFramebuffer()
+{
+  GLFramebuffer::doDestroy();
+}
+
+auto GLFramebuffer::operator=(GLFramebuffer&& other) -> GLFramebuffer&
+{
+  destroy();
+  other.swap(*this);
+
+  return *this;
+}
+
+auto GLFramebuffer::color(unsigned index, GLTexture2D& tex, unsigned level) -> GLFramebuffer&
+{
+  assert(index < MaxColorAttachments);
+  assert(tex.id() != GLNullId && "the texture must be alloc()'ed before attaching it!");
+
+  initGLObject();
+
+  color_attachments_ |= 1u<<index;
+  status_ = StatusInvalid;
+
+  // Draw buffers are assigned in the order of the attachment indices
+  std::array<GLenum, MaxColorAttachments> draw_buffers;
+  GLSize num_draw_buffers = 0;
+  for(unsigned i = 0; i < MaxColorAttachments; i++) {
+    if(!(color_attachments_ & (1u<<i))) continue;
+
+    draw_buffers[num_draw_buffers++] = GL_COLOR_ATTACHMENT0 + i;
+  }
+
+  if(ARB::direct_state_access) {
+    glNamedFramebufferTexture(id_, GL_COLOR_ATTACHMENT0 + index, tex.id(), level);
+    glNamedFramebufferDrawBuffers(id_, num_draw_buffers, draw_buffers.data());
+  } else {
+    // Save the current binding for future retrieval
+    int bound_framebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &bound_framebuffer);
+
+    auto& state = GLStateTracker::current();
+    state.bindFramebuffer(GL_DRAW_FRAMEBUFFER, id_);
+    glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + index, tex.id(), level);
+    glDrawBuffers(num_draw_buffers, draw_buffers.data());
+
+    state.bindFramebuffer(GL_DRAW_FRAMEBUFFER, bound_framebuffer);
+  }
+
+  assert(glGetError() == GL_NO_ERROR);
+
+  return *this;
+}
+
+auto GLFramebuffer::status() -> Status
+{
+  if(status_ != StatusInvalid) return status_;
+
+  initGLObject();
+
+  GLEnum status = 0;
+  if(ARB::direct_state_access) {
+    status = glCheckNamedFramebufferStatus(id_, GL_DRAW_FRAMEBUFFER);
+  } else {
+    int bound_framebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &bound_framebuffer);
+
+    auto& state = GLStateTracker::current();
+    state.bindFramebuffer(GL_DRAW_FRAMEBUFFER, id_);
+    status = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER);
+
+    state.bindFramebuffer(GL_DRAW_FRAMEBUFFER, bound_framebuffer);
+  }
+
+  status_ = framebuffer_status_to_Status(status);
+
+  return status_;
+}
+
+auto GLFramebuffer::use() -> GLFramebuffer&
+{
+  if(status() != Complete) throw IncompleteError();
+
+  GLStateTracker::current().bindFramebuffer(GL_FRAMEBUFFER, id_);
+
+  return *this;
+}
+
+auto GLFramebuffer::use_default() -> void
+{
+  GLStateTracker::current().bindFramebuffer(GL_FRAMEBUFFER, GLNullId);
+}
+
+auto GLFramebuffer::swap(GLFramebuffer& other) -> GLFramebuffer&
+{
+  other.GLObject::swap(*this);
+
+  std::swap(color_attachments_, other.color_attachments_);
+  std::swap(status_, other.status_);
+
+  return *this;
+}
+
+auto GLFramebuffer::doDestroy() -> GLObject&
+{
+  if(id_ == GLNullId) return *this;
+
+  glDeleteFramebuffers(1, &id_);
+  if(auto context = GLContext::current()) context->state().forgetFramebuffer(id_);
+
+  id_ = GLNullId;
+
+  return *this;
+}
+
+void GLFramebuffer::initGLObject()
+{
+  if(id_ != GLNullId) return;
+
+  if(ARB::direct_state_access) {
+    glCreateFramebuffers(1, &id_);
+  } else {
+    glGenFramebuffers(1, &id_);
+
+    // Framebuffer names only become objects once they're bound,
+    //   which glObjectLabel() (GLObject::label()) relies on
+    int bound_framebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &bound_framebuffer);
+
+    auto& state = GLStateTracker::current();
+    state.bindFramebuffer(GL_DRAW_FRAMEBUFFER, id_);
+    state.bindFramebuffer(GL_DRAW_FRAMEBUFFER, bound_framebuffer);
+  }
+}
+
+}
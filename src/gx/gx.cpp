@@ -1,4 +1,6 @@
 #include <gx/gx.h>
+#include <gx/context.h>
+#include <gx/state.h>
 
 // OpenGL/gl3w
 #include <GL/gl3w.h>
@@ -10,27 +12,33 @@ namespace brdrive {
 bool g_gx_was_init = false;
 GLId g_null_vao = GLNullId;
 
-void gx_init()
+void gx_init(GLGetProcAddressFn get_proc_address)
 {
-  auto result = gl3wInit();
+  auto result = get_proc_address ?
+    gl3wInit2((GL3WGetProcAddressProc)get_proc_address) : gl3wInit();
   if(result != GL3W_OK) {
     printf("gl3wInit(): %d\n", result);
 
     throw GL3WInitError();
   }
 
+  g_gx_was_init = true;
+
+  auto context = GLContext::current();
+  assert(context && "gx_init() must be called with a current GLContext!");
+
+  context->queryCaps();
+
   glCreateVertexArrays(1, &g_null_vao);
-  glBindVertexArray(g_null_vao);
+  GLStateTracker::current().bindVertexArray(g_null_vao);
   glObjectLabel(GL_VERTEX_ARRAY, g_null_vao, -1, "a.Global.Null");
 
   assert(glGetError() == GL_NO_ERROR);
-
-  g_gx_was_init = true;
 }
 
 void gx_finalize()
 {
-  glBindVertexArray(0);
+  GLStateTracker::current().bindVertexArray(GLNullId);
   glDeleteVertexArrays(1, &g_null_vao);
 
   g_gx_was_init = false;
@@ -0,0 +1,156 @@
+#include <gx/loader.h>
+#include <gx/context.h>
+
+#include <util/trace.h>
+
+#include <cassert>
+
+#include <utility>
+
+namespace brdrive {
+
+GLResourceLoader::GLResourceLoader(GLContext& context) :
+  context_(context),
+  quit_(false),
+  num_pending_(0)
+{
+  worker_ = std::thread(&GLResourceLoader::workerMain, this);
+}
+
+GLResourceLoader::~GLResourceLoader()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+  }
+  load_available_.notify_one();
+
+  worker_.join();
+
+  // Loads which never got to run are discarded along with the
+  //   objects owned by their LoadFns/DoneFns, the fences of those
+  //   which did get deleted in the context of the calling thread
+}
+
+auto GLResourceLoader::load(LoadFn load_fn, DoneFn done_fn) -> GLResourceLoader&
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    queue_.push_back(Load {
+        std::move(load_fn), std::move(done_fn),
+        GLFence(), nullptr,
+    });
+  }
+  num_pending_++;
+
+  load_available_.notify_one();
+
+  return *this;
+}
+
+auto GLResourceLoader::collect() -> unsigned
+{
+  unsigned num_collected = 0;
+  while(collectOne(false)) num_collected++;
+
+  return num_collected;
+}
+
+auto GLResourceLoader::finish() -> GLResourceLoader&
+{
+  while(numPending()) collectOne(true);
+
+  return *this;
+}
+
+auto GLResourceLoader::numPending() const -> unsigned
+{
+  return num_pending_.load();
+}
+
+void GLResourceLoader::workerMain()
+{
+  context_.makeCurrent();
+
+  trace_thread_name("GLResourceLoader");
+
+  while(true) {
+    Load load;
+
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      load_available_.wait(lock, [this]() { return quit_ || !queue_.empty(); });
+
+      if(quit_) return;
+
+      load = std::move(queue_.front());
+      queue_.pop_front();
+    }
+
+    try {
+      TraceZone trace_zone("GLResourceLoader.load");
+
+      load.load_fn();
+    } catch(...) {
+      load.exception = std::current_exception();
+    }
+
+    // The fence must be flushed, otherwise the GPU could never
+    //   get to it, as the collect()'ing thread can't flush this
+    //   thread's context
+    if(!load.exception) {
+      load.fence
+        .fence()
+        .flush();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      loaded_.push_back(std::move(load));
+    }
+    load_done_.notify_one();
+  }
+}
+
+auto GLResourceLoader::collectOne(bool block) -> bool
+{
+  Load load;
+
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if(block) {
+      load_done_.wait(lock, [this]() { return !loaded_.empty(); });
+    } else if(loaded_.empty()) {
+      return false;
+    }
+
+    auto& front = loaded_.front();
+
+    // The fences are signaled in the same order they were
+    //   inserted, so there's no point looking past the front
+    if(!block && front.fence.fenced() && !front.fence.signaled()) return false;
+
+    load = std::move(front);
+    loaded_.pop_front();
+  }
+
+  // Wait without holding 'mutex_', so the helper thread can
+  //   keep handing over the loads it finishes in the meantime
+  if(block && load.fence.fenced()) {
+    TraceZone trace_zone("GLResourceLoader.block", TraceWait);
+
+    load.fence.block();
+  }
+
+  num_pending_--;
+
+  if(load.exception) std::rethrow_exception(load.exception);
+
+  load.done_fn();
+
+  return true;
+}
+
+}
@@ -1,105 +1,371 @@
 #include <gx/pipeline.h>
-#include <gx/vertex.h>
-#include <gx/program.h>
 
 // OpenGL/gl3w
 #include <GL/gl3w.h>
 
-#include <cstdio>
-#include <cstring>
+#include <cassert>
 
 #include <algorithm>
+#include <utility>
 
 namespace brdrive {
 
+using StateStructArray = std::array<GLPipeline::StateStruct, std::variant_size_v<GLPipeline::StateStruct>-1>;
+
+// The state last applied by GLPipeline::use(), slots
+//   holding std::monostate are considered unknown
+thread_local StateStructArray g_current_state;
+
+thread_local GLPipeline::Stats g_pipeline_stats = { 0, 0 };
+
+[[using gnu: always_inline]]
+static constexpr auto CompareFunc_to_func(u32 func) -> GLEnum
+{
+  switch(func) {
+  case GLPipeline::CompareFuncNever:        return GL_NEVER;
+  case GLPipeline::CompareFuncAlways:       return GL_ALWAYS;
+  case GLPipeline::CompareFuncEqual:        return GL_EQUAL;
+  case GLPipeline::CompareFuncNotEqual:     return GL_NOTEQUAL;
+  case GLPipeline::CompareFuncLess:         return GL_LESS;
+  case GLPipeline::CompareFuncLessEqual:    return GL_LEQUAL;
+  case GLPipeline::CompareFuncGreater:      return GL_GREATER;
+  case GLPipeline::CompareFuncGreaterEqual: return GL_GEQUAL;
+  }
+
+  return GL_INVALID_ENUM;
+}
+
+[[using gnu: always_inline]]
+static constexpr auto StencilOp_to_op(u32 op) -> GLEnum
+{
+  switch(op) {
+  case GLPipeline::StencilOpKeep:     return GL_KEEP;
+  case GLPipeline::StencilOpZero:     return GL_ZERO;
+  case GLPipeline::StencilOpReplace:  return GL_REPLACE;
+  case GLPipeline::StencilOpIncr:     return GL_INCR;
+  case GLPipeline::StencilOpIncrWrap: return GL_INCR_WRAP;
+  case GLPipeline::StencilOpDecr:     return GL_DECR;
+  case GLPipeline::StencilOpDecrWrap: return GL_DECR_WRAP;
+  case GLPipeline::StencilOpInvert:   return GL_INVERT;
+  }
+
+  return GL_INVALID_ENUM;
+}
+
+[[using gnu: always_inline]]
+static constexpr auto BlendFactor_to_factor(u32 factor) -> GLEnum
+{
+  switch(factor) {
+  case GLPipeline::BlendFactorZero:             return GL_ZERO;
+  case GLPipeline::BlendFactorOne:              return GL_ONE;
+  case GLPipeline::BlendFactorSrcColor:         return GL_SRC_COLOR;
+  case GLPipeline::BlendFactorOneMinusSrcColor: return GL_ONE_MINUS_SRC_COLOR;
+  case GLPipeline::BlendFactorDstColor:         return GL_DST_COLOR;
+  case GLPipeline::BlendFactorOneMinusDstColor: return GL_ONE_MINUS_DST_COLOR;
+  case GLPipeline::BlendFactorSrcAlpha:         return GL_SRC_ALPHA;
+  case GLPipeline::BlendFactorOneMinusSrcAlpha: return GL_ONE_MINUS_SRC_ALPHA;
+  case GLPipeline::BlendFactorDstAlpha:         return GL_DST_ALPHA;
+  case GLPipeline::BlendFactorOneMinusDstAlpha: return GL_ONE_MINUS_DST_ALPHA;
+  }
+
+  return GL_INVALID_ENUM;
+}
+
+[[using gnu: always_inline]]
+static constexpr auto BlendEquation_to_mode(u32 equation) -> GLEnum
+{
+  switch(equation) {
+  case GLPipeline::BlendEquationAdd:             return GL_FUNC_ADD;
+  case GLPipeline::BlendEquationSubtract:        return GL_FUNC_SUBTRACT;
+  case GLPipeline::BlendEquationReverseSubtract: return GL_FUNC_REVERSE_SUBTRACT;
+  case GLPipeline::BlendEquationMin:             return GL_MIN;
+  case GLPipeline::BlendEquationMax:             return GL_MAX;
+  }
+
+  return GL_INVALID_ENUM;
+}
+
+[[using gnu: always_inline]]
+static constexpr auto PolygonMode_to_mode(u32 mode) -> GLEnum
+{
+  switch(mode) {
+  case GLPipeline::PolygonModeFilled: return GL_FILL;
+  case GLPipeline::PolygonModeLines:  return GL_LINE;
+  case GLPipeline::PolygonModePoints: return GL_POINT;
+  }
+
+  return GL_INVALID_ENUM;
+}
+
+static void gl_enable(GLEnum cap, bool enable)
+{
+  if(enable) {
+    glEnable(cap);
+  } else {
+    glDisable(cap);
+  }
+}
+
+// The state structs contain bitfields (and thus - padding
+//   bits with unspecified values), so they're compared
+//   member-by-member instead of with memcmp()
+static auto state_equal(const std::monostate&, const std::monostate&) -> bool
+{
+  return true;
+}
+
+static auto state_equal(const GLPipeline::InputAssembly& a, const GLPipeline::InputAssembly& b) -> bool
+{
+  return a.primitive == b.primitive && a.restart_index == b.restart_index;
+}
+
+static auto state_equal(const GLPipeline::Viewport& a, const GLPipeline::Viewport& b) -> bool
+{
+  return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+}
+
+static auto state_equal(const GLPipeline::Scissor& a, const GLPipeline::Scissor& b) -> bool
+{
+  // The rectangle doesn't matter when the scissor test is disabled
+  if(!a.scissor && !b.scissor) return true;
+
+  return a.scissor == b.scissor && a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+}
+
+static auto state_equal(const GLPipeline::Rasterizer& a, const GLPipeline::Rasterizer& b) -> bool
+{
+  return a.cull_mode == b.cull_mode && a.front_face == b.front_face
+    && a.polygon_mode == b.polygon_mode;
+}
+
+static auto state_equal(const GLPipeline::DepthStencil& a, const GLPipeline::DepthStencil& b) -> bool
+{
+  return a.depth_test == b.depth_test && a.depth_write == b.depth_write
+    && a.depth_func == b.depth_func
+    && a.stencil_test == b.stencil_test && a.stencil_func == b.stencil_func
+    && a.stencil_ref == b.stencil_ref && a.stencil_mask == b.stencil_mask
+    && a.stencil_fail == b.stencil_fail && a.stencil_depth_fail == b.stencil_depth_fail
+    && a.stencil_pass == b.stencil_pass;
+}
+
+static auto state_equal(const GLPipeline::Blend& a, const GLPipeline::Blend& b) -> bool
+{
+  // Same as with the scissor test - when blending is
+  //   disabled the rest of the parameters don't matter
+  if(!a.blend && !b.blend) return true;
+
+  return a.blend == b.blend && a.src_factor == b.src_factor
+    && a.dst_factor == b.dst_factor && a.equation == b.equation;
+}
+
+static auto state_equal(const GLPipeline::StateStruct& a, const GLPipeline::StateStruct& b) -> bool
+{
+  if(a.index() != b.index()) return false;
+
+  return std::visit([&b](const auto& a_) -> bool {
+      using T = std::decay_t<decltype(a_)>;
+
+      return state_equal(a_, std::get<T>(b));
+  }, a);
+}
+
+static void apply_state(const std::monostate&)
+{
+}
+
+static void apply_state(const GLPipeline::InputAssembly& st)
+{
+  // The primitive type is passed to the draw calls
+  //   themselves, so only the restart index needs
+  //   to be applied
+  if(st.restart_index == GLPipeline::RestartIndexNone) {
+    glDisable(GL_PRIMITIVE_RESTART);
+    return;
+  }
+
+  glEnable(GL_PRIMITIVE_RESTART);
+  glPrimitiveRestartIndex(st.restart_index);
+}
+
+static void apply_state(const GLPipeline::Viewport& st)
+{
+  glViewport(st.x, st.y, st.w, st.h);
+}
+
+static void apply_state(const GLPipeline::Scissor& st)
+{
+  gl_enable(GL_SCISSOR_TEST, st.scissor);
+  if(!st.scissor) return;
+
+  glScissor(st.x, st.y, st.w, st.h);
+}
+
+static void apply_state(const GLPipeline::Rasterizer& st)
+{
+  gl_enable(GL_CULL_FACE, st.cull_mode != GLPipeline::CullNone);
+  switch(st.cull_mode) {
+  case GLPipeline::CullFront:        glCullFace(GL_FRONT); break;
+  case GLPipeline::CullBack:         glCullFace(GL_BACK); break;
+  case GLPipeline::CullFrontAndBack: glCullFace(GL_FRONT_AND_BACK); break;
+  }
+
+  glFrontFace(st.front_face == GLPipeline::FrontFaceCW ? GL_CW : GL_CCW);
+  glPolygonMode(GL_FRONT_AND_BACK, PolygonMode_to_mode(st.polygon_mode));
+}
+
+static void apply_state(const GLPipeline::DepthStencil& st)
+{
+  gl_enable(GL_DEPTH_TEST, st.depth_test);
+  glDepthMask(st.depth_write ? GL_TRUE : GL_FALSE);
+  glDepthFunc(CompareFunc_to_func(st.depth_func));
+
+  gl_enable(GL_STENCIL_TEST, st.stencil_test);
+  if(!st.stencil_test) return;
+
+  glStencilFunc(CompareFunc_to_func(st.stencil_func), st.stencil_ref, st.stencil_mask);
+  glStencilOp(
+      StencilOp_to_op(st.stencil_fail), StencilOp_to_op(st.stencil_depth_fail),
+      StencilOp_to_op(st.stencil_pass)
+  );
+}
+
+static void apply_state(const GLPipeline::Blend& st)
+{
+  gl_enable(GL_BLEND, st.blend);
+  if(!st.blend) return;
+
+  glBlendFunc(BlendFactor_to_factor(st.src_factor), BlendFactor_to_factor(st.dst_factor));
+  glBlendEquation(BlendEquation_to_mode(st.equation));
+}
+
 GLPipeline::GLPipeline()
 {
   std::fill(state_structs_.begin(), state_structs_.end(), std::monostate());
+}
+
+auto GLPipeline::add(const StateStruct& st) -> GLPipeline&
+{
+  if(std::holds_alternative<std::monostate>(st)) return *this;
+
+  state_structs_.at(st.index()-1) = st;
+
+  return *this;
+}
 
-  state_structs_ = {
-    Viewport { 0, 0, 1280, 720 },
-    VertexInput { 0, GLType::u16 },
-    InputAssembly { GLPrimitive::TriangleFan, 0xFFFF },
-  };
+auto GLPipeline::viewport(u16 x, u16 y, u16 w, u16 h) -> GLPipeline&
+{
+  return add(Viewport { x, y, w, h });
+}
 
-  StateStructArray other_state;
-  std::fill(other_state.begin(), other_state.end(), std::monostate());
+auto GLPipeline::scissor(u16 x, u16 y, u16 w, u16 h) -> GLPipeline&
+{
+  return add(Scissor { 1, x, y, w, h });
+}
 
-  other_state = {
-    Viewport { 0, 0, 1280, 576 },
-    VertexInput { 0, GLType::u16 },
-    InputAssembly { GLPrimitive::TriangleFan, 0xFFFF },
-    Blend { 1 },
-  };
+auto GLPipeline::noScissor() -> GLPipeline&
+{
+  return add(Scissor { 0, 0, 0, 0, 0 });
+}
 
+auto GLPipeline::inputAssembly(GLPrimitive primitive, u32 restart_index) -> GLPipeline&
+{
+  return add(InputAssembly { primitive, restart_index });
+}
 
-  diff(other_state);
+auto GLPipeline::noDepth() -> GLPipeline&
+{
+  DepthStencil depth_stencil = { };
+  depth_stencil.depth_func = CompareFuncAlways;
+  depth_stencil.stencil_func = CompareFuncAlways;
 
+  return add(depth_stencil);
+}
 
+auto GLPipeline::noBlend() -> GLPipeline&
+{
+  return add(Blend { 0, BlendFactorOne, BlendFactorZero, BlendEquationAdd });
+}
 
+auto GLPipeline::alphaBlend() -> GLPipeline&
+{
+  return add(Blend {
+      1,
+      BlendFactorSrcAlpha, BlendFactorOneMinusSrcAlpha,
+      BlendEquationAdd
+  });
 }
 
-auto GLPipeline::diff(const StateStructArray& other) -> StateStructArray
+auto GLPipeline::use() -> GLPipeline&
 {
-  auto order_state_structs = [](const StateStructArray& array) -> StateStructArray {
-    StateStructArray ordered;
+  auto difference = diff(g_current_state);
+
+  for(size_t i = 0; i < difference.size(); i++) {
+    const auto& st = difference[i];
 
-    std::fill(ordered.begin(), ordered.end(), std::monostate());
-    for(const auto& st : array) {
-      if(std::holds_alternative<std::monostate>(st)) continue;
+    // Nothing specified by this pipeline - the state is a "don't care"
+    if(std::holds_alternative<std::monostate>(state_structs_[i])) continue;
 
-      ordered[st.index()-1] = st;
+    // The state is already applied - so skip it
+    if(std::holds_alternative<std::monostate>(st)) {
+      g_pipeline_stats.num_elided++;
+      continue;
     }
 
-    return ordered;
-  };
+    std::visit([](const auto& st_) { apply_state(st_); }, st);
+    g_current_state[i] = st;
 
-  auto print_state = [this](const auto& state) {
-    for(const auto& st : state) {
-      if(std::holds_alternative<std::monostate>(st)) continue;
+    g_pipeline_stats.num_applied++;
+  }
 
-      printf("    %zu,\n", st.index());
-    }
-    puts("");
-  };
+  assert(glGetError() == GL_NO_ERROR);
 
-  puts("Before sort (self):");
-  print_state(state_structs_);
+  return *this;
+}
 
-  puts("Before sort (other):");
-  print_state(other);
+auto GLPipeline::primitive() const -> GLPrimitive
+{
+  constexpr auto input_assembly_idx = StateStruct(InputAssembly()).index() - 1;
 
-  StateStructArray ordered = order_state_structs(state_structs_);
-  StateStructArray other_ordered = order_state_structs(other);
+  const auto& st = state_structs_[input_assembly_idx];
+  if(!std::holds_alternative<InputAssembly>(st)) return GLPrimitive::Invalid;
 
-  puts("After sort (self):");
-  print_state(ordered);
+  return std::get<InputAssembly>(st).primitive;
+}
 
-  puts("After sort (other):");
-  print_state(other_ordered);
+auto GLPipeline::stats() -> Stats
+{
+  return g_pipeline_stats;
+}
 
+void GLPipeline::resetStats()
+{
+  g_pipeline_stats = { 0, 0 };
+}
+
+void GLPipeline::invalidateCurrent()
+{
+  std::fill(g_current_state.begin(), g_current_state.end(), std::monostate());
+}
+
+auto GLPipeline::diff(const StateStructArray& other) const -> StateStructArray
+{
   StateStructArray difference;
   std::fill(difference.begin(), difference.end(), std::monostate());
 
   for(size_t i = 0; i < difference.size(); i++) {
-    const auto& a = ordered[i];
-    const auto& b = other_ordered[i];
-
-    const void *a_ptr = &a;
-    const void *b_ptr = &b;
+    const auto& a = state_structs_[i];
+    const auto& b = other[i];
 
-    auto result = memcmp(a_ptr, b_ptr, sizeof(StateStruct));
+    // This pipeline doesn't care about the state - so move on
+    if(std::holds_alternative<std::monostate>(a)) continue;
 
     // The structs are equal - so move on
-    if(!result) continue;
+    if(state_equal(a, b)) continue;
 
-    // Otherwise - add 'b' to the difference
-    difference[i] = b;
+    // Otherwise - add 'a' to the difference
+    difference[i] = a;
   }
 
-  puts("difference:");
-  print_state(difference);
-
   return difference;
 }
 
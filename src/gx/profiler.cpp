@@ -0,0 +1,175 @@
+#include <gx/profiler.h>
+
+#include <util/trace.h>
+
+// OpenGL/gl3w
+#include <GL/gl3w.h>
+
+#include <cassert>
+
+#include <utility>
+
+namespace brdrive {
+
+GLProfiler::GLProfiler() :
+  frame_index_(0),
+  latest_results_frame_(0),
+  stats_({ 0, 0 })
+{
+  for(auto& frame : frames_) {
+    frame.index = 0;
+    frame.pending = false;
+    frame.trace_offset_ns = 0;
+    frame.num_queries = 0;
+  }
+}
+
+auto GLProfiler::pushGroup(const char *name) -> GLProfiler&
+{
+  auto& frame = currentFrame();
+
+  auto begin_query = nextQuery();
+  frame.queries[begin_query].timestamp();
+
+  frame.groups.push_back(Group {
+      name, (unsigned)group_stack_.size(),
+      begin_query, ~0u,
+  });
+  group_stack_.push_back(frame.groups.size()-1);
+
+  return *this;
+}
+
+auto GLProfiler::popGroup() -> GLProfiler&
+{
+  assert(!group_stack_.empty() && "popGroup() called without a matching pushGroup()!");
+
+  auto& frame = currentFrame();
+
+  auto end_query = nextQuery();
+  frame.queries[end_query].timestamp();
+
+  frame.groups[group_stack_.back()].end_query = end_query;
+  group_stack_.pop_back();
+
+  return *this;
+}
+
+auto GLProfiler::endFrame() -> bool
+{
+  assert(group_stack_.empty() &&
+      "endFrame() called while some of the groups are still pushed!");
+
+  auto& ended_frame = currentFrame();
+  ended_frame.pending = !ended_frame.groups.empty();
+
+  // Sample both clocks so the GPU timestamps can be put on the
+  //   trace_now() timeline - GL_TIMESTAMP, unlike the queries,
+  //   is returned right away (without waiting for the GPU)
+  if(ended_frame.pending && trace_enabled()) {
+    GLint64 gpu_now = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+
+    ended_frame.trace_offset_ns = (i64)trace_now() - gpu_now;
+  }
+
+  frame_index_++;
+
+  // Read back the results of all the previous frames which are
+  //   available, the oldest first, so the newest one ends up
+  //   in 'latest_results_'
+  //  - The oldest one occupies the slot of the new current
+  //    frame, which is about to be reused, so if it's results
+  //    still aren't there - drop them
+  bool updated = false;
+  for(u64 i = NumFrames; i > 0; i--) {
+    if(frame_index_ < i) continue;
+
+    auto& frame = frames_[(frame_index_ - i) % NumFrames];
+    if(!frame.pending) continue;
+
+    if(tryReadBack(frame)) {
+      updated = true;
+    } else if(i == NumFrames) {
+      frame.pending = false;
+      stats_.frames_dropped++;
+    } else {
+      break;    // The frames complete in order
+    }
+  }
+
+  auto& frame = currentFrame();
+
+  frame.index = frame_index_;
+  frame.trace_offset_ns = 0;
+  frame.groups.clear();
+  frame.num_queries = 0;
+
+  return updated;
+}
+
+auto GLProfiler::latestResults() const -> const std::vector<GroupTiming>&
+{
+  return latest_results_;
+}
+
+auto GLProfiler::latestResultsFrame() const -> u64
+{
+  return latest_results_frame_;
+}
+
+auto GLProfiler::stats() const -> Stats
+{
+  return stats_;
+}
+
+auto GLProfiler::currentFrame() -> Frame&
+{
+  return frames_[frame_index_ % NumFrames];
+}
+
+auto GLProfiler::nextQuery() -> unsigned
+{
+  auto& frame = currentFrame();
+
+  if(frame.num_queries == frame.queries.size()) frame.queries.emplace_back(GLQuery::Timestamp);
+
+  return frame.num_queries++;
+}
+
+auto GLProfiler::tryReadBack(Frame& frame) -> bool
+{
+  assert(frame.pending);
+
+  // The queries complete in the order they were issued,
+  //   so checking the last one is enough
+  if(!frame.queries[frame.num_queries-1].resultAvailable()) return false;
+
+  latest_results_.clear();
+  for(const auto& group : frame.groups) {
+    // A group which was pushed, but never popped
+    //   (shouldn't happen because of the assert in
+    //   endFrame()) doesn't have an end query
+    if(group.end_query == ~0u) continue;
+
+    auto begin_ns = frame.queries[group.begin_query].result();
+    auto end_ns = frame.queries[group.end_query].result();
+
+    latest_results_.push_back(GroupTiming {
+        group.name, group.depth, end_ns - begin_ns,
+    });
+
+    if(frame.trace_offset_ns) {
+      trace_gpu_zone(group.name, begin_ns + frame.trace_offset_ns, end_ns - begin_ns);
+    }
+  }
+
+  latest_results_frame_ = frame.index;
+  frame.pending = false;
+
+  stats_.frames_read++;
+
+  return true;
+}
+
+}
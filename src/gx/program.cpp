@@ -1,6 +1,9 @@
 #include <gx/program.h>
 #include <gx/texture.h>
 #include <gx/extensions.h>
+#include <gx/context.h>
+#include <gx/state.h>
+#include <gx/dispatch.h>
 
 // OpenGL/gl3w
 #include <GL/gl3w.h>
@@ -12,8 +15,6 @@
 
 namespace brdrive {
 
-thread_local GLId g_bound_program = GLNullId;
-
 [[using gnu: always_inline]]
 constexpr auto Type_to_shaderType(GLShader::Type type) -> GLenum
 {
@@ -389,11 +390,8 @@ auto GLProgram::use() -> GLProgram&
   assert(linked_ &&
     "attempted to use() a GLProgram which hasn't been link()'ed!");
 
-  // Only switch the program if it's not the same as the bound one
-  if(id_ == g_bound_program) return *this;
-
-  glUseProgram(id_);
-  g_bound_program = id_;
+  // Only switches the program if it's not the same as the bound one
+  GLStateTracker::current().useProgram(id_);
 
   return *this;
 }
@@ -403,8 +401,7 @@ auto GLProgram::uniform(const char *name, int i) -> GLProgram&
   auto [location, _] = uniformLocationType(name, Int);
 
   uploadUniform(
-      ARB::direct_state_access || EXT::direct_state_access,
-      glProgramUniform1i, glUniform1i, location, i
+      GLDispatch::current().programUniform1i, location, i
   );
 
   assert(glGetError() == GL_NO_ERROR);
@@ -417,8 +414,7 @@ auto GLProgram::uniform(const char *name, float f) -> GLProgram&
   auto [location, _] = uniformLocationType(name, Float);
 
   uploadUniform(
-      ARB::direct_state_access || EXT::direct_state_access,
-      glProgramUniform1f, glUniform1f, location, f
+      GLDispatch::current().programUniform1f, location, f
   );
 
   assert(glGetError() == GL_NO_ERROR);
@@ -431,8 +427,7 @@ auto GLProgram::uniform(const char *name, const GLTexImageUnit& tex_unit) -> GLP
   auto [location, _] = uniformLocationType(name, TexImageUnit);
 
   uploadUniform(
-      ARB::direct_state_access || EXT::direct_state_access,
-      glProgramUniform1i, glUniform1i, location, tex_unit.texImageUnitIndex()
+      GLDispatch::current().programUniform1i, location, tex_unit.texImageUnitIndex()
   );
 
   assert(glGetError() == GL_NO_ERROR);
@@ -445,8 +440,7 @@ auto GLProgram::uniformVec(const char *name, float x, float y) -> GLProgram&
   auto [location, _] = uniformLocationType(name, Vec2);
 
   uploadUniform(
-      ARB::direct_state_access || EXT::direct_state_access,
-      glProgramUniform2f, glUniform2f, location, x, y
+      GLDispatch::current().programUniform2f, location, x, y
   );
 
   assert(glGetError() == GL_NO_ERROR);
@@ -459,8 +453,7 @@ auto GLProgram::uniformVec(const char *name, float x, float y, float z) -> GLPro
   auto [location, _] = uniformLocationType(name, Vec3);
 
   uploadUniform(
-      ARB::direct_state_access || EXT::direct_state_access,
-      glProgramUniform3f, glUniform3f, location, x, y, z
+      GLDispatch::current().programUniform3f, location, x, y, z
   );
 
   assert(glGetError() == GL_NO_ERROR);
@@ -473,10 +466,46 @@ auto GLProgram::uniformMat4x4(const char *name, const float *mat) -> GLProgram&
   auto [location, _] = uniformLocationType(name, Mat4x4);
 
   uploadUniform(
-      ARB::direct_state_access || EXT::direct_state_access,
-      glProgramUniformMatrix4fv, glUniformMatrix4fv, location, 1, GL_TRUE, mat
+      GLDispatch::current().programUniformMatrix4fv, location, 1, GL_TRUE, mat
+  );
+
+  return *this;
+}
+
+auto GLProgram::uniformLocation(const char *name, UniformType type) -> UniformLocation
+{
+  assert(linked_ &&
+    "attempted to query a uniform's location on a GLProgram which hasn't been link()'ed!");
+
+  auto [location, _] = uniformLocationType(name, type);
+
+  return location;
+}
+
+auto GLProgram::uniformAt(UniformLocation location, int i) -> GLProgram&
+{
+  uploadUniform(
+      GLDispatch::current().programUniform1i, location, i
   );
 
+  assert(glGetError() == GL_NO_ERROR);
+
+  return *this;
+}
+
+auto GLProgram::storageBlockBinding(const char *name, unsigned index) -> GLProgram&
+{
+  assert(id_ != GLNullId);
+  assert(linked_ &&
+    "attempted to set a storage block's binding on a GLProgram which hasn't been link()'ed!");
+
+  auto block_index = glGetProgramResourceIndex(id_, GL_SHADER_STORAGE_BLOCK, name);
+  if(block_index == GL_INVALID_INDEX) return *this;
+
+  glShaderStorageBlockBinding(id_, block_index, index);
+
+  assert(glGetError() == GL_NO_ERROR);
+
   return *this;
 }
 
@@ -504,6 +533,7 @@ auto GLProgram::doDestroy() -> GLObject&
   if(id_ == GLNullId) return *this;
 
   glDeleteProgram(id_);
+  if(auto context = GLContext::current()) context->state().forgetProgram(id_);
 
   return *this;
 }
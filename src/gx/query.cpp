@@ -0,0 +1,151 @@
+#include <gx/query.h>
+
+// OpenGL/gl3w
+#include <GL/gl3w.h>
+
+#include <cassert>
+
+#include <utility>
+
+namespace brdrive {
+
+[[using gnu: always_inline]]
+static constexpr auto Type_to_target(GLQuery::Type type) -> GLEnum
+{
+  switch(type) {
+  case GLQuery::Timestamp:           return GL_TIMESTAMP;
+  case GLQuery::TimeElapsed:         return GL_TIME_ELAPSED;
+  case GLQuery::SamplesPassed:       return GL_SAMPLES_PASSED;
+  case GLQuery::AnySamplesPassed:    return GL_ANY_SAMPLES_PASSED;
+  case GLQuery::PrimitivesGenerated: return GL_PRIMITIVES_GENERATED;
+
+  default: ;    // Fallthrough
+  }
+
+  return GL_INVALID_ENUM;
+}
+
+GLQuery::GLQuery(Type type) :
+  GLObject(GL_QUERY),
+  type_(type), target_(Type_to_target(type)),
+  issued_(false)
+{
+  // TypeInvalid is only used by the move constructor
+  assert((type_ == TypeInvalid || target_ != GL_INVALID_ENUM) && "the GLQuery's 'type' is invalid!");
+}
+
+GLQuery::GLQuery(GLQuery&& other) :
+  GLQuery(TypeInvalid)
+{
+  other.swap(*this);
+}
+
+GLQuery::~GLQuery()
+{
+  GLQuery::doDestroy();
+}
+
+auto GLQuery::operator=(GLQuery&& other) -> GLQuery&
+{
+  destroy();
+  other.swap(*this);
+
+  return *this;
+}
+
+auto GLQuery::timestamp() -> GLQuery&
+{
+  if(type_ != Timestamp) throw InvalidQueryTypeError();
+
+  initGLObject();
+
+  glQueryCounter(id_, GL_TIMESTAMP);
+  issued_ = true;
+
+  return *this;
+}
+
+auto GLQuery::begin() -> GLQuery&
+{
+  if(type_ == Timestamp) throw InvalidQueryTypeError();
+
+  initGLObject();
+
+  glBeginQuery(target_, id_);
+
+  return *this;
+}
+
+auto GLQuery::end() -> GLQuery&
+{
+  if(type_ == Timestamp) throw InvalidQueryTypeError();
+
+  assert(id_ != GLNullId && "attempted to end() a GLQuery which wasn't begin()'ed!");
+
+  glEndQuery(target_);
+  issued_ = true;
+
+  return *this;
+}
+
+auto GLQuery::resultAvailable() -> bool
+{
+  if(!issued_) return false;
+
+  int available = GL_FALSE;
+  glGetQueryObjectiv(id_, GL_QUERY_RESULT_AVAILABLE, &available);
+
+  return available == GL_TRUE;
+}
+
+auto GLQuery::result() -> u64
+{
+  if(!issued_) throw NoResultError();
+
+  GLuint64 result = 0;
+  glGetQueryObjectui64v(id_, GL_QUERY_RESULT, &result);
+
+  assert(glGetError() == GL_NO_ERROR);
+
+  return result;
+}
+
+auto GLQuery::issued() const -> bool
+{
+  return issued_;
+}
+
+auto GLQuery::type() const -> Type
+{
+  return type_;
+}
+
+auto GLQuery::swap(GLQuery& other) -> GLQuery&
+{
+  other.GLObject::swap(*this);
+
+  std::swap(type_, other.type_);
+  std::swap(target_, other.target_);
+  std::swap(issued_, other.issued_);
+
+  return *this;
+}
+
+auto GLQuery::doDestroy() -> GLObject&
+{
+  if(id_ == GLNullId) return *this;
+
+  glDeleteQueries(1, &id_);
+  issued_ = false;
+
+  return *this;
+}
+
+void GLQuery::initGLObject()
+{
+  if(id_ != GLNullId) return;
+
+  glGenQueries(1, &id_);
+}
+
+}
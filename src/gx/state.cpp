@@ -0,0 +1,237 @@
+#include <gx/state.h>
+#include <gx/context.h>
+
+// OpenGL/gl3w
+#include <GL/gl3w.h>
+
+#include <cassert>
+
+namespace brdrive {
+
+[[using gnu: always_inline]]
+static constexpr auto target_to_BufferTarget(GLEnum target) -> GLStateTracker::BufferTarget
+{
+  switch(target) {
+  case GL_ARRAY_BUFFER:              return GLStateTracker::ArrayBuffer;
+  case GL_ELEMENT_ARRAY_BUFFER:      return GLStateTracker::ElementArrayBuffer;
+  case GL_COPY_READ_BUFFER:          return GLStateTracker::CopyReadBuffer;
+  case GL_COPY_WRITE_BUFFER:         return GLStateTracker::CopyWriteBuffer;
+  case GL_PIXEL_PACK_BUFFER:         return GLStateTracker::PixelPackBuffer;
+  case GL_PIXEL_UNPACK_BUFFER:       return GLStateTracker::PixelUnpackBuffer;
+  case GL_DRAW_INDIRECT_BUFFER:      return GLStateTracker::DrawIndirectBuffer;
+  case GL_DISPATCH_INDIRECT_BUFFER:  return GLStateTracker::DispatchIndirectBuffer;
+  case GL_TEXTURE_BUFFER:            return GLStateTracker::TextureBuffer;
+  case GL_UNIFORM_BUFFER:            return GLStateTracker::UniformBuffer;
+  case GL_SHADER_STORAGE_BUFFER:     return GLStateTracker::ShaderStorageBuffer;
+  case GL_ATOMIC_COUNTER_BUFFER:     return GLStateTracker::AtomicCounterBuffer;
+  case GL_QUERY_BUFFER:              return GLStateTracker::QueryBuffer;
+  case GL_TRANSFORM_FEEDBACK_BUFFER: return GLStateTracker::TransformFeedbackBuffer;
+
+  default: ;    // Fallthrough
+  }
+
+  return GLStateTracker::BufferTargetInvalid;
+}
+
+GLStateTracker::GLStateTracker() :
+  vertex_array_(GLNullId),
+  draw_framebuffer_(GLNullId), read_framebuffer_(GLNullId),
+  active_texture_(0),
+  program_(GLNullId),
+  stats_({ 0, 0 })
+{
+  // A freshly created context has nothing bound
+  buffers_.fill(GLNullId);
+}
+
+auto GLStateTracker::current() -> GLStateTracker&
+{
+  auto context = GLContext::current();
+  assert(context && "attempted to use the GLStateTracker without a current GLContext!");
+
+  return context->state();
+}
+
+auto GLStateTracker::bindVertexArray(GLId array) -> GLStateTracker&
+{
+  if(elide(vertex_array_, array)) return *this;
+
+  glBindVertexArray(array);
+
+  // The new VAO has it's own GL_ELEMENT_ARRAY_BUFFER binding
+  buffers_[ElementArrayBuffer] = Unknown;
+
+  return *this;
+}
+
+auto GLStateTracker::bindBuffer(GLEnum target, GLId buffer) -> GLStateTracker&
+{
+  auto idx = target_to_BufferTarget(target);
+  assert(idx < NumBufferTargets && "attempted to bindBuffer() to an invalid target!");
+
+  if(elide(buffers_[idx], buffer)) return *this;
+
+  glBindBuffer(target, buffer);
+
+  return *this;
+}
+
+auto GLStateTracker::boundBufferIndexed(GLEnum target, GLId buffer) -> GLStateTracker&
+{
+  auto idx = target_to_BufferTarget(target);
+  assert(idx < NumBufferTargets);
+
+  buffers_[idx] = buffer;
+
+  return *this;
+}
+
+auto GLStateTracker::bindFramebuffer(GLEnum target, GLId framebuffer) -> GLStateTracker&
+{
+  switch(target) {
+  case GL_FRAMEBUFFER:
+    // Only elide the call when both bindings already match
+    if(draw_framebuffer_ == framebuffer && read_framebuffer_ == framebuffer) {
+      stats_.num_elided++;
+      return *this;
+    }
+
+    draw_framebuffer_ = read_framebuffer_ = framebuffer;
+    stats_.num_binds++;
+    break;
+
+  case GL_DRAW_FRAMEBUFFER:
+    if(elide(draw_framebuffer_, framebuffer)) return *this;
+    break;
+
+  case GL_READ_FRAMEBUFFER:
+    if(elide(read_framebuffer_, framebuffer)) return *this;
+    break;
+
+  default: assert(0 && "attempted to bindFramebuffer() to an invalid target!");
+  }
+
+  glBindFramebuffer(target, framebuffer);
+
+  return *this;
+}
+
+auto GLStateTracker::activeTexture(unsigned slot) -> GLStateTracker&
+{
+  if(elide(active_texture_, slot)) return *this;
+
+  glActiveTexture(GL_TEXTURE0 + slot);
+
+  return *this;
+}
+
+auto GLStateTracker::useProgram(GLId program) -> GLStateTracker&
+{
+  if(elide(program_, program)) return *this;
+
+  glUseProgram(program);
+
+  return *this;
+}
+
+auto GLStateTracker::vertexArray() const -> GLId
+{
+  return vertex_array_;
+}
+
+auto GLStateTracker::buffer(GLEnum target) const -> GLId
+{
+  auto idx = target_to_BufferTarget(target);
+  assert(idx < NumBufferTargets);
+
+  return buffers_[idx];
+}
+
+auto GLStateTracker::drawFramebuffer() const -> GLId
+{
+  return draw_framebuffer_;
+}
+
+auto GLStateTracker::readFramebuffer() const -> GLId
+{
+  return read_framebuffer_;
+}
+
+auto GLStateTracker::activeTextureSlot() const -> unsigned
+{
+  return active_texture_;
+}
+
+auto GLStateTracker::program() const -> GLId
+{
+  return program_;
+}
+
+auto GLStateTracker::forgetVertexArray(GLId array) -> GLStateTracker&
+{
+  if(vertex_array_ != array) return *this;
+
+  vertex_array_ = GLNullId;
+  buffers_[ElementArrayBuffer] = Unknown;
+
+  return *this;
+}
+
+auto GLStateTracker::forgetBuffer(GLId buffer) -> GLStateTracker&
+{
+  for(auto& bound : buffers_) {
+    if(bound == buffer) bound = GLNullId;
+  }
+
+  return *this;
+}
+
+auto GLStateTracker::forgetFramebuffer(GLId framebuffer) -> GLStateTracker&
+{
+  if(draw_framebuffer_ == framebuffer) draw_framebuffer_ = GLNullId;
+  if(read_framebuffer_ == framebuffer) read_framebuffer_ = GLNullId;
+
+  return *this;
+}
+
+auto GLStateTracker::forgetProgram(GLId program) -> GLStateTracker&
+{
+  // A program which is in use is only deleted once it's no
+  //   longer current, so it's name can't be reused before
+  //   another one is used - but the GLStateTracker can't
+  //   tell when that happens, so just forget about it
+  if(program_ == program) program_ = Unknown;
+
+  return *this;
+}
+
+auto GLStateTracker::invalidate() -> GLStateTracker&
+{
+  vertex_array_ = Unknown;
+  buffers_.fill(Unknown);
+  draw_framebuffer_ = read_framebuffer_ = Unknown;
+  active_texture_ = Unknown;
+  program_ = Unknown;
+
+  return *this;
+}
+
+auto GLStateTracker::stats() const -> Stats
+{
+  return stats_;
+}
+
+auto GLStateTracker::elide(GLId& bound, GLId id) -> bool
+{
+  if(bound == id) {
+    stats_.num_elided++;
+    return true;
+  }
+
+  bound = id;
+  stats_.num_binds++;
+
+  return false;
+}
+
+}
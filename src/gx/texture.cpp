@@ -1,6 +1,8 @@
 #include <gx/texture.h>
 #include <gx/buffer.h>
 #include <gx/context.h>
+#include <gx/state.h>
+#include <gx/dispatch.h>
 #include <gx/extensions.h>
 
 // OpenGL/gl3w
@@ -85,6 +87,13 @@ static constexpr auto GLFormat_to_internalformat(GLFormat format) -> GLenum
   case rgba16i:  return GL_RGBA16I;
   case rgba16ui: return GL_RGBA16UI;
 
+  case r32i:     return GL_R32I;
+  case r32ui:    return GL_R32UI;
+  case rg32i:    return GL_RG32I;
+  case rg32ui:   return GL_RG32UI;
+  case rgba32i:  return GL_RGBA32I;
+  case rgba32ui: return GL_RGBA32UI;
+
   case srgb8:    return GL_SRGB8;
   case srgb8_a8: return GL_SRGB8_ALPHA8;
 
@@ -305,24 +314,14 @@ auto GLTexture2D::upload(
   auto gl_format = GLFormat_to_format(format);
   auto gl_type   = GLType_to_type(type);
 
-  GLId bound_texture = GLNullId;
-
   if(gl_format == GL_INVALID_ENUM || gl_type == GL_INVALID_ENUM)
     throw InvalidFormatTypeError();
 
-  if(ARB::direct_state_access || EXT::direct_state_access) {
-    glTextureSubImage2D(id_, level, 0, 0, width_, height_, gl_format, gl_type, data);
-  } else {
-    // Save current texture for future retrieval
-    auto current_context = GLContext::current();
-    assert(current_context);
-
-    auto current_tex_unit = current_context->texImageUnit(current_context->activeTexture());
-    bound_texture = current_tex_unit.boundTexture();
-
-    glBindTexture(GL_TEXTURE_2D, id_);
-    glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width_, height_, gl_format, gl_type, data);
-  }
+  // Without direct state access the texture bound
+  //   to the active unit is restored afterwards
+  GLDispatch::current().textureSubImage2D(
+      id_, level, width_, height_, gl_format, gl_type, data
+  );
 
   // Check if the provided format/type combination is valid
   auto err = glGetError();
@@ -331,10 +330,6 @@ auto GLTexture2D::upload(
   // ...and make sure there were no other errors ;)
   assert(err == GL_NO_ERROR);
 
-  if(!ARB::direct_state_access) {
-    glBindTexture(GL_TEXTURE_2D, bound_texture);
-  }
-
   return *this;
 }
 
@@ -538,16 +533,7 @@ auto GLTexImageUnit::bind(const GLTexture& tex) -> GLTexImageUnit&
   // Only bind the texture if it's different than the current one
   if(bound_texture_ == tex_id) return *this;
 
-  if(ARB::direct_state_access || EXT::direct_state_access) {
-    glBindTextureUnit(slot_, tex_id);
-  } else {
-    glActiveTexture(GL_TEXTURE0 + slot_);
-    assert(glGetError() == GL_NO_ERROR);
-
-    context_->active_texture_ = slot_;
-
-    glBindTexture(tex.bindTarget(), tex_id);
-  }
+  context_->dispatch().bindTextureUnit(slot_, tex.bindTarget(), tex_id);
   assert(glGetError() == GL_NO_ERROR);
 
   bound_texture_ = tex_id;
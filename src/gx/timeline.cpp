@@ -0,0 +1,135 @@
+#include <gx/timeline.h>
+
+#include <cassert>
+
+#include <algorithm>
+#include <utility>
+
+namespace brdrive {
+
+GLFrameTimeline::GLFrameTimeline(unsigned max_frames_in_flight) :
+  max_frames_in_flight_(max_frames_in_flight),
+  current_frame_(1), completed_frame_(NoFrame)
+{
+  assert(max_frames_in_flight > 0 && "at least one frame must be allowed to be in flight!");
+}
+
+auto GLFrameTimeline::endFrame() -> FrameIndex
+{
+  auto& fence = fence_pool_.acquire();
+  fence.fence();
+
+  in_flight_.push_back(FrameInFlight { current_frame_, &fence });
+
+  // Block on the oldest frames until the limit is satisfied - the
+  //   frames complete in order, so there's never a need to look
+  //   at anything other than the front of the queue
+  while(in_flight_.size() > max_frames_in_flight_) {
+    auto oldest = in_flight_.front();
+
+    oldest.fence->block();
+    retireFrames(oldest.frame);
+  }
+
+  // Opportunistically retire any other finished frames
+  completedFrame();
+
+  return ++current_frame_;
+}
+
+auto GLFrameTimeline::currentFrame() const -> FrameIndex
+{
+  return current_frame_;
+}
+
+auto GLFrameTimeline::completedFrame() -> FrameIndex
+{
+  // Find the newest signaled fence - all the frames before it
+  //   are guaranteed to have completed as well
+  FrameIndex newest_completed = NoFrame;
+  for(const auto& frame : in_flight_) {
+    if(!frame.fence->signaled()) break;
+
+    newest_completed = frame.frame;
+  }
+
+  if(newest_completed != NoFrame) retireFrames(newest_completed);
+
+  return completed_frame_;
+}
+
+auto GLFrameTimeline::frameCompleted(FrameIndex frame) -> bool
+{
+  // Avoid polling the fences when possible
+  if(frame <= completed_frame_) return true;
+
+  return frame <= completedFrame();
+}
+
+auto GLFrameTimeline::waitFrame(FrameIndex frame, u64 timeout) -> GLFence::WaitStatus
+{
+  assert(frame < current_frame_ && "attempted to waitFrame() on a frame which hasn't ended yet!");
+
+  if(frame <= completed_frame_) return GLFence::WaitConditionSatisfied;
+
+  auto it = std::find_if(in_flight_.begin(), in_flight_.end(),
+      [frame](const auto& in_flight) { return in_flight.frame == frame; });
+  assert(it != in_flight_.end());
+
+  auto status = it->fence->block(timeout);
+  if(status == GLFence::WaitConditionSatisfied) retireFrames(frame);
+
+  return status;
+}
+
+auto GLFrameTimeline::defer(DeferredFn fn) -> GLFrameTimeline&
+{
+  deferred_.emplace_back(current_frame_, std::move(fn));
+
+  return *this;
+}
+
+auto GLFrameTimeline::drain() -> GLFrameTimeline&
+{
+  if(in_flight_.empty()) return *this;
+
+  waitFrame(in_flight_.back().frame);
+
+  return *this;
+}
+
+auto GLFrameTimeline::framesInFlight() const -> unsigned
+{
+  return in_flight_.size();
+}
+
+auto GLFrameTimeline::maxFramesInFlight() const -> unsigned
+{
+  return max_frames_in_flight_;
+}
+
+void GLFrameTimeline::retireFrames(FrameIndex frame)
+{
+  while(!in_flight_.empty() && in_flight_.front().frame <= frame) {
+    fence_pool_.release(*in_flight_.front().fence);
+    in_flight_.pop_front();
+  }
+
+  completed_frame_ = std::max(completed_frame_, frame);
+
+  runDeferred();
+}
+
+void GLFrameTimeline::runDeferred()
+{
+  while(!deferred_.empty() && deferred_.front().first <= completed_frame_) {
+    // Pop the function before calling it in case
+    //   it calls defer() itself
+    auto fn = std::move(deferred_.front().second);
+    deferred_.pop_front();
+
+    fn();
+  }
+}
+
+}
@@ -2,6 +2,8 @@
 #include <gx/extensions.h>
 #include <gx/buffer.h>
 #include <gx/handle.h>
+#include <gx/context.h>
+#include <gx/state.h>
 
 // OpenGL/gl3w
 #include <GL/gl3w.h>
@@ -338,6 +340,17 @@ auto GLVertexFormat::appendAttr(
   // Find a free attribute slot index
   auto attr_slot_idx = nextAttrSlotIndex();
 
+  // 'attributes_' is sized for the minimum the spec guarantees,
+  //   the attribute's index must also be within the actual limit
+  //   of the context (like GLContext::texImageUnit()/bufferBindPoint())
+  //  - Formats can be described before any context is current,
+  //    in which case there are no GLCaps to check against
+  assert([&]() {
+    auto context = GLContext::current();
+
+    return !context || (int)attr_slot_idx < context->caps().max_vertex_attribs;
+  }() && "the attribute's index must be < GLCaps::max_vertex_attribs!");
+
    // Ensure 'buffer_index' is in the allowable range...
   if(buffer_index >= MaxVertexBufferBindings) throw VertexBufferBindingIndexOutOfRangeError();
 
@@ -410,10 +423,11 @@ auto GLVertexFormat::usesVertexBuffer(unsigned buf_binding_index) -> bool
 //   -ion expects sane input data)
 // - Returns a GLId holding the name of the created VertexArray
 //
-// NOTE: The function also takes into account if either one of
-//       <ARB,EXT>_direct_state_access are available (runtime
-//       check) and uses optimized code paths
-template <vertex_format_detail::CreateVertexArrayPath CreatePath>
+// NOTE: The 'DirectStateAccess' parameter should be set when either
+//       one of <ARB,EXT>_direct_state_access are available (see
+//       GLCaps::directStateAccess()), which selects the optimized
+//       code paths at compile-time
+template <vertex_format_detail::CreateVertexArrayPath CreatePath, bool DirectStateAccess>
 auto createVertexArrayGeneric_impl(
     const std::array<GLVertexFormatBuffer, GLVertexFormat::MaxVertexBufferBindings>& buffers,
     const std::array<GLVertexFormatAttr, GLVertexFormat::MaxVertexAttribs>& attribs
@@ -421,14 +435,12 @@ auto createVertexArrayGeneric_impl(
 {
   using namespace vertex_format_detail;
 
-  const auto direct_state_access = ARB::direct_state_access || EXT::direct_state_access;
-
   // The direct state access path can ONLY be used if one of the <ARB,EXT>_direct_state_access
   //   extensions is available AND we're using the Path_vertex_attrib_binding execution path,
   //   as the Path_vertex_array_object path requires calling functions which have no DSA
   //   version and so - the vertex array would have to get bound anyways then, which would
   //   dwarf all the performance advantage of DSA
-  const auto dsa_path = direct_state_access && (CreatePath == Path_vertex_attrib_binding);
+  constexpr auto dsa_path = DirectStateAccess && (CreatePath == Path_vertex_attrib_binding);
 
   // The format_vertex_attrib_binding, format_vertex_array_object
   //   lambdas exist to make the attribute iteration loop tidier
@@ -532,7 +544,7 @@ auto createVertexArrayGeneric_impl(
     glCreateVertexArrays(1, &vertex_array);
   } else {
     glGenVertexArrays(1, &vertex_array);
-    glBindVertexArray(vertex_array);
+    GLStateTracker::current().bindVertexArray(vertex_array);
   }
 
   for(size_t attr_idx = 0; attr_idx < GLVertexFormat::MaxVertexAttribs; attr_idx++) {
@@ -551,7 +563,7 @@ auto createVertexArrayGeneric_impl(
     if(dsa_path) {
       glEnableVertexArrayAttrib(vertex_array, attr_idx);
     } else {
-      glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer.bufferid);
+      GLStateTracker::current().bindBuffer(GL_ARRAY_BUFFER, vertex_buffer.bufferid);
 
       glEnableVertexAttribArray(attr_idx);
     }
@@ -575,7 +587,7 @@ auto createVertexArrayGeneric_impl(
   //   - They record global state, so subsequent
   //     seemingly unrelated function calls could
   //     leave it in an altered state
-  if(!dsa_path) glBindVertexArray(0);
+  if(!dsa_path) GLStateTracker::current().bindVertexArray(GLNullId);
 
   return vertex_array;
 }
@@ -583,7 +595,10 @@ auto createVertexArrayGeneric_impl(
 auto GLVertexFormat::createVertexArray_vertex_attrib_binding() const -> GLVertexArray
 {
   constexpr auto create_path = vertex_format_detail::Path_vertex_attrib_binding;
-  auto arrayid = createVertexArrayGeneric_impl<create_path>(buffers_, attributes_);
+
+  auto arrayid = GLContext::current()->caps().directStateAccess() ?
+    createVertexArrayGeneric_impl<create_path, true>(buffers_, attributes_) :
+    createVertexArrayGeneric_impl<create_path, false>(buffers_, attributes_);
 
   GLVertexArray array;
   array.id_ = arrayid;
@@ -598,7 +613,9 @@ auto GLVertexFormat::createVertexArray_vertex_attrib_binding() const -> GLVertex
 auto GLVertexFormat::createVertexArray_vertex_array_object() const -> GLVertexArray
 {
   constexpr auto create_path = vertex_format_detail::Path_vertex_array_object;
-  auto arrayid = createVertexArrayGeneric_impl<create_path>(buffers_, attributes_);
+
+  // The DSA path is never taken along with Path_vertex_array_object
+  auto arrayid = createVertexArrayGeneric_impl<create_path, false>(buffers_, attributes_);
 
   GLVertexArray array;
   array.id_ = arrayid;
@@ -655,14 +672,14 @@ auto GLVertexArray::bind() -> GLVertexArray&
 {
   assert(id_ != GLNullId && "attempted to bind() a null GLVertexArray!");
 
-  glBindVertexArray(id_);
+  GLStateTracker::current().bindVertexArray(id_);
 
   return *this;
 }
 
 auto GLVertexArray::unbind() -> GLVertexArray&
 {
-  glBindVertexArray(0);
+  GLStateTracker::current().bindVertexArray(GLNullId);
 
   return *this;
 }
@@ -672,6 +689,8 @@ auto GLVertexArray::doDestroy() -> GLObject&
   if(id_ == GLNullId) return *this;
 
   glDeleteVertexArrays(1, &id_);
+  if(auto context = GLContext::current()) context->state().forgetVertexArray(id_);
+
   id_ = GLNullId;
 
   return *this;
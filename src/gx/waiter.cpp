@@ -0,0 +1,100 @@
+#include <gx/waiter.h>
+#include <gx/context.h>
+#include <window/event.h>
+
+#include <util/trace.h>
+
+#include <cassert>
+
+#include <utility>
+
+namespace brdrive {
+
+GLFenceWaiter::GLFenceWaiter(IEventLoop& event_loop, GLContext& context, u32 event_code) :
+  event_loop_(event_loop), context_(context), event_code_(event_code),
+  num_pending_(0), quit_(false)
+{
+  worker_ = std::thread(&GLFenceWaiter::workerMain, this);
+}
+
+GLFenceWaiter::~GLFenceWaiter()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_.store(true);
+  }
+  pending_available_.notify_one();
+
+  worker_.join();
+
+  // Any fences which are still in 'pending_' get deleted
+  //   here, in the context of the calling thread
+}
+
+auto GLFenceWaiter::wait(GLFence&& fence, uptr data) -> GLFenceWaiter&
+{
+  assert(fence.fenced() && "attempted to wait() on a null fence!");
+
+  fence.flush();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    pending_.push_back(Pending { std::move(fence), data });
+    num_pending_++;
+  }
+  pending_available_.notify_one();
+
+  return *this;
+}
+
+auto GLFenceWaiter::numPending() const -> unsigned
+{
+  return num_pending_.load();
+}
+
+void GLFenceWaiter::workerMain()
+{
+  context_.makeCurrent();
+
+  trace_thread_name("GLFenceWaiter");
+
+  while(true) {
+    Pending pending;
+
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      pending_available_.wait(lock, [this]() { return quit_.load() || !pending_.empty(); });
+
+      if(quit_.load()) break;
+
+      pending = std::move(pending_.front());
+      pending_.pop_front();
+    }
+
+    {
+      TraceZone trace_zone("GLFenceWaiter.block", TraceWait);
+
+      auto status = GLFence::WaitStatusInvalid;
+      try {
+        while((status = pending.fence.block(WaitSliceNs)) == GLFence::WaitTimeoutExpired) {
+          if(quit_.load()) break;
+        }
+      } catch(const GLFence::WaitError&) {
+        // The fence will never be signaled - report it as
+        //   such anyways, so the poster isn't left hanging
+        status = GLFence::WaitConditionSatisfied;
+      }
+
+      if(status != GLFence::WaitConditionSatisfied) break;    // 'quit_' == true
+    }
+
+    // Delete the sync object while this thread's context is current
+    pending.fence.reset();
+    num_pending_--;
+
+    event_loop_.post(UserEvent::alloc(event_code_, pending.data));
+  }
+}
+
+}
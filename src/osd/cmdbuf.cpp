@@ -0,0 +1,310 @@
+#include <osd/cmdbuf.h>
+#include <osd/surface.h>
+
+#include <gx/context.h>
+#include <gx/vertex.h>
+#include <gx/program.h>
+#include <gx/buffer.h>
+#include <gx/texture.h>
+#include <gx/fence.h>
+
+#include <cassert>
+#include <cstring>
+
+#include <algorithm>
+#include <utility>
+
+namespace brdrive {
+
+OSDCommandBuffer::OSDCommandBuffer() :
+  num_draws_(0),
+  generation_(0)
+{
+  resetRecordState();
+}
+
+auto OSDCommandBuffer::record(const OSDDrawCall& drawcall) -> DrawHandle
+{
+  assert((drawcall.command != OSDDrawCall::DrawInvalid && drawcall.type != OSDDrawCall::DrawTypeInvalid) &&
+      "attempted to record() an invalid OSDDrawCall!");
+  assert(drawcall.verts && "attempted to record() an OSDDrawCall with a null vertex array!");
+
+  auto& state = record_state_;
+  auto handle = DrawHandle { DrawHandle::None, DrawHandle::None };
+
+  Command command;
+  memset(&command, 0, sizeof(command));
+
+  auto program = &OSDSurface::renderProgram(drawcall.type);
+  if(program != state.program) {
+    command.op = OpUseProgram;
+    command.program = program;
+
+    append(command);
+    state.program = program;
+  }
+
+  switch(drawcall.type) {
+  case OSDDrawCall::DrawString:
+  case OSDDrawCall::DrawStringGlyphs:
+  case OSDDrawCall::DrawStringStorage:
+  case OSDDrawCall::DrawStringStorageGlyphs:
+    command.op  = OpUniformInt;
+    command.arg = UnresolvedLocation;
+    command.uniform.program = program;
+    command.uniform.name    = "uiStringAttributesBaseOffset";
+    command.uniform.type    = GLProgram::Int;
+    command.uniform.value   = (int)drawcall.base_instance;
+
+    handle.base_instance = append(command);
+    break;
+
+  default: break;    // The other draw types have no base offset uniform
+  }
+
+  for(unsigned i = 0; i < drawcall.textures_end; i++) {
+    auto [tex, sampler] = drawcall.textures.at(i);
+    if(!tex) continue;    // Empty slot...
+
+    if(state.textures.at(i) != drawcall.textures.at(i)) {
+      command.op  = OpBindTexture;
+      command.arg = i;
+      command.texture.tex     = tex;
+      command.texture.sampler = sampler;
+
+      append(command);
+      state.textures.at(i) = drawcall.textures.at(i);
+    }
+
+    auto uniform_name = osd_detail::texture_uniform_name(drawcall.type, i);
+    assert(uniform_name);
+
+    auto sampler_uniform = std::make_pair(program, uniform_name);
+
+    auto& sampler_uniforms = state.sampler_uniforms;
+    if(std::find(sampler_uniforms.begin(), sampler_uniforms.end(), sampler_uniform) != sampler_uniforms.end()) {
+      continue;
+    }
+
+    command.op  = OpUniformInt;
+    command.arg = UnresolvedLocation;
+    command.uniform.program = program;
+    command.uniform.name    = uniform_name;
+    command.uniform.type    = GLProgram::TexImageUnit;
+    command.uniform.value   = (int)i;   // The tex image unit's index
+
+    append(command);
+    sampler_uniforms.push_back(sampler_uniform);
+  }
+
+  // The storage blocks' bindings are fixed in the programs,
+  //   so (unlike the textures) no uniforms are needed
+  for(unsigned i = 0; i < drawcall.storage_buffers_end; i++) {
+    auto buffer = drawcall.storage_buffers.at(i);
+    if(!buffer || state.storage_buffers.at(i) == buffer) continue;
+
+    command.op  = OpBindStorageBuffer;
+    command.arg = i;
+    command.storage_buffer = buffer;
+
+    append(command);
+    state.storage_buffers.at(i) = buffer;
+  }
+
+  if(drawcall.verts != state.verts || drawcall.inds != state.inds) {
+    command.op  = OpBindVertexArray;
+    command.arg = 0;
+    command.vertex_array.verts = drawcall.verts;
+    command.vertex_array.inds  = drawcall.inds;
+
+    append(command);
+    state.verts = drawcall.verts;
+    state.inds  = drawcall.inds;
+  }
+
+  memset(&command, 0, sizeof(command));
+
+  command.op  = OpDraw;
+  command.arg = drawcall.command;
+  command.draw.indirect = drawcall.indirect;
+
+  handle.draw = append(command);
+  num_draws_++;
+
+  // Fill in the dynamic parameters
+  patch(handle, drawcall);
+
+  return handle;
+}
+
+auto OSDCommandBuffer::patch(DrawHandle handle, const OSDDrawCall& drawcall) -> OSDCommandBuffer&
+{
+  assert(handle.draw < commands_.size() && "the DrawHandle is invalid! (was the buffer clear()'ed?)");
+
+  auto& draw_command = commands_[handle.draw];
+
+  assert(draw_command.op == OpDraw && draw_command.arg == (u32)drawcall.command &&
+      "attempted to patch() a draw with an OSDDrawCall which has a different command!");
+  assert((drawcall.count >= 0 && drawcall.offset >= 0) &&
+      "attempted to patch() a draw with a negative vertex count or offset!");
+
+  auto& draw = draw_command.draw;
+
+  draw.offset         = drawcall.offset;
+  draw.inds_type      = drawcall.inds_type;
+  draw.count          = drawcall.count;
+  draw.base_instance  = drawcall.base_instance;
+  draw.instance_count = drawcall.instance_count;
+  draw.draw_count     = drawcall.draw_count;
+
+  if(handle.base_instance != DrawHandle::None) {
+    assert(commands_[handle.base_instance].op == OpUniformInt);
+
+    commands_[handle.base_instance].uniform.value = (int)drawcall.base_instance;
+  }
+
+  return *this;
+}
+
+auto OSDCommandBuffer::replay(GLContext& gl_context) -> GLFence
+{
+  replayNoFence(gl_context);
+
+  return std::move(GLFence().fence());   // Return a primed fence
+}
+
+auto OSDCommandBuffer::replayNoFence(GLContext& gl_context) -> OSDCommandBuffer&
+{
+  GLVertexArray *bound_verts = nullptr;
+  GLIndexBuffer *bound_inds  = nullptr;
+
+  for(auto& command : commands_) {
+    switch(command.op) {
+    case OpUseProgram:
+      command.program->use();
+      break;
+
+    case OpBindTexture: {
+      auto& tex_image_unit = gl_context.texImageUnit(command.arg);
+
+      auto tex = command.texture.tex;
+      auto sampler = command.texture.sampler;
+      if(!sampler) {
+        tex_image_unit.bind(*tex);
+      } else /* tex && sampler */ {
+        tex_image_unit.bind(*tex, *sampler);
+      }
+      break;
+    }
+
+    case OpBindStorageBuffer:
+      gl_context.bufferBindPoint(ShaderStorageType, command.arg).bind(*command.storage_buffer);
+      break;
+
+    case OpUniformInt: {
+      auto program = command.uniform.program;
+
+      // Resolving the location requires a GL call,
+      //   so it can't be done during record()
+      if(command.arg == UnresolvedLocation) {
+        command.arg = (u32)program->uniformLocation(
+            command.uniform.name, (GLProgram::UniformType)command.uniform.type
+        );
+      }
+
+      program->uniformAt((GLProgram::UniformLocation)command.arg, command.uniform.value);
+      break;
+    }
+
+    case OpBindVertexArray:
+      // Same order as in OSDDrawCall::submit() - can't bind
+      //   to ELEMENT_ARRAY_BUFFER with no VAO bound
+      bound_verts = command.vertex_array.verts;
+      bound_inds  = command.vertex_array.inds;
+
+      bound_verts->bind();
+      if(bound_inds) bound_inds->bind();
+      break;
+
+    case OpDraw: {
+      const auto& draw = command.draw;
+
+      assert(bound_verts && "an OpDraw was recorded before any OpBindVertexArray!");
+
+      if(draw.indirect) draw.indirect->bind();
+
+      osd_detail::issue_draw(
+          command.arg, draw.inds_type, draw.offset, draw.count, draw.base_instance,
+          draw.instance_count, draw.draw_count
+      );
+      break;
+    }
+
+    default: assert(0);   // Unreachable
+    }
+  }
+
+  // Like OSDDrawCall::submit() - everything is left bound, so
+  //   the next replay() (or submit()) with the same VAO can
+  //   skip binding it again
+
+  return *this;
+}
+
+auto OSDCommandBuffer::clear() -> OSDCommandBuffer&
+{
+  commands_.clear();
+  num_draws_ = 0;
+
+  generation_++;
+
+  resetRecordState();
+
+  return *this;
+}
+
+auto OSDCommandBuffer::empty() const -> bool
+{
+  return commands_.empty();
+}
+
+auto OSDCommandBuffer::size() const -> size_t
+{
+  return commands_.size();
+}
+
+auto OSDCommandBuffer::numDraws() const -> size_t
+{
+  return num_draws_;
+}
+
+auto OSDCommandBuffer::generation() const -> u32
+{
+  return generation_;
+}
+
+auto OSDCommandBuffer::append(const Command& command) -> u32
+{
+  commands_.push_back(command);
+
+  return (u32)(commands_.size()-1);
+}
+
+void OSDCommandBuffer::resetRecordState()
+{
+  auto& state = record_state_;
+
+  state.program = nullptr;
+
+  for(auto& tex_and_sampler : state.textures) {
+    tex_and_sampler = OSDDrawCall::TextureAndSampler(nullptr, nullptr);
+  }
+  state.storage_buffers.fill(nullptr);
+
+  state.verts = nullptr;
+  state.inds  = nullptr;
+
+  state.sampler_uniforms.clear();
+}
+
+}
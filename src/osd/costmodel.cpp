@@ -0,0 +1,98 @@
+#include <osd/costmodel.h>
+
+#include <cassert>
+
+#include <algorithm>
+#include <limits>
+
+namespace brdrive {
+
+auto OSDStringCostModel::global() -> OSDStringCostModel&
+{
+  // A draw costs about as much as ~2000 vertex shader
+  //   invocations (i.e. ~500 culled glyphs), the extra
+  //   fetch of the per-glyph instances costs ~20%
+  static OSDStringCostModel s_cost_model = {
+    1000.0f /* draw_ns */, 0.5f /* vertex_ns */, 0.6f /* glyph_vertex_ns */,
+    0 /* generation */,
+  };
+
+  return s_cost_model;
+}
+
+auto OSDStringCostModel::bucketCost(u32 count, u32 max_length) const -> float
+{
+  return draw_ns + vertex_ns * (float)(VerticesPerGlyph * max_length) * (float)count;
+}
+
+auto OSDStringCostModel::glyphsCost(u32 num_glyphs) const -> float
+{
+  return draw_ns + glyph_vertex_ns * (float)VerticesPerGlyph * (float)num_glyphs;
+}
+
+auto OSDStringCostModel::partition(
+    const std::vector<u32>& length_histogram, unsigned max_buckets
+  ) const -> std::vector<u32>
+{
+  assert(max_buckets > 0);
+
+  // Gather the lengths which occur along with a running
+  //   count of the strings, so that the number of strings
+  //   in the range of lengths [i;j] is prefix[j+1] - prefix[i]
+  std::vector<u32> lengths;
+  std::vector<u64> prefix = { 0 };
+  for(u32 length = 0; length < length_histogram.size(); length++) {
+    if(!length_histogram[length]) continue;
+
+    lengths.push_back(length);
+    prefix.push_back(prefix.back() + length_histogram[length]);
+  }
+
+  const size_t num_lengths = lengths.size();
+  if(!num_lengths) return {};
+
+  // best[j+1] is the lowest cost of drawing the strings with lengths
+  //   [lengths[0];lengths[j]], where the last bucket starts at
+  //   lengths[start[j+1]]
+  std::vector<float> best(num_lengths+1);
+  std::vector<size_t> start(num_lengths+1);
+
+  auto solve = [&](float draw_cost) -> std::vector<u32> {
+    best[0] = 0.0f;
+    for(size_t j = 0; j < num_lengths; j++) {
+      best[j+1] = std::numeric_limits<float>::max();
+
+      for(size_t i = 0; i <= j; i++) {
+        auto count = prefix[j+1] - prefix[i];
+        auto cost = best[i] + draw_cost +
+            vertex_ns * (float)(VerticesPerGlyph * lengths[j]) * (float)count;
+
+        if(cost < best[j+1]) {
+          best[j+1] = cost;
+          start[j+1] = i;
+        }
+      }
+    }
+
+    // Walk the buckets back from the longest lengths
+    std::vector<u32> bucket_max_lengths;
+    for(size_t end = num_lengths; end > 0; end = start[end]) {
+      bucket_max_lengths.insert(bucket_max_lengths.begin(), lengths[end-1]);
+    }
+
+    return bucket_max_lengths;
+  };
+
+  // Make the draws more expensive until the strings fit in 'max_buckets'
+  //   - Only happens when 'draw_ns' is tiny compared to 'vertex_ns'
+  auto draw_cost = std::max(draw_ns, std::numeric_limits<float>::min());
+  auto buckets = solve(draw_cost);
+  while(buckets.size() > max_buckets) {
+    draw_cost *= 2.0f;
+    buckets = solve(draw_cost);
+  }
+
+  return buckets;
+}
+
+}
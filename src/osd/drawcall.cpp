@@ -1,5 +1,6 @@
 #include <osd/drawcall.h>
 #include <osd/surface.h>
+#include <osd/layout.h>
 
 #include <gx/context.h>
 #include <gx/vertex.h>
@@ -20,17 +21,21 @@ namespace brdrive {
 
 OSDDrawCall::OSDDrawCall() :
   command(DrawInvalid), type(DrawTypeInvalid),
-  verts(nullptr), inds_type(GLType::Invalid),
-  offset(-1), count(-1), instance_count(-1),
-  textures_end(0)
+  verts(nullptr), inds_type(GLType::Invalid), inds(nullptr),
+  offset(-1), count(-1), base_instance(0), instance_count(-1),
+  indirect(nullptr), draw_count(-1),
+  textures_end(0),
+  storage_buffers_end(0)
 {
   for(auto& tex_and_sampler : textures) {
     tex_and_sampler = TextureAndSampler(nullptr, nullptr);
   }
+
+  storage_buffers.fill(nullptr);
 }
 
 auto osd_drawcall_strings(
-    GLVertexArray *verts_, GLType inds_type_, GLIndexBuffer *inds_, GLSizePtr base_offset,
+    GLVertexArray *verts_, GLSizePtr base_offset,
     GLSize max_string_len_, GLSize num_strings_,
     GLTexture2D *font_tex_, GLSampler *font_sampler_, GLTextureBuffer *strings_, GLTextureBuffer *attrs_
   ) -> OSDDrawCall
@@ -44,16 +49,15 @@ auto osd_drawcall_strings(
 
   auto drawcall = OSDDrawCall();
 
-  drawcall.command = OSDDrawCall::DrawIndexedInstanced;
+  drawcall.command = OSDDrawCall::DrawArrayInstanced;
   drawcall.type    = OSDDrawCall::DrawString;
 
   drawcall.verts = verts_;
-  drawcall.inds_type = inds_type_; drawcall.inds = inds_; drawcall.offset = 0;
+  drawcall.offset = 0;
 
-  // Each glyph consists of a triangle fan with 4 vertices,
-  //   which form a quad and a 5th vertex which is the
-  //   PRIMITIVE_RESTART_INDEX
-  drawcall.count = max_string_len_*5;
+  // Each glyph is a quad made up of 4 vertices of
+  //   the string's triangle strip
+  drawcall.count = max_string_len_*4;
 
   drawcall.base_instance = base_offset;
   drawcall.instance_count = num_strings_;
@@ -70,11 +74,154 @@ auto osd_drawcall_strings(
   return drawcall;
 }
 
+auto osd_drawcall_strings_indirect(
+    GLVertexArray *verts_,
+    GLDrawIndirectBuffer *indirect_, GLSizePtr indirect_offset, GLSize num_buckets_,
+    GLTexture2D *font_tex_, GLSampler *font_sampler_, GLTextureBuffer *strings_, GLTextureBuffer *attrs_
+  ) -> OSDDrawCall
+{
+  // Start off with a regular DrawString draw call, as all the
+  //   bindings are the same and only the way the draw
+  //   parameters are sourced differs
+  auto drawcall = osd_drawcall_strings(
+      verts_, 0,
+      0, 0,
+      font_tex_, font_sampler_, strings_, attrs_
+  );
+
+  drawcall.command = OSDDrawCall::MultiDrawArrayIndirect;
+  drawcall.type    = OSDDrawCall::DrawStringIndirect;
+
+  // The counts are now stored in the indirect commands
+  drawcall.offset = indirect_offset;
+  drawcall.count  = 0;
+
+  drawcall.base_instance  = 0;
+  drawcall.instance_count = 0;
+
+  drawcall.indirect   = indirect_;
+  drawcall.draw_count = num_buckets_;
+
+  return drawcall;
+}
+
+auto osd_drawcall_string_glyphs(
+    GLVertexArray *verts_, GLSize num_glyphs_,
+    GLTexture2D *font_tex_, GLSampler *font_sampler_,
+    GLTextureBuffer *strings_, GLTextureBuffer *attrs_, GLTextureBuffer *glyphs_
+  ) -> OSDDrawCall
+{
+  auto drawcall = osd_drawcall_strings(
+      verts_, 0,
+      1 /* max_string_len_ */, num_glyphs_,
+      font_tex_, font_sampler_, strings_, attrs_
+  );
+
+  drawcall.type = OSDDrawCall::DrawStringGlyphs;
+
+  // The glyphs' string indices come right after
+  //   the textures used by DrawString
+  drawcall.textures.at(3) = OSDDrawCall::TextureAndSampler(glyphs_, nullptr);
+  drawcall.textures_end = 4;
+
+  return drawcall;
+}
+
+auto osd_drawcall_strings_instanced(
+    GLVertexArray *verts_, GLSize base_instance,
+    GLSize max_string_len_, GLSize num_strings_,
+    GLDrawIndirectBuffer *indirect_, GLSizePtr indirect_offset, GLSize num_buckets_,
+    GLTexture2D *font_tex_, GLSampler *font_sampler_, GLTextureBuffer *strings_
+  ) -> OSDDrawCall
+{
+  // The attributes texture buffer isn't used
+  auto drawcall = !indirect_ ?
+      osd_drawcall_strings(
+        verts_, base_instance,
+        max_string_len_, num_strings_,
+        font_tex_, font_sampler_, strings_, nullptr
+      ) :
+      osd_drawcall_strings_indirect(
+        verts_,
+        indirect_, indirect_offset, num_buckets_,
+        font_tex_, font_sampler_, strings_, nullptr
+      );
+
+  if(!indirect_) drawcall.command = OSDDrawCall::DrawArrayInstancedBaseInstance;
+  drawcall.type = OSDDrawCall::DrawStringInstanced;
+
+  drawcall.textures_end = 2;
+
+  return drawcall;
+}
+
+auto osd_drawcall_strings_storage(
+    GLVertexArray *verts_, GLSizePtr base_offset,
+    GLSize max_string_len_, GLSize num_strings_,
+    GLDrawIndirectBuffer *indirect_, GLSizePtr indirect_offset, GLSize num_buckets_,
+    GLTexture2D *font_tex_, GLSampler *font_sampler_,
+    GLShaderStorageBuffer *strings_, GLShaderStorageBuffer *attrs_
+  ) -> OSDDrawCall
+{
+  // Only the font is still bound to a texture image unit
+  auto drawcall = !indirect_ ?
+      osd_drawcall_strings(
+        verts_, base_offset,
+        max_string_len_, num_strings_,
+        font_tex_, font_sampler_, nullptr, nullptr
+      ) :
+      osd_drawcall_strings_indirect(
+        verts_,
+        indirect_, indirect_offset, num_buckets_,
+        font_tex_, font_sampler_, nullptr, nullptr
+      );
+
+  drawcall.type = !indirect_ ? OSDDrawCall::DrawStringStorage : OSDDrawCall::DrawStringStorageIndirect;
+
+  drawcall.textures_end = 1;
+
+  drawcall.storage_buffers.at(osd_detail::StringCharactersStorageBinding) = strings_;
+  drawcall.storage_buffers.at(osd_detail::StringAttributesStorageBinding) = attrs_;
+  drawcall.storage_buffers_end = osd_detail::StringAttributesStorageBinding+1;
+
+  return drawcall;
+}
+
+auto osd_drawcall_string_glyphs_storage(
+    GLVertexArray *verts_, GLSize num_glyphs_,
+    GLTexture2D *font_tex_, GLSampler *font_sampler_,
+    GLShaderStorageBuffer *strings_, GLShaderStorageBuffer *attrs_, GLShaderStorageBuffer *glyphs_
+  ) -> OSDDrawCall
+{
+  auto drawcall = osd_drawcall_strings_storage(
+      verts_, 0,
+      1 /* max_string_len_ */, num_glyphs_,
+      nullptr, 0, 0,
+      font_tex_, font_sampler_, strings_, attrs_
+  );
+
+  drawcall.type = OSDDrawCall::DrawStringStorageGlyphs;
+
+  drawcall.storage_buffers.at(osd_detail::StringGlyphsStorageBinding) = glyphs_;
+  drawcall.storage_buffers_end = osd_detail::StringGlyphsStorageBinding+1;
+
+  return drawcall;
+}
+
 auto osd_submit_drawcall(
     GLContext& gl_context,  const OSDDrawCall& drawcall
   ) -> GLFence
 {
-  return std::move(drawcall.submit(OSDDrawCall::SubmitFriendKey(), gl_context));
+  osd_submit_drawcall_no_fence(gl_context, drawcall);
+
+  return std::move(GLFence().fence());   // Return a primed fence
+}
+
+auto osd_submit_drawcall_no_fence(
+    GLContext& gl_context,  const OSDDrawCall& drawcall
+  ) -> void
+{
+  drawcall.submit(OSDDrawCall::SubmitFriendKey(), gl_context);
 }
 
 // The inner array include a sentinel 'nullptr' at the end of the names
@@ -90,6 +237,24 @@ static const char *s_uniform_names[OSDDrawCall::NumDrawTypes][16 /* aribitrary *
 
   // OSDSurface::DrawShadedQuad (TODO!)
   { nullptr },
+
+  // OSDSurface::DrawStringIndirect
+  { "usFont", "usStrings", "usStringAttributes", nullptr },
+
+  // OSDSurface::DrawStringGlyphs
+  { "usFont", "usStrings", "usStringAttributes", "usStringGlyphs", nullptr },
+
+  // OSDSurface::DrawStringInstanced
+  { "usFont", "usStrings", nullptr },
+
+  // OSDSurface::DrawStringStorage
+  { "usFont", nullptr },
+
+  // OSDSurface::DrawStringStorageIndirect
+  { "usFont", nullptr },
+
+  // OSDSurface::DrawStringStorageGlyphs
+  { "usFont", nullptr },
 };
 
 [[using gnu: always_inline]]
@@ -106,7 +271,63 @@ static constexpr auto GLType_to_index_buf_type(GLType type) -> GLEnum
   return GL_INVALID_ENUM;
 }
 
-auto OSDDrawCall::submit(SubmitFriendKey, GLContext& gl_context) const -> GLFence
+namespace osd_detail {
+
+void issue_draw(
+    int /* OSDDrawCall::DrawCommandType */ command, GLType inds_type,
+    GLSizePtr offset, GLSize count, GLSize base_instance, GLSize instance_count, GLSize draw_count
+  )
+{
+  auto gl_inds_type = GLType_to_index_buf_type(inds_type);
+  auto offset_ptr = (const GLvoid *)offset;
+
+  switch(command) {
+  case OSDDrawCall::DrawArray:
+    glDrawArrays(GL_TRIANGLE_STRIP, offset, count);
+    break;
+
+  case OSDDrawCall::DrawIndexed:
+    glDrawElements(GL_TRIANGLE_STRIP, count, gl_inds_type, offset_ptr);
+    break;
+
+  case OSDDrawCall::DrawArrayInstanced:
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, offset, count, instance_count);
+    break;
+
+  case OSDDrawCall::DrawIndexedInstanced:
+    glDrawElementsInstanced(
+        GL_TRIANGLE_STRIP, count, gl_inds_type, offset_ptr, instance_count
+    );
+    break;
+
+  case OSDDrawCall::DrawArrayInstancedBaseInstance:
+    glDrawArraysInstancedBaseInstance(
+        GL_TRIANGLE_STRIP, offset, count, instance_count, base_instance
+    );
+    break;
+
+  case OSDDrawCall::MultiDrawArrayIndirect:
+    // The GLDrawIndirectBuffer must already be bound
+    glMultiDrawArraysIndirect(
+        GL_TRIANGLE_STRIP, offset_ptr, draw_count, 0 /* tightly packed */
+    );
+    break;
+
+  default: assert(0);   // Unreachable
+  }
+}
+
+auto texture_uniform_name(int draw_type, unsigned slot) -> const char *
+{
+  assert((draw_type > OSDDrawCall::DrawTypeInvalid && draw_type < OSDDrawCall::NumDrawTypes) &&
+      "the given 'draw_type' is invalid!");
+
+  return s_uniform_names[draw_type][slot];
+}
+
+}
+
+auto OSDDrawCall::submit(SubmitFriendKey, GLContext& gl_context) const -> void
 {
   assert((command != DrawInvalid && type != DrawTypeInvalid) &&
       "attempted to submit an invalid OSDDrawCall!");
@@ -119,8 +340,13 @@ auto OSDDrawCall::submit(SubmitFriendKey, GLContext& gl_context) const -> GLFenc
 
   switch(type) {
   case OSDDrawCall::DrawString:
+  case OSDDrawCall::DrawStringGlyphs:
+  case OSDDrawCall::DrawStringStorage:
+  case OSDDrawCall::DrawStringStorageGlyphs:
     program.uniform("uiStringAttributesBaseOffset", (int)base_instance);
     break;
+
+  default: break;    // The other draw types have no base offset uniform
   }
 
   auto tex_uniform_names = s_uniform_names[type];
@@ -144,6 +370,16 @@ auto OSDDrawCall::submit(SubmitFriendKey, GLContext& gl_context) const -> GLFenc
       .uniform(uniform_name, tex_image_unit);
   }
 
+  // The blocks' bindings are a part of the program's state
+  //   (set when it was created), so only the buffers
+  //   need to be bound
+  for(unsigned i = 0; i < storage_buffers_end; i++) {
+    auto buffer = storage_buffers.at(i);
+    if(!buffer) continue;    // Empty slot...
+
+    gl_context.bufferBindPoint(ShaderStorageType, i).bind(*buffer);
+  }
+
   // ...then the vertex array and index buffer...
   assert(verts && "attempted to submit an OSDDrawCall with a null vertex array!");
   assert((count >= 0 && offset >= 0) &&
@@ -151,48 +387,29 @@ auto OSDDrawCall::submit(SubmitFriendKey, GLContext& gl_context) const -> GLFenc
   assert((command != DrawIndexed && command != DrawIndexedInstanced) ||
         (inds_type != GLType::Invalid && inds && instance_count >= 0) &&
       "attempted to submit an indexed draw call with an invalid index buffer supplied!");
-
-  auto gl_inds_type = GLType_to_index_buf_type(inds_type);
-  auto offset_ptr = (const GLvoid *)offset;
+  assert((command != MultiDrawArrayIndirect) || (indirect && draw_count >= 0) &&
+      "attempted to submit an indirect draw call without an indirect buffer!");
 
   assert((command != DrawIndexed && command != DrawIndexedInstanced) ||
-        (gl_inds_type != GL_INVALID_ENUM) &&
+        (GLType_to_index_buf_type(inds_type) != GL_INVALID_ENUM) &&
       "an invalid type was given for the drawcall's index buffer elements!");
 
   // Bind the VAO and (optionally) the IndexBuffer as late
   //   as possible and in the correct order (can't bind to
   //   ELEMENT_ARRAY_BUFFER with no VAO bound)
+  //  - The binds go through the GLStateTracker, so consecutive
+  //    draws which use the same VAO/buffers don't re-bind them
   verts->bind();
   if(inds) inds->bind();
 
-  switch(command) {
-  case DrawArray:
-    glDrawArrays(GL_TRIANGLE_FAN, offset, count);
-    break;
-
-  case DrawIndexed:
-    glDrawElements(GL_TRIANGLE_FAN, count, gl_inds_type, offset_ptr);
-    break;
+  if(command == MultiDrawArrayIndirect) indirect->bind();
 
-  case DrawArrayInstanced:
-    glDrawArraysInstanced(GL_TRIANGLE_FAN, offset, count, instance_count);
-    break;
+  osd_detail::issue_draw(command, inds_type, offset, count, base_instance, instance_count, draw_count);
 
-  case DrawIndexedInstanced:
-    glDrawElementsInstanced(
-        GL_TRIANGLE_FAN, count, gl_inds_type, offset_ptr, instance_count
-    );
-    break;
-
-  default: assert(0);   // Unreachable
-  }
-
-  // Make sure to clean-up after drawing as leaving VAOs and 'ELEMENT_ARRAY_BUFFER'
-  //   buffer objects bound can alter those object's internal state unexpectedly
-  verts->unbind();
-  if(inds) inds->unbind();
-
-  return std::move(GLFence().fence());   // Return a primed fence
+  // Everything is left bound on purpose - the GLStateTracker
+  //   knows the VAO's current ELEMENT_ARRAY_BUFFER binding, so
+  //   binding some other buffer to it in the meantime causes the
+  //   next submit() to re-bind the correct one
 }
 
 }
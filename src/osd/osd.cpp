@@ -33,6 +33,23 @@ void osd_init()
   //   TODO: unimplemented...
   OSDSurface::s_surface_programs[OSDDrawCall::DrawShadedQuad] = init_DrawShadedQuad_program();
 
+  // OSDDrawCall::DrawStringIndirect
+  //   - nullptr when the required extensions are missing
+  OSDSurface::s_surface_programs[OSDDrawCall::DrawStringIndirect] = init_DrawStringIndirect_program();
+
+  // OSDDrawCall::DrawStringGlyphs
+  OSDSurface::s_surface_programs[OSDDrawCall::DrawStringGlyphs] = init_DrawStringGlyphs_program();
+
+  // OSDDrawCall::DrawStringInstanced
+  //   - nullptr when the required extensions are missing
+  OSDSurface::s_surface_programs[OSDDrawCall::DrawStringInstanced] = init_DrawStringInstanced_program();
+
+  // OSDDrawCall::DrawStringStorage, DrawStringStorageIndirect, DrawStringStorageGlyphs
+  //   - nullptr when the required extensions are missing
+  OSDSurface::s_surface_programs[OSDDrawCall::DrawStringStorage] = init_DrawStringStorage_program();
+  OSDSurface::s_surface_programs[OSDDrawCall::DrawStringStorageIndirect] = init_DrawStringStorageIndirect_program();
+  OSDSurface::s_surface_programs[OSDDrawCall::DrawStringStorageGlyphs] = init_DrawStringStorageGlyphs_program();
+
   g_osd_was_init = true;
 }
 
@@ -0,0 +1,196 @@
+#include <osd/queue.h>
+#include <osd/surface.h>
+
+#include <gx/context.h>
+#include <gx/pipeline.h>
+#include <gx/program.h>
+#include <gx/vertex.h>
+#include <gx/fence.h>
+
+#include <cassert>
+
+#include <algorithm>
+#include <utility>
+
+namespace brdrive {
+
+OSDRenderQueue::OSDRenderQueue() :
+  stats_({ 0, 0, 0, 0, 0 })
+{
+}
+
+template <typename T>
+auto OSDRenderQueue::denseId(std::vector<T>& values, const T& value, unsigned bits) -> u64
+{
+  // There are very few distinct states per frame,
+  //   so a linear search is the fastest option
+  auto it = std::find(values.begin(), values.end(), value);
+  if(it != values.end()) return it - values.begin();
+
+  if(values.size() >= (1ull<<bits)) throw TooManyStatesError();
+
+  values.push_back(value);
+  return values.size()-1;
+}
+
+auto OSDRenderQueue::push(const OSDDrawCall& drawcall, GLPipeline *pipeline, u32 depth) -> OSDRenderQueue&
+{
+  assert(drawcall.verts && "attempted to push() an OSDDrawCall with a null vertex array!");
+  assert(depth <= MaxDepth && "the 'depth' must be <= OSDRenderQueue::MaxDepth!");
+
+  auto program_id = OSDSurface::renderProgram(drawcall.type).id();
+
+  u64 key = 0;
+  key |= denseId(seen_pipelines_, pipeline, PipelineBits) << PipelineShift;
+  key |= denseId(seen_programs_, program_id, ProgramBits) << ProgramShift;
+  key |= denseId(seen_textures_, drawcall.textures, TexturesBits) << TexturesShift;
+  key |= denseId(seen_verts_, drawcall.verts->id(), VertsBits) << VertsShift;
+  key |= (u64)depth << DepthShift;
+
+  items_.push_back(Item { key, (u32)drawcalls_.size() });
+
+  drawcalls_.push_back(drawcall);
+  pipelines_.push_back(pipeline);
+
+  return *this;
+}
+
+auto OSDRenderQueue::push(
+    const std::vector<OSDDrawCall>& drawcalls, GLPipeline *pipeline, u32 depth
+  ) -> OSDRenderQueue&
+{
+  for(const auto& drawcall : drawcalls) push(drawcall, pipeline, depth);
+
+  return *this;
+}
+
+auto OSDRenderQueue::flush(GLContext& gl_context) -> OSDRenderQueue&
+{
+  sortItems();
+
+  stats_ = { (unsigned)items_.size(), 0, 0, 0, 0 };
+
+  // Sentinel key which never matches any of the fields of a real one
+  u64 last_key = ~0ull;
+
+  auto field = [](u64 key, u64 shift, u64 bits) -> u64 {
+    return (key >> shift) & ((1ull<<bits) - 1);
+  };
+
+  for(const auto& item : items_) {
+    const auto& drawcall = drawcalls_[item.index];
+    auto pipeline = pipelines_[item.index];
+
+    bool first = last_key == ~0ull;
+
+    if(first || field(item.key, PipelineShift, PipelineBits) != field(last_key, PipelineShift, PipelineBits)) {
+      if(pipeline) pipeline->use();
+
+      stats_.pipeline_switches++;
+    }
+
+    if(first || field(item.key, ProgramShift, ProgramBits) != field(last_key, ProgramShift, ProgramBits)) {
+      stats_.program_switches++;
+    }
+    if(first || field(item.key, TexturesShift, TexturesBits) != field(last_key, TexturesShift, TexturesBits)) {
+      stats_.texture_switches++;
+    }
+    if(first || field(item.key, VertsShift, VertsBits) != field(last_key, VertsShift, VertsBits)) {
+      stats_.verts_switches++;
+    }
+
+    // The program, textures and vertex array bindings are
+    //   cached by the gx objects, so consecutive draw calls
+    //   which share them don't cause redundant binds
+    //  - The caller fences the whole queue if needed
+    osd_submit_drawcall_no_fence(gl_context, drawcall);
+
+    last_key = item.key;
+  }
+
+  return clear();
+}
+
+auto OSDRenderQueue::flushFenced(GLContext& gl_context) -> GLFence
+{
+  flush(gl_context);
+
+  // Fences are signaled in order, so a single one
+  //   covers all of the draws submitted before it
+  return std::move(GLFence().fence());
+}
+
+auto OSDRenderQueue::clear() -> OSDRenderQueue&
+{
+  drawcalls_.clear();
+  pipelines_.clear();
+  items_.clear();
+
+  seen_pipelines_.clear();
+  seen_programs_.clear();
+  seen_textures_.clear();
+  seen_verts_.clear();
+
+  return *this;
+}
+
+auto OSDRenderQueue::empty() const -> bool
+{
+  return drawcalls_.empty();
+}
+
+auto OSDRenderQueue::stats() const -> Stats
+{
+  return stats_;
+}
+
+void OSDRenderQueue::sortItems()
+{
+  constexpr unsigned RadixBits = 8;
+  constexpr unsigned NumBuckets = 1u << RadixBits;
+  constexpr unsigned NumPasses = (sizeof(u64)*8) / RadixBits;
+
+  const size_t num_items = items_.size();
+  if(num_items < 2) return;
+
+  items_scratch_.resize(num_items);
+
+  auto src = &items_;
+  auto dst = &items_scratch_;
+
+  for(unsigned pass = 0; pass < NumPasses; pass++) {
+    const unsigned shift = pass * RadixBits;
+
+    size_t counts[NumBuckets] = { 0 };
+    for(const auto& item : *src) counts[(item.key >> shift) & (NumBuckets-1)]++;
+
+    // All the keys have the same digit in this position,
+    //   which means this pass wouldn't move anything - skip it
+    //   (most passes get skipped this way as the dense ids
+    //   are small numbers)
+    auto first_digit = (src->front().key >> shift) & (NumBuckets-1);
+    if(counts[first_digit] == num_items) continue;
+
+    // Exclusive prefix sum of the counts gives each bucket's offset
+    size_t offset = 0;
+    for(auto& count : counts) {
+      auto bucket_size = count;
+
+      count = offset;
+      offset += bucket_size;
+    }
+
+    for(const auto& item : *src) {
+      auto digit = (item.key >> shift) & (NumBuckets-1);
+
+      (*dst)[counts[digit]++] = item;
+    }
+
+    std::swap(src, dst);
+  }
+
+  // Make sure the sorted result always ends up in 'items_'
+  if(src != &items_) items_.swap(items_scratch_);
+}
+
+}
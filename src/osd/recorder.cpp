@@ -0,0 +1,175 @@
+#include <osd/recorder.h>
+#include <osd/cmdbuf.h>
+#include <osd/surface.h>
+
+#include <gx/context.h>
+#include <gx/fence.h>
+
+#include <util/trace.h>
+
+#include <cassert>
+
+#include <utility>
+#include <algorithm>
+
+namespace brdrive {
+
+OSDRecorder::OSDRecorder(unsigned num_threads) :
+  num_unfinished_(0),
+  quit_(false),
+  num_recorded_(0)
+{
+  if(!num_threads) {
+    // std::thread::hardware_concurrency() can return 0 when
+    //   the number of hardware threads can't be determined
+    auto hw_threads = std::thread::hardware_concurrency();
+
+    num_threads = std::max(hw_threads, 2u) - 1;
+  }
+
+  workers_.reserve(num_threads);
+  for(unsigned i = 0; i < num_threads; i++) {
+    workers_.emplace_back(&OSDRecorder::workerMain, this);
+  }
+}
+
+OSDRecorder::~OSDRecorder()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+  }
+  work_available_.notify_all();
+
+  for(auto& worker : workers_) worker.join();
+}
+
+auto OSDRecorder::record(Job job) -> OSDRecorder&
+{
+  auto cmdbuf = nextCommandBuffer();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    queue_.push_back(WorkItem { std::move(job), cmdbuf });
+    num_unfinished_++;
+  }
+  work_available_.notify_one();
+
+  return *this;
+}
+
+auto OSDRecorder::record(OSDSurface& surface) -> OSDRecorder&
+{
+  // Need to peek at the command buffer the Job will
+  //   receive, as prepareRecord() has to check it
+  //   (the one returned by nextCommandBuffer())
+  if(num_recorded_ == cmdbufs_.size()) cmdbufs_.emplace_back(new OSDCommandBuffer());
+
+  // Nothing changed since the last frame - the Job still has
+  //   to be queued so the buffer gets a slot in submit()
+  if(!surface.prepareRecord(*cmdbufs_[num_recorded_])) return record([](OSDCommandBuffer&) { });
+
+  surfaces_.push_back(&surface);
+
+  return record([&surface](OSDCommandBuffer& cmdbuf) {
+      surface.recordPrepared(cmdbuf);
+  });
+}
+
+auto OSDRecorder::submit(GLContext& gl_context) -> OSDRecorder&
+{
+  TraceZone trace_zone("OSDRecorder::submit");
+
+  std::exception_ptr job_exception = nullptr;
+
+  // Wait for all the Jobs to finish...
+  {
+    TraceZone trace_wait_zone("OSDRecorder::submit.wait", TraceWait);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    work_done_.wait(lock, [this]() { return num_unfinished_ == 0; });
+
+    std::swap(job_exception, job_exception_);
+  }
+
+  // ...unmap the surface's buffers...
+  for(auto surface : surfaces_) surface->finishRecord();
+  surfaces_.clear();
+
+  auto num_recorded = num_recorded_;
+  num_recorded_ = 0;
+
+  if(job_exception) std::rethrow_exception(job_exception);
+
+  // ...and replay the command buffers in order
+  for(unsigned i = 0; i < num_recorded; i++) cmdbufs_[i]->replayNoFence(gl_context);
+
+  return *this;
+}
+
+auto OSDRecorder::submitFenced(GLContext& gl_context) -> GLFence
+{
+  submit(gl_context);
+
+  // Fences are signaled in order, so a single one
+  //   covers all of the command buffers
+  return std::move(GLFence().fence());   // Return a primed fence
+}
+
+auto OSDRecorder::numThreads() const -> unsigned
+{
+  return workers_.size();
+}
+
+void OSDRecorder::workerMain()
+{
+  trace_thread_name("OSDRecorder.worker");
+
+  while(true) {
+    WorkItem work;
+
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_available_.wait(lock, [this]() { return quit_ || !queue_.empty(); });
+
+      if(queue_.empty()) return;   // 'quit_' == true
+
+      work = std::move(queue_.front());
+      queue_.pop_front();
+    }
+
+    std::exception_ptr exception = nullptr;
+    try {
+      TraceZone trace_zone("OSDRecorder.job");
+
+      work.job(*work.cmdbuf);
+    } catch(...) {
+      exception = std::current_exception();
+    }
+
+    bool all_done = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      // Only the first exception is kept
+      if(exception && !job_exception_) job_exception_ = exception;
+
+      all_done = --num_unfinished_ == 0;
+    }
+
+    if(all_done) work_done_.notify_all();
+  }
+}
+
+auto OSDRecorder::nextCommandBuffer() -> OSDCommandBuffer *
+{
+  // The buffers are allocated individually so their addresses
+  //   stay the same when 'cmdbufs_' grows (the worker threads
+  //   hold on to the pointers)
+  if(num_recorded_ == cmdbufs_.size()) cmdbufs_.emplace_back(new OSDCommandBuffer());
+
+  return cmdbufs_[num_recorded_++].get();
+}
+
+}
@@ -1,16 +1,32 @@
 #include <osd/shaders.h>
+#include <osd/layout.h>
 
 #include <gx/program.h>
+#include <gx/extensions.h>
 
 #include <cassert>
 #include <cstdio>
 
+#include <string>
+
 namespace brdrive::osd_detail {
 
+// Must come before s_osd_vs_src when USE_DRAW_PARAMETERS is defined,
+//   as #extension directives can't follow any non-preprocessor tokens
+static const char *s_osd_vs_draw_parameters_src = R"VERT(
+#extension GL_ARB_shader_draw_parameters : require
+)VERT";
+
+// Same as s_osd_vs_draw_parameters_src, for USE_STORAGE_BUFFERS
+static const char *s_osd_vs_storage_buffers_src = R"VERT(
+#extension GL_ARB_shader_storage_buffer_object : require
+)VERT";
+
+// Follows osd_detail::s_string_attributes_glsl (see osd/layout.h)
 static const char *s_osd_vs_src = R"VERT(
 #if defined(USE_INSTANCE_ATTRIBUTES)
-layout(location = 0) in ivec4 viStringXYOffsetLength;
-layout(location = 1) in vec4 viStringColorRGBX;
+// A whole osd_detail::StringAttributes
+layout(location = 0) in uvec4 viStringAttributes;
 #endif
 
 out Vertex {
@@ -20,13 +36,22 @@ out Vertex {
   float Character;
 } vo;
 
-// The positions of a single glyph's vertices
-//   at the screen's top-left corner
-const vec4 GlyphVertPositions[4] = vec4[](
-  vec4(0.0f,  0.0f, 0.0f, 1.0f),
-  vec4(0.0f, 16.0f, 0.0f, 1.0f),
-  vec4(8.0f, 16.0f, 0.0f, 1.0f),
-  vec4(8.0f,  0.0f, 0.0f, 1.0f)
+const vec2 GlyphDimensions = vec2(8.0f, 16.0f);
+
+// The corners of a single glyph's quad in triangle strip order
+//   (top-left, bottom-left, top-right, bottom-right), the
+//   whole string is drawn as ONE strip of these:
+//     - The two triangles between successive glyphs' quads
+//       are degenerate (zero-area) - the top/bottom-right
+//       corners of a glyph and the top/bottom-left corners
+//       of the next one are at the same positions
+//     - So no index buffer (or primitive restart) is
+//       needed to separate the glyphs
+const vec2 GlyphCorners[4] = vec2[](
+  vec2(0.0f, 0.0f),
+  vec2(0.0f, 1.0f),
+  vec2(1.0f, 0.0f),
+  vec2(1.0f, 1.0f)
 );
 
 // UV coordinates which encompass
@@ -34,65 +59,109 @@ const vec4 GlyphVertPositions[4] = vec4[](
 const vec2 UVs[4] = vec2[](
   vec2(0.0f, 0.0f/256.0f /* <usFont height>/<glyph height> -> 4096/16 -> 256 */),
   vec2(0.0f, 1.0f/256.0f),
-  vec2(1.0f, 1.0f/256.0f),
-  vec2(1.0f, 0.0f/256.0f)
+  vec2(1.0f, 0.0f/256.0f),
+  vec2(1.0f, 1.0f/256.0f)
 );
 
 uniform mat4 um4Projection;
 
-uniform isamplerBuffer usStrings;
+#if defined(USE_STORAGE_BUFFERS)
+// The same data as the usStrings, usStringAttributes and usStringGlyphs
+//   texture buffers, read straight from the buffers (without going
+//   through the texture units and the formats' conversions), the
+//   blocks' bindings are set by init_string_program()
+//  - Characters packed four per uint
+layout(std430) readonly buffer StringCharacters {
+  uint ubStringCharacters[];
+};
 
-struct StringAttributes {
-  vec2 position;
-  int offset, length;
+int FetchStringCharacter(int character_num)
+{
+  return UnpackCharacter(ubStringCharacters[character_num >> 2], character_num);
+}
+#else
+// Characters packed four per texel
+uniform usamplerBuffer usStrings;
 
-  vec3 color;
-};
+int FetchStringCharacter(int character_num)
+{
+  return FetchCharacter(usStrings, character_num);
+}
+#endif
 
 #if defined(USE_INSTANCE_ATTRIBUTES)
+// The attributes are sourced by the vertex fetch - the
+//   bucket's offset is the draw's base instance, which
+//   (unlike gl_InstanceID) affects per-instance attributes
 StringAttributes FetchStringAttributes(int string_offset)
 {
-  StringAttributes attrs;
+  return UnpackStringAttributes(viStringAttributes);
+}
+#else
+#if defined(USE_DRAW_PARAMETERS)
+// Each bucket of strings is drawn by a separate command of
+//   a single glMultiDrawArraysIndirect() call - the offset
+//   of the bucket's attributes is stored in the command's
+//   'baseInstance', which doesn't affect gl_InstanceID
+int StringAttributesBaseOffset() { return gl_BaseInstanceARB; }
+#else
+uniform int uiStringAttributesBaseOffset;
 
-  attrs.position = vec2(viStringXYOffsetLength.xy);
-  attrs.offset = viStringXYOffsetLength.z;
-  attrs.length = viStringXYOffsetLength.w;
+int StringAttributesBaseOffset() { return uiStringAttributesBaseOffset; }
+#endif
 
-  attrs.color = viStringColorRGBX.rgb;
+#if defined(USE_STORAGE_BUFFERS)
+layout(std430) readonly buffer StringAttributesStorage {
+  PackedStringAttributes ubStringAttributes[];
+};
 
-  return attrs;
+StringAttributes FetchStringAttributes(int string_offset)
+{
+  return UnpackStringAttributes(ubStringAttributes[StringAttributesBaseOffset() + string_offset]);
 }
 #else
-uniform isamplerBuffer usStringAttributes;
-uniform int uiStringAttributesBaseOffset;
+uniform usamplerBuffer usStringAttributes;
 
-// Fetch the string's properties from a texture, that is:
+// Fetch the string's properties from a texture (a single
+//   texel per string), that is:
 //   * position (expressed in pixels with 0,0 at the top left corner)
 //   * the offset in the usStrings texture at which the string's
 //     characters can be found
 //   * the string's length
-//   * the string's color (which could be packed better, but for now
-//     24-bits per string are wasted)
-//   * 16-bits of padding
+//   * the string's color
 //  and unpack them for convenient access
 StringAttributes FetchStringAttributes(int string_offset)
 {
-  StringAttributes attrs;
-
-  int texel_off = uiStringAttributesBaseOffset + string_offset*2;
+  int texel_off = StringAttributesBaseOffset() + string_offset;
 
-  ivec4 packed0 = texelFetch(usStringAttributes, texel_off+0);
-  ivec4 packed1 = texelFetch(usStringAttributes, texel_off+1);
+  return UnpackStringAttributes(texelFetch(usStringAttributes, texel_off));
+}
+#endif
+#endif
 
-  attrs.position = vec2(packed0.xy);
-  attrs.offset = packed0.z;
-  attrs.length = packed0.w;
+#if defined(USE_GLYPH_INSTANCES)
+// Every instance is a single glyph - the one of character
+//   gl_InstanceID of usStrings, with the index of the string
+//   it belongs to looked up in usStringGlyphs
+#if defined(USE_STORAGE_BUFFERS)
+// Glyphs' strings packed two per uint
+layout(std430) readonly buffer StringGlyphs {
+  uint ubStringGlyphs[];
+};
 
-  attrs.color = vec3(packed1.rgb) * (1.0f/255.0f);    // Normalize
+int FetchStringGlyph(int character_num)
+{
+  return UnpackGlyphString(ubStringGlyphs[character_num >> 1], character_num);
+}
+#else
+uniform usamplerBuffer usStringGlyphs;
 
-  return attrs;
+int FetchStringGlyph(int character_num)
+{
+  return FetchGlyphString(usStringGlyphs, character_num);
 }
 #endif
+#endif
 
 // Gives an integer which is the index of the glyph
 //   currently being rendered
@@ -100,38 +169,63 @@ int OffsetInString() { return gl_VertexID >> 2; }
 
 // Gives an integer in the range [0;3] which is an
 //   index of the current glyph's quad vertex
-//   starting from the top-left and advancing
-//   counter-clockwise
+//   in GlyphCorners
 int GlyphQuad_VertexID() { return gl_VertexID & 3; }
 
 const float TexCharHeight = 255.0f/256.0f;
 
 void main()
 {
-  int string_character_num = OffsetInString();
   int vert_id = GlyphQuad_VertexID();
+  vec2 corner = GlyphCorners[vert_id];
+
+#if defined(USE_GLYPH_INSTANCES)
+  int string_num = FetchStringGlyph(gl_InstanceID);
+
+  // The character doesn't belong to any string (it's in an
+  //   unused part of usStrings), so collapse the quad into
+  //   a point - every instance is a separate strip
+  if(string_num == NoGlyphString) {
+    gl_Position = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    return;
+  }
+
+  StringAttributes attrs = FetchStringAttributes(string_num);
+
+  int string_character_num = gl_InstanceID - attrs.offset;
+#else
+  int string_character_num = OffsetInString();
 
   StringAttributes attrs = FetchStringAttributes(gl_InstanceID);
+#endif
 
   // Because of instancing, more characters can be rendered
   //   than there are in a given string, in the above case
-  //   cull the additional glyphs
-  if(string_character_num >= attrs.length) {
-    gl_Position = vec4(0.0f, 0.0f, 0.0f, -1.0f);
-    return;
+  //   cull the additional glyphs by collapsing them into
+  //   zero-width quads at the end of the string, so they
+  //   (and the triangles joining them with the string's
+  //   last glyph) are degenerate
+  //  - Moving the vertices behind the viewer instead
+  //    would be unsafe, as the joining triangles
+  //    would then still get clipped and rasterized
+  int character = 0;
+  if(string_character_num < attrs.length) {
+    // The index of the string's character being rendered
+    int character_num = attrs.offset + string_character_num;
+
+    character = FetchStringCharacter(character_num);
+  } else {
+    string_character_num = attrs.length;
+    corner.x = 0.0f;
   }
 
-  // The index of the string's character being rendered
-  int character_num = attrs.offset + string_character_num;
-
-  int character = texelFetch(usStrings, character_num).r;
   float char_t_offset = float(character) * TexCharHeight;
 
   // Compute the offset of the glyph being rendered relative to the start of the string
-  vec2 glyph_advance = vec2(float(string_character_num) * 8.0f, 0.0f);
+  vec2 glyph_advance = vec2(float(string_character_num) * GlyphDimensions.x, 0.0f);
 
   // Compute the needed output data...
-  vec4 pos = GlyphVertPositions[vert_id];
+  vec4 pos = vec4(corner * GlyphDimensions, 0.0f, 1.0f);
   vec2 uv = UVs[vert_id] - vec2(0.0f, char_t_offset);
   vec4 projected_pos = um4Projection * (pos + vec4(attrs.position + glyph_advance, 0.0f, 0.0f));
 
@@ -194,7 +288,24 @@ void main()
 }
 )FRAG";
 
-auto init_DrawString_program() -> GLProgram*
+// Variants of the programs for drawing strings
+enum StringProgramFlags : unsigned {
+  StringProgramDefault = 0,
+
+  // gl_BaseInstanceARB is used in place of uiStringAttributesBaseOffset
+  StringProgramDrawParameters = (1<<0),
+  // Every instance is a single glyph (instead of a whole string)
+  StringProgramGlyphInstances = (1<<1),
+  // The strings' attributes are per-instance vertex attributes
+  StringProgramInstanceAttributes = (1<<2),
+  // The strings' characters, attributes and glyphs are read
+  //   from shader storage buffers (instead of texture buffers)
+  StringProgramStorageBuffers = (1<<3),
+};
+
+// Compiles and links a program for drawing strings,
+//   'flags' is a combination of StringProgramFlags
+static auto init_string_program(const char *label, unsigned flags) -> GLProgram*
 {
   auto gl_program_ptr = new GLProgram();
   auto& gl_program = *gl_program_ptr;
@@ -202,7 +313,30 @@ auto init_DrawString_program() -> GLProgram*
   GLShader vert(GLShader::Vertex);
   GLShader frag(GLShader::Fragment);
 
+  if(flags & StringProgramDrawParameters) {
+    vert
+      .define("USE_DRAW_PARAMETERS")
+      .source(s_osd_vs_draw_parameters_src);
+  }
+
+  if(flags & StringProgramStorageBuffers) {
+    vert
+      .define("USE_STORAGE_BUFFERS")
+      .source(s_osd_vs_storage_buffers_src);
+  }
+
+  if(flags & StringProgramGlyphInstances) {
+    vert
+      .define("USE_GLYPH_INSTANCES");
+  }
+
+  if(flags & StringProgramInstanceAttributes) {
+    vert
+      .define("USE_INSTANCE_ATTRIBUTES");
+  }
+
   vert
+    .source(s_string_attributes_glsl)
     .source(s_osd_vs_src);
 
   frag
@@ -225,14 +359,17 @@ auto init_DrawString_program() -> GLProgram*
   try_compile_shader(vert);
   try_compile_shader(frag);
 
-  vert.label("p.OSD.DrawStringVS");
-  frag.label("p.OSD.DrawStringFS");
+  auto vert_label = std::string(label) + "VS";
+  auto frag_label = std::string(label) + "FS";
+
+  vert.label(vert_label.data());
+  frag.label(frag_label.data());
 
   gl_program
     .attach(vert)
     .attach(frag);
 
-  gl_program.label("p.OSD.DrawString");
+  gl_program.label(label);
 
   // Analogous to try_compile_shader()
   try {
@@ -248,9 +385,79 @@ auto init_DrawString_program() -> GLProgram*
     .detach(frag)
     .detach(vert);
 
+  // GLSL 3.30 has no 'binding' layout qualifier, so
+  //   the blocks have to be assigned their bindings here
+  if(flags & StringProgramStorageBuffers) {
+    gl_program
+      .storageBlockBinding("StringCharacters", StringCharactersStorageBinding)
+      .storageBlockBinding("StringAttributesStorage", StringAttributesStorageBinding)
+      .storageBlockBinding("StringGlyphs", StringGlyphsStorageBinding);
+  }
+
   return gl_program_ptr;
 }
 
+auto init_DrawString_program() -> GLProgram*
+{
+  return init_string_program("p.OSD.DrawString", StringProgramDefault);
+}
+
+auto init_DrawStringIndirect_program() -> GLProgram*
+{
+  // The program is only useful when the draws can be
+  //   batched with glMultiDrawArraysIndirect(), so
+  //   don't bother creating it otherwise (OSDSurface
+  //   will fall back to a draw call per bucket)
+  if(!ARB::multi_draw_indirect || !ARB::shader_draw_parameters) return nullptr;
+
+  return init_string_program("p.OSD.DrawStringIndirect", StringProgramDrawParameters);
+}
+
+auto init_DrawStringGlyphs_program() -> GLProgram*
+{
+  return init_string_program("p.OSD.DrawStringGlyphs", StringProgramGlyphInstances);
+}
+
+auto init_DrawStringInstanced_program() -> GLProgram*
+{
+  // The buckets' offsets into the per-instance vertex buffer
+  //   can only be passed as the draws' base instance
+  //  - ARB_base_instance is required even for the indirect
+  //    draws, as without it the commands' 'base_instance'
+  //    is reserved (must be zero) and doesn't offset the
+  //    per-instance attributes
+  if(!ARB::base_instance) return nullptr;
+
+  return init_string_program("p.OSD.DrawStringInstanced", StringProgramInstanceAttributes);
+}
+
+auto init_DrawStringStorage_program() -> GLProgram*
+{
+  if(!ARB::shader_storage_buffer_object) return nullptr;
+
+  return init_string_program("p.OSD.DrawStringStorage", StringProgramStorageBuffers);
+}
+
+auto init_DrawStringStorageIndirect_program() -> GLProgram*
+{
+  // See init_DrawStringIndirect_program()
+  if(!ARB::shader_storage_buffer_object) return nullptr;
+  if(!ARB::multi_draw_indirect || !ARB::shader_draw_parameters) return nullptr;
+
+  return init_string_program(
+      "p.OSD.DrawStringStorageIndirect", StringProgramStorageBuffers|StringProgramDrawParameters
+  );
+}
+
+auto init_DrawStringStorageGlyphs_program() -> GLProgram*
+{
+  if(!ARB::shader_storage_buffer_object) return nullptr;
+
+  return init_string_program(
+      "p.OSD.DrawStringStorageGlyphs", StringProgramStorageBuffers|StringProgramGlyphInstances
+  );
+}
+
 auto init_DrawRectangle_program() -> GLProgram*
 {
   puts("TODO: OSDDrawCall::DrawRectangle program unimplemented!");
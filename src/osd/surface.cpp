@@ -1,12 +1,20 @@
 #include <osd/surface.h>
 #include <osd/font.h>
 #include <osd/drawcall.h>
+#include <osd/cmdbuf.h>
+#include <osd/costmodel.h>
 
 #include <gx/gx.h>
 #include <gx/vertex.h>
 #include <gx/program.h>
 #include <gx/texture.h>
 #include <gx/buffer.h>
+#include <gx/query.h>
+#include <gx/fence.h>
+#include <gx/extensions.h>
+
+// OpenGL/gl3w
+#include <GL/gl3w.h>
 
 #include <cassert>
 #include <cmath>
@@ -14,18 +22,33 @@
 
 #include <algorithm>
 #include <utility>
+#include <initializer_list>
 
 namespace brdrive {
 
 // Initialized during osd_init()
 GLProgram **OSDSurface::s_surface_programs = nullptr;
 
+// Returns the buffer out of 'buffers' which isn't nullptr (a page
+//   only has one of the buffers which store the same data)
+static auto first_buffer(std::initializer_list<GLBuffer *> buffers) -> GLBuffer *
+{
+  for(auto buffer : buffers) {
+    if(buffer) return buffer;
+  }
+
+  return nullptr;
+}
+
 OSDSurface::OSDSurface() :
   dimensions_(ivec2::zero()), font_(nullptr), bg_(Color::transparent()),
+  string_draw_mode_(StringDrawAuto), attrs_source_(StringAttributesTextureBuffer),
+  multi_draw_indirect_(false),
   created_(false),
-  surface_object_inds_(nullptr), font_tex_(nullptr), font_sampler_(nullptr),
-  strings_buf_(nullptr), strings_tex_(nullptr),
-  string_attrs_buf_(nullptr), string_attrs_tex_(nullptr)
+  dirty_(true), record_pending_(false),
+  recorded_cmdbuf_(nullptr), recorded_generation_(0),
+  font_tex_(nullptr), font_sampler_(nullptr),
+  owns_font_tex_(true)
 {
 }
 
@@ -35,26 +58,67 @@ OSDSurface::~OSDSurface()
 }
 
 auto OSDSurface::create(
-    ivec2 width_height, const OSDBitmapFont *font, const Color& bg
+    ivec2 width_height, const OSDBitmapFont *font, const Color& bg,
+    StringAttributesSource attrs_source
   ) -> OSDSurface&
 {
+  return create(width_height, font, nullptr, bg, attrs_source);
+}
+
+auto OSDSurface::create(
+    ivec2 width_height, const OSDBitmapFont *font, GLTexture2D *font_atlas,
+    const Color& bg, StringAttributesSource attrs_source
+  ) -> OSDSurface&
+{
+  assert((!font_atlas || font) && "a font must be provided along with it's atlas!");
   assert((width_height.x > 0) && (width_height.y > 0) &&
       "width and height must be positive integers!");
   assert(s_surface_programs &&
       "osd_init() MUST be called prior to creating any OSDSurfaces!");
 
+  if(attrs_source == StringAttributesAuto) {
+    attrs_source = stringAttributesSourceSupported(StringAttributesStorageBuffer) ?
+        StringAttributesStorageBuffer : StringAttributesTextureBuffer;
+  }
+
+  if(!stringAttributesSourceSupported(attrs_source)) throw StringAttributesSourceUnsupportedError();
+
   dimensions_ = width_height;
   font_ = font;
   bg_ = bg;
+  attrs_source_ = attrs_source;
+
+  // Otherwise allocated by initFontGLObjects()
+  font_tex_ = font_atlas;
+  owns_font_tex_ = !font_atlas;
+
+  // Queried here, as the extensions can't be queried off
+  //   the GL thread (i.e. in recordPrepared())
+  //  - Instanced attributes get offset by the commands' base
+  //    instance, so the draw parameters aren't needed
+  switch(attrs_source_) {
+  case StringAttributesInstanced:
+    multi_draw_indirect_ = (bool)ARB::multi_draw_indirect;
+    break;
+
+  case StringAttributesStorageBuffer:
+    multi_draw_indirect_ = s_surface_programs[OSDDrawCall::DrawStringStorageIndirect] != nullptr;
+    break;
+
+  default:
+    multi_draw_indirect_ = s_surface_programs[OSDDrawCall::DrawStringIndirect] != nullptr;
+    break;
+  }
 
   initGLObjects();
 
   created_ = true;
+  dirty_ = true;
 
   return *this;
 }
 
-auto OSDSurface::writeString(ivec2 pos, const char *string, const Color& color) -> OSDSurface&
+auto OSDSurface::writeString(ivec2 pos, const char *string, const Color& color) -> StringHandle
 {
   assert(string && "attempted to write a nullptr string!");
 
@@ -62,25 +126,380 @@ auto OSDSurface::writeString(ivec2 pos, const char *string, const Color& color)
   if(!created_) throw NullSurfaceError();
   if(!font_) throw FontNotProvidedError();
 
-  string_objects_.push_back(StringObject {
-    pos, std::string(string), color,
-  });
+  // Reuse the id of a removed string if possible
+  u32 id = 0;
+  if(!free_strings_.empty()) {
+    id = free_strings_.back();
+    free_strings_.pop_back();
+  } else {
+    id = string_objects_.size();
+
+    string_objects_.push_back(StringObject {
+        ivec2::zero(), std::string(), Color::transparent(),
+        NoPage, 0, 0, 0, 0,
+        0 /* generation */, false /* live */,
+        false /* chars_dirty */, false /* attrs_dirty */,
+    });
+  }
+
+  auto& strobj = string_objects_[id];
+  auto length = (u32)strlen(string);
+
+  strobj.position = pos;
+  strobj.str = std::string(string, length);
+  strobj.color = color;
+
+  strobj.live = true;
+
+  // Also marks the string dirty
+  placeString(id, length);
+
+  return StringHandle { id, strobj.generation };
+}
+
+auto OSDSurface::updateString(StringHandle handle, const char *string) -> OSDSurface&
+{
+  assert(string && "attempted to write a nullptr string!");
+
+  auto& strobj = stringObject(handle);
+  auto length = (u32)strlen(string);
+
+  if(length == strobj.str.size() && !memcmp(strobj.str.data(), string, length)) return *this;
+
+  const bool length_changed = length != strobj.str.size();
+
+  strobj.str.assign(string, length);
+
+  // Only strings which don't fit in place are moved (preferably
+  //   within the same page), otherwise the order of the page's
+  //   strings (and thus the buckets) depends on the lengths
+  if(length > strobj.chars_capacity) {
+    auto page = strobj.page;
+
+    releaseString(handle.id);
+    placeString(handle.id, length, page);
+  } else if(length_changed) {
+    string_pages_[strobj.page].layout_dirty = true;
+  }
+
+  markStringDirty(handle.id, /* chars */ true, /* attrs */ length_changed);
+
+  return *this;
+}
+
+auto OSDSurface::moveString(StringHandle handle, ivec2 pos) -> OSDSurface&
+{
+  auto& strobj = stringObject(handle);
+  if(strobj.position.x == pos.x && strobj.position.y == pos.y) return *this;
+
+  strobj.position = pos;
+  markStringDirty(handle.id, /* chars */ false, /* attrs */ true);
+
+  return *this;
+}
+
+auto OSDSurface::recolorString(StringHandle handle, const Color& color) -> OSDSurface&
+{
+  auto& strobj = stringObject(handle);
+
+  strobj.color = color;
+  markStringDirty(handle.id, /* chars */ false, /* attrs */ true);
 
   return *this;
 }
 
+auto OSDSurface::removeString(StringHandle handle) -> OSDSurface&
+{
+  auto& strobj = stringObject(handle);
+
+  // The characters' space gets reclaimed by compactStringPage()
+  releaseString(handle.id);
+
+  strobj.live = false;
+  strobj.generation++;    // Invalidate all the handles
+
+  strobj.str.clear();
+  strobj.str.shrink_to_fit();
+
+  free_strings_.push_back(handle.id);
+
+  dirty_ = true;
+
+  return *this;
+}
+
+auto OSDSurface::stringDrawMode(StringDrawMode mode) -> OSDSurface&
+{
+  if(mode == string_draw_mode_) return *this;
+
+  string_draw_mode_ = mode;
+
+  // The mode is picked by rebuildStringLayout()
+  for(auto& page : string_pages_) page.layout_dirty = true;
+  dirty_ = true;
+
+  return *this;
+}
+
+auto OSDSurface::stringDrawMode() const -> StringDrawMode
+{
+  return string_draw_mode_;
+}
+
 auto OSDSurface::draw() -> std::vector<OSDDrawCall>
 {
   std::vector<OSDDrawCall> drawcalls;
 
+  // Only map the buffers when they'll actually be written to,
+  //   otherwise just re-emit the draw calls
+  const bool upload = stringUploadsPending();
+
+  if(upload) mapStringBuffers();
   appendStringDrawcalls(drawcalls);
+  if(upload) unmapStringBuffers();
 
   return std::move(drawcalls);
 }
 
+auto OSDSurface::record(OSDCommandBuffer& cmdbuf) -> OSDSurface&
+{
+  if(prepareRecord(cmdbuf)) recordPrepared(cmdbuf);
+
+  return finishRecord();
+}
+
+auto OSDSurface::prepareRecord(const OSDCommandBuffer& cmdbuf) -> bool
+{
+  if(!created_) throw NullSurfaceError();
+
+  assert(!record_pending_ && "prepareRecord() called twice without a finishRecord()!");
+
+  const bool cmdbuf_valid = recorded_cmdbuf_ == &cmdbuf
+      && recorded_generation_ == cmdbuf.generation();
+
+  // Nothing changed - the commands already in 'cmdbuf'
+  //   draw the surface as-is
+  if(cmdbuf_valid && !dirty_ && !stringUploadsPending()) return false;
+
+  mapStringBuffers();
+  record_pending_ = true;
+
+  return true;
+}
+
+auto OSDSurface::recordPrepared(OSDCommandBuffer& cmdbuf) -> OSDSurface&
+{
+  if(!record_pending_) return *this;
+
+  const bool cmdbuf_valid = recorded_cmdbuf_ == &cmdbuf
+      && recorded_generation_ == cmdbuf.generation();
+
+  // Writes the contents of the surface to the
+  //   gpu buffers and generates the draw calls
+  std::vector<OSDDrawCall> drawcalls;
+  appendStringDrawcalls(drawcalls);
+
+  // As long as the draw calls use the same state as the recorded
+  //   ones (the same pages drawn in the same modes) only the
+  //   offsets and counts need to be updated...
+  auto same_state = [](const OSDDrawCall& a, const OSDDrawCall& b) -> bool {
+    return a.command == b.command && a.type == b.type
+        && a.verts == b.verts && a.inds == b.inds && a.indirect == b.indirect
+        && a.textures_end == b.textures_end && a.textures == b.textures
+        && a.storage_buffers_end == b.storage_buffers_end && a.storage_buffers == b.storage_buffers;
+  };
+
+  const bool patchable = cmdbuf_valid
+      && std::equal(drawcalls.begin(), drawcalls.end(),
+          recorded_drawcalls_.begin(), recorded_drawcalls_.end(), same_state);
+
+  if(patchable) {
+    for(size_t i = 0; i < drawcalls.size(); i++) cmdbuf.patch(recorded_draws_[i], drawcalls[i]);
+  } else {     // ...otherwise re-record everything
+    cmdbuf.clear();
+    recorded_draws_.clear();
+
+    for(const auto& drawcall : drawcalls) recorded_draws_.push_back(cmdbuf.record(drawcall));
+
+    recorded_cmdbuf_ = &cmdbuf;
+    recorded_generation_ = cmdbuf.generation();
+  }
+  recorded_drawcalls_ = std::move(drawcalls);
+
+  dirty_ = false;
+
+  return *this;
+}
+
+auto OSDSurface::finishRecord() -> OSDSurface&
+{
+  if(!record_pending_) return *this;
+
+  unmapStringBuffers();
+  record_pending_ = false;
+
+  return *this;
+}
+
 auto OSDSurface::clear() -> OSDSurface&
 {
-  string_objects_.clear();
+  // The objects are kept (the same way removeString() does), so
+  //   their generations keep counting up and the StringHandles
+  //   from before the clear() can't match the new strings which
+  //   reuse their ids - the removed ones are already free
+  for(u32 id = 0; id < string_objects_.size(); id++) {
+    auto& strobj = string_objects_[id];
+
+    // 'dirty_strings_' is cleared below
+    strobj.chars_dirty = strobj.attrs_dirty = false;
+
+    if(!strobj.live) continue;
+
+    strobj.live = false;
+    strobj.generation++;    // Invalidate all the handles
+
+    strobj.str.clear();
+    strobj.str.shrink_to_fit();
+
+    strobj.page = NoPage;
+
+    free_strings_.push_back(id);
+  }
+  dirty_strings_.clear();
+
+  // Keep the pages (and their buffers) around for reuse
+  for(auto& page : string_pages_) {
+    page.num_strings = 0;
+    page.string_ids.clear();
+    page.chars_end = page.chars_used = 0;
+
+    page.draw_order.clear();
+    page.buckets.clear();
+    page.per_glyph = false;
+
+    page.layout_dirty = page.upload_pending = page.layout_rebuilt = false;
+  }
+
+  dirty_ = true;
+
+  return *this;
+}
+
+auto OSDSurface::calibrateCostModel(GLContext& gl_context) -> OSDSurface&
+{
+  if(!created_) throw NullSurfaceError();
+  if(!font_) throw FontNotProvidedError();
+
+  assert(attrs_source_ != StringAttributesInstanced &&
+      "calibrateCostModel() can't be called on surfaces which use StringAttributesInstanced!");
+
+  enum : GLSize {
+    NumDraws = 256,
+    NumInstances = 256,
+
+    // Long enough for the draw's cost to be negligible
+    //   compared to the vertex processing
+    StringLength = 512,
+
+    // Each measurement is repeated and the fastest
+    //   one is kept, which filters out any hiccups
+    NumRepeats = 3,
+  };
+
+  static_assert((u32)NumInstances <= (u32)MaxStringsPerPage
+      && (u32)StringLength*NumInstances <= (u32)StringsPageSize,
+      "the calibration strings must fit in a single page!");
+
+  assert(!record_pending_ && "calibrateCostModel() called in between prepareRecord() and finishRecord()!");
+
+  // The measurements overwrite the contents of a whole page,
+  //   so use one which doesn't hold any strings (every page
+  //   gets all of it's buffers rewritten as needed once
+  //   strings are placed on it)
+  u32 page_idx = NoPage;
+  for(u32 i = 0; i < string_pages_.size(); i++) {
+    if(string_pages_[i].num_strings) continue;
+
+    page_idx = i;
+    break;
+  }
+  if(page_idx == NoPage) page_idx = newStringPage();
+
+  auto& page = string_pages_[page_idx];
+
+  // Fill the page with NumInstances strings of StringLength characters
+  //   each, so that every vertex of both the per-string and the per-glyph
+  //   draws runs through the whole shader (the glyphs belong to valid
+  //   strings and none of them get culled)
+  {
+    auto strings_mapping = first_buffer({ page.strings_buf, page.strings_storage })->map(GLBuffer::MapWrite);
+    auto attrs_mapping   = first_buffer({ page.attrs_buf, page.attrs_storage })->map(GLBuffer::MapWrite);
+    auto glyphs_mapping  = first_buffer({ page.glyphs_buf, page.glyphs_storage })->map(GLBuffer::MapWrite);
+
+    memset(strings_mapping.get<u8>(), 'A', StringLength*NumInstances);
+
+    auto attrs_ptr  = attrs_mapping.get<osd_detail::StringAttributes>();
+    auto glyphs_ptr = glyphs_mapping.get<u16>();
+    for(u32 slot = 0; slot < NumInstances; slot++) {
+      attrs_ptr[slot] = osd_detail::StringAttributes {
+          0, 0,
+          slot*StringLength, StringLength,
+          0xFFFFFFFFu,
+      };
+
+      std::fill_n(glyphs_ptr + slot*StringLength, StringLength, (u16)slot);
+    }
+
+    // ~GLBufferMapping() unmaps the buffers
+  }
+
+  GLQuery query(GLQuery::TimeElapsed);
+  auto measure = [&](auto fn) -> u64 {
+    u64 best = ~0ull;
+    for(unsigned i = 0; i < NumRepeats; i++) {
+      query.begin();
+      fn();
+      query.end();
+
+      best = std::min(best, query.result());
+    }
+
+    return best;
+  };
+
+  auto draw_glyphs = [&](GLSize num_glyphs) {
+    osd_submit_drawcall_no_fence(gl_context, stringGlyphsDrawcall(page, num_glyphs));
+  };
+
+  auto draw_strings = [&](GLSize max_length, GLSize num_strings) {
+    osd_submit_drawcall_no_fence(gl_context, stringsDrawcall(page, 0, max_length, num_strings));
+  };
+
+  // Only the vertex processing is of interest
+  glEnable(GL_RASTERIZER_DISCARD);
+
+  auto draws_ns = measure([&]() {
+    for(unsigned i = 0; i < NumDraws; i++) draw_strings(1, 1);
+  });
+
+  auto vertices_ns = measure([&]() {
+    draw_strings(StringLength, NumInstances);
+  });
+
+  auto glyph_vertices_ns = measure([&]() {
+    draw_glyphs(StringLength * NumInstances);
+  });
+
+  glDisable(GL_RASTERIZER_DISCARD);
+
+  auto& cost_model = OSDStringCostModel::global();
+
+  const float num_vertices = OSDStringCostModel::VerticesPerGlyph * StringLength * NumInstances;
+
+  cost_model.draw_ns = (float)draws_ns / (float)NumDraws;
+  cost_model.vertex_ns = std::max((float)vertices_ns - cost_model.draw_ns, 0.0f) / num_vertices;
+  cost_model.glyph_vertex_ns = std::max((float)glyph_vertices_ns - cost_model.draw_ns, 0.0f) / num_vertices;
+  cost_model.generation++;
 
   return *this;
 }
@@ -115,48 +534,42 @@ void OSDSurface::initCommonGLObjects()
 
   empty_vertex_array_->label("a.OSD.Objects");
 
+  // The glyphs' vertices are generated in the vertex
+  //   shader (from gl_VertexID), so no vertex or index
+  //   buffers are needed to draw the strings
   surface_object_verts_ = nullptr;
-  surface_object_inds_ = new GLIndexBuffer();
-
-  // Generate the indices for drawing quads which follow the pattern:
-  //    0 1 2 3 0xFFFF 4 5 6 7 0xFFFF 8 9 10 11 0xFFFF...
-  std::vector<u16> inds(SurfaceIndexBufSize / sizeof(u16));
-  for(u16 i = 0; i < inds.size(); i++) {
-    u16 idx = (i % 5) < 4 ? (i % 5)+(i/5)*4 : 0xFFFF;
-
-    inds[i] = idx;
-  }
-
-  surface_object_inds_
-    ->alloc(SurfaceIndexBufSize, GLBuffer::StaticRead, inds.data());
-
-  surface_object_inds_->label("bi.OSD.Objects");
 
   m_projection = osd_ortho(0.0f, 0.0f, (float)dimensions_.y, (float)dimensions_.x, 0.0f, 1.0f);
 }
 
-void OSDSurface::initFontGLObjects()
+auto OSDSurface::uploadFontAtlas(const OSDBitmapFont& font, GLTexture2D& font_atlas) -> void
 {
-  assert(font_);
-  font_tex_ = new GLTexture2D(); font_sampler_ = new GLSampler();
-  strings_buf_ = new GLBufferTexture(); strings_tex_ = new GLTextureBuffer();
-  string_attrs_buf_ = new GLBufferTexture(); string_attrs_tex_ = new GLTextureBuffer();
-
-  auto& font_tex = *font_tex_;
-  auto& font_sampler = *font_sampler_;
-
-  auto num_glyphs = font_->numGlyphs();
-  auto glyph_dims = font_->glyphDimensions();
-  auto glyph_grid_dimensions = font_->glyphGridLayoutDimensions();
+  auto glyph_dims = font.glyphDimensions();
+  auto glyph_grid_dimensions = font.glyphGridLayoutDimensions();
 
   auto tex_dimensions = ivec2 {
     glyph_grid_dimensions.x * glyph_dims.x,
     glyph_grid_dimensions.y * glyph_dims.y,
   };
 
-  font_tex
+  font_atlas
     .alloc(tex_dimensions.x, tex_dimensions.y, 1, r8)
-    .upload(0, r, GLType::u8, font_->pixelData());
+    .upload(0, r, GLType::u8, font.pixelData());
+}
+
+void OSDSurface::initFontGLObjects()
+{
+  assert(font_);
+  font_sampler_ = new GLSampler();
+
+  // Only upload the atlas when one wasn't passed to create()
+  if(owns_font_tex_) {
+    font_tex_ = new GLTexture2D();
+
+    uploadFontAtlas(*font_, *font_tex_);
+  }
+
+  auto& font_sampler = *font_sampler_;
 
   font_sampler
     .iParam(GLSampler::WrapS, GLSampler::Repeat)       // GLSampler::Repeat is crucial here because
@@ -165,28 +578,34 @@ void OSDSurface::initFontGLObjects()
     .iParam(GLSampler::MinFilter, GLSampler::Nearset)
     .iParam(GLSampler::MagFilter, GLSampler::Nearset);
 
-  strings_buf_->alloc(StringsGPUBufSize, GLBuffer::StreamRead, GLBuffer::MapWrite);
-  strings_tex_->buffer(r8ui, *strings_buf_);
-
-  string_attrs_buf_->alloc(StringAttrsGPUBufSize, GLBuffer::StreamRead, GLBuffer::MapWrite);
-  string_attrs_tex_->buffer(rgba16i, *string_attrs_buf_);
+  // The string pages are created on demand by newStringPage()
 
   // The projection matrix is constant for a given OSDSurface
-  renderProgram(OSDDrawCall::DrawString)
-    .uniformMat4x4("um4Projection", m_projection.data());
+  //   - Some of the programs are nullptr when the extensions
+  //     they require are missing
+  const OSDDrawCall::DrawType string_draw_types[] = {
+    OSDDrawCall::DrawString, OSDDrawCall::DrawStringIndirect,
+    OSDDrawCall::DrawStringGlyphs, OSDDrawCall::DrawStringInstanced,
+    OSDDrawCall::DrawStringStorage, OSDDrawCall::DrawStringStorageIndirect,
+    OSDDrawCall::DrawStringStorageGlyphs,
+  };
 
-  font_tex_->label("t2d.OSD.Font");
-  font_sampler_->label("s.OSD.Font");
+  for(auto draw_type : string_draw_types) {
+    if(!s_surface_programs[draw_type]) continue;
 
-  strings_buf_->label("bt.OSD.Strings");
-  strings_tex_->label("tb.OSD.Strings");
+    renderProgram(draw_type)
+      .uniformMat4x4("um4Projection", m_projection.data());
+  }
 
-  string_attrs_buf_->label("bt.OSD.StringAttrs");
-  string_attrs_tex_->label("tb.OSD.StringAttrs");
+  if(owns_font_tex_) font_tex_->label("t2d.OSD.Font");
+  font_sampler_->label("s.OSD.Font");
 }
 
 void OSDSurface::destroyGLObjects()
 {
+  // The mappings reference the buffers, so they must go first
+  unmapStringBuffers();
+
   destroyCommonGLObjects();
 
   if(font_) destroyFontGLObjects();
@@ -197,134 +616,669 @@ void OSDSurface::destroyCommonGLObjects()
   empty_vertex_array_.destroy();
 
   delete surface_object_verts_;
-  delete surface_object_inds_;
 }
 
 void OSDSurface::destroyFontGLObjects()
 {
-  delete font_tex_;
+  if(owns_font_tex_) delete font_tex_;
   delete font_sampler_;
 
-  delete strings_tex_;
-  delete strings_buf_;
+  for(auto& page : string_pages_) {
+    delete page.strings_tex;
+    delete page.strings_buf;
 
-  delete string_attrs_tex_;
-  delete string_attrs_buf_;
-}
+    delete page.attrs_tex;
+    delete page.attrs_buf;
+
+    // The vertex array references the buffer
+    page.attrs_array.destroy();
+    delete page.attrs_verts;
 
-// Struct intended for direct memcpy() into an
-//   OpenGL buffer which stores string attributes
-struct StringInstanceTexBufferData {
-  u16 x, y;
-  u16 offset;
-  u16 size;
+    delete page.glyphs_tex;
+    delete page.glyphs_buf;
 
-  u16 r, g, b, pad0;
-};
-static_assert(sizeof(StringInstanceTexBufferData) == (8*sizeof(u16)),
-    "StringInstanceData has incorrect layout!");
+    delete page.strings_storage;
+    delete page.attrs_storage;
+    delete page.glyphs_storage;
+
+    delete page.draws_buf;
+  }
+  string_pages_.clear();
+}
 
 void OSDSurface::appendStringDrawcalls(std::vector<OSDDrawCall>& drawcalls)
 {
-  // First - sort all the strings by length so they
-  //   can be split into buckets which will then be used
-  //   to generate drawcalls
-  std::sort(string_objects_.begin(), string_objects_.end(),
-      [](const auto& strobj1, const auto& strobj2) { return strobj1.str.size() < strobj2.str.size(); });
+  if(!font_) return;     // No strings can be written without a font
 
-  // After sorting:
-  //   back().str  -> will always be the LONGEST
-  //   front().str -> will always be the SHORTEST
-  const size_t size_amplitude = string_objects_.back().str.size() - string_objects_.front().str.size();
+  const auto cost_model_generation = OSDStringCostModel::global().generation;
 
-  // Number of draw calls the string drawing will be split into
-  size_t num_buckets = 0;
+  for(u32 page_idx = 0; page_idx < string_pages_.size(); page_idx++) {
+    auto& page = string_pages_[page_idx];
+    if(!page.layout_dirty && page.cost_model_generation == cost_model_generation) continue;
 
-  // Take the log base 2 of the size_amplitude as
-  //   the number of buckets
-  if(size_amplitude <= 1) {
-    num_buckets = 1;
-  } else {
-    size_t tmp = size_amplitude;
-    while(tmp >>= 1) num_buckets++;
+    rebuildStringLayout(page_idx);
+    page.layout_rebuilt = true;
   }
 
-  const size_t strs_per_bucket = ceilf((float)string_objects_.size() / (float)num_buckets);
+  uploadDirtyStrings();
+
+  // When multi-draw indirect is available each bucket gets a command
+  //   written into the page's 'draws_buf' instead of a separate
+  //   OSDDrawCall, and all of them are then submitted at once
+  //  - The commands only change along with the layout, they're
+  //    rewritten whenever the page's buffers get mapped (there's
+  //    at most MaxStringBuckets of them) and otherwise the ones
+  //    already in the buffer are reused
+  const bool use_mdi = useMultiDrawIndirect();
+
+  // Every page has it's own buffers, so the draws can't span pages
+  for(auto& page : string_pages_) {
+    if(!page.num_strings) continue;     // Nothing to draw
 
-  auto strings_buf_mapping = strings_buf_->map(GLBuffer::MapWrite);
-  auto strings_buf_ptr = strings_buf_mapping.get<u8>();
-  intptr_t strings_buf_offset  = 0;
+    if(page.per_glyph) {
+      // All of the page's characters (including the unused
+      //   ones, which are drawn as empty instances) are
+      //   drawn with a single draw call
+      drawcalls.push_back(stringGlyphsDrawcall(page, page.chars_end));
 
-  auto string_attrs_mapping = string_attrs_buf_->map(GLBuffer::MapWrite);
-  auto string_attrs_ptr = string_attrs_mapping.get<u8>();
-  intptr_t string_attrs_offset = 0;
+      continue;
+    }
 
-  for(size_t bucket = 0; bucket < num_buckets; bucket++) {
-    // Since the bucket size is rounded UP during calculation
-    //   the last bucket could contain less strings than the rest -
-    //   so make sure to account from that
-    size_t strs_in_bucket = (bucket+1 == num_buckets) ?
-        (string_objects_.size() - strs_per_bucket*(num_buckets-1))
-      : strs_per_bucket;
+    assert((!use_mdi || page.buckets.size() <= MaxStringBuckets) &&
+        "overflowed the string draw commands gpu buffer!");
+
+    auto string_draws_ptr = use_mdi && page.draws_mapping ?
+        page.draws_mapping->get<GLDrawIndirectBuffer::DrawArraysCommand>() : nullptr;
+    GLSize num_string_draws = 0;
+
+    for(const auto& bucket : page.buckets) {
+      if(use_mdi) {
+        // See the comment above the push_back() below for
+        //   an explanation of the values
+        GLDrawIndirectBuffer::DrawArraysCommand draw_command = {
+          bucket.max_length*4, bucket.count,
+          0 /* first */, bucket.first /* base_instance */,
+        };
+
+        if(string_draws_ptr) {
+          memcpy(string_draws_ptr + num_string_draws, &draw_command, sizeof(draw_command));
+        }
+        num_string_draws++;
+
+        continue;
+      }
+
+      // Append a draw-call for each bucket of strings, where:
+      //   - The number of strings in this bucket is the instance count
+      //   - The offset of the bucket's first string in the page's 'draw_order'
+      //       (each string's attributes take 1 texel) is the base instance
+      //   - The rest of the arguemnts are constant for every bucket's draw call,
+      //      which wastes some memory, but not enough to be of immediate concern
+      //   - With StringAttributesInstanced the base instance offsets the
+      //       per-instance attributes instead of a texelFetch()
+      drawcalls.push_back(stringsDrawcall(page, bucket.first, bucket.max_length, bucket.count));
+    }
 
-    // Early-out if we've no longer got anything to draw...
-    if(!strs_in_bucket) break;
+    if(!use_mdi) continue;
 
-    auto bucket_start = string_objects_.data() + bucket*strs_per_bucket;
-    auto bucket_end   = bucket_start + strs_in_bucket-1;
+    // All the page's buckets share the same state,
+    //   so they can be drawn with a single draw call
+    drawcalls.push_back(stringsIndirectDrawcall(page, num_string_draws));
+  }
+}
 
-    const size_t bucket_str_size = bucket_end->str.size();
+auto OSDSurface::stringsDrawcall(
+    StringPage& page, GLSize base_offset, GLSize max_length, GLSize num_strings
+  ) -> OSDDrawCall
+{
+  switch(attrs_source_) {
+  case StringAttributesInstanced:
+    return osd_drawcall_strings_instanced(
+        page.attrs_array.get(), base_offset,
+        max_length, num_strings,
+        nullptr, 0, 0,
+        font_tex_, font_sampler_, page.strings_tex
+    );
 
-    for(size_t bucket_idx = 0; bucket_idx < strs_in_bucket; bucket_idx++) {
-      const auto& bucket_str = *(bucket_start + bucket_idx);
-      auto size = bucket_str.str.size();
+  case StringAttributesStorageBuffer:
+    return osd_drawcall_strings_storage(
+        empty_vertex_array_.get(), base_offset,
+        max_length, num_strings,
+        nullptr, 0, 0,
+        font_tex_, font_sampler_, page.strings_storage, page.attrs_storage
+    );
 
-      u16 color_r = bucket_str.color.r(),
-          color_g = bucket_str.color.g(),
-          color_b = bucket_str.color.b();
+  default: ;    // Fallthrough
+  }
 
-      StringInstanceTexBufferData instance_data = {
-          // StringAttributes.position
-          (u16)bucket_str.position.x, (u16)bucket_str.position.y,
+  return osd_drawcall_strings(
+      empty_vertex_array_.get(), base_offset,
+      max_length, num_strings,
+      font_tex_, font_sampler_, page.strings_tex, page.attrs_tex
+  );
+}
 
-          // StringAttributes.offset, StringAttributes.length
-          (u16)strings_buf_offset, (u16)size,
+auto OSDSurface::stringsIndirectDrawcall(StringPage& page, GLSize num_draws) -> OSDDrawCall
+{
+  assert(page.draws_buf);
+
+  switch(attrs_source_) {
+  case StringAttributesInstanced:
+    return osd_drawcall_strings_instanced(
+        page.attrs_array.get(), 0,
+        0, 0,
+        page.draws_buf, 0, num_draws,
+        font_tex_, font_sampler_, page.strings_tex
+    );
 
-          // StringAttributes.color
-          color_r, color_g, color_b,
+  case StringAttributesStorageBuffer:
+    return osd_drawcall_strings_storage(
+        empty_vertex_array_.get(), 0,
+        0, 0,
+        page.draws_buf, 0, num_draws,
+        font_tex_, font_sampler_, page.strings_storage, page.attrs_storage
+    );
 
-          0 /* pad0 */,
-      };
+  default: ;    // Fallthrough
+  }
 
-      // Write the string's attributes into a buffer...
-      memcpy(string_attrs_ptr + string_attrs_offset, &instance_data, sizeof(instance_data));
-      string_attrs_offset += sizeof(instance_data);
+  return osd_drawcall_strings_indirect(
+      empty_vertex_array_.get(),
+      page.draws_buf, 0, num_draws,
+      font_tex_, font_sampler_, page.strings_tex, page.attrs_tex
+  );
+}
 
-      assert(string_attrs_offset < StringAttrsGPUBufSize &&
-          "overflowed the string attributes gpu buffer!");
+auto OSDSurface::stringGlyphsDrawcall(StringPage& page, GLSize num_glyphs) -> OSDDrawCall
+{
+  assert(attrs_source_ != StringAttributesInstanced &&
+      "the pages of StringAttributesInstanced surfaces are never drawn per glyph!");
 
-      //  ...as well as it's contents
-      memcpy(strings_buf_ptr + strings_buf_offset, bucket_str.str.data(), size);
-      strings_buf_offset += size;
+  if(attrs_source_ == StringAttributesStorageBuffer) {
+    return osd_drawcall_string_glyphs_storage(
+        empty_vertex_array_.get(), num_glyphs,
+        font_tex_, font_sampler_, page.strings_storage, page.attrs_storage, page.glyphs_storage
+    );
+  }
 
-      assert(strings_buf_offset < StringsGPUBufSize &&
-          "overflowed the gpu string data buffer!");
+  return osd_drawcall_string_glyphs(
+      empty_vertex_array_.get(), num_glyphs,
+      font_tex_, font_sampler_, page.strings_tex, page.attrs_tex, page.glyphs_tex
+  );
+}
+
+void OSDSurface::rebuildStringLayout(u32 page_idx)
+{
+  const auto& cost_model = OSDStringCostModel::global();
+
+  auto& page = string_pages_[page_idx];
+
+  page.draw_order.clear();
+  page.buckets.clear();
+  page.per_glyph = false;
+
+  page.layout_dirty = false;
+  page.cost_model_generation = cost_model.generation;
+  dirty_ = true;
+
+  if(!page.num_strings) return;
+
+  // Count the strings of each length...
+  auto& histogram = string_length_histogram_;
+  histogram.clear();
+
+  for(auto id : page.string_ids) {
+    auto length = string_objects_[id].str.size();
+    if(length >= histogram.size()) histogram.resize(length+1, 0);
+
+    histogram[length]++;
+  }
+
+  // ...choose the buckets' boundaries while 'histogram'
+  //   still holds the counts...
+  auto bucket_max_lengths = cost_model.partition(histogram, MaxStringBuckets);
+
+  // ...turn the counts into the offsets of the first
+  //   string of each length...
+  u32 offset = 0;
+  for(auto& count : histogram) {
+    auto length_count = count;
+
+    count = offset;
+    offset += length_count;
+  }
+
+  // ...and place every string at it's length's offset, which
+  //   sorts them by length (keeping the strings of equal length
+  //   in the same order as in 'string_ids')
+  page.draw_order.resize(page.num_strings);
+  for(auto id : page.string_ids) {
+    page.draw_order[histogram[string_objects_[id].str.size()]++] = id;
+  }
+
+  for(u32 slot = 0; slot < page.draw_order.size(); slot++) {
+    string_objects_[page.draw_order[slot]].attrs_slot = slot;
+  }
+
+  // After the loop above histogram[n] is the offset one past the
+  //   last string of length 'n', which is the bucket's end
+  u32 first = 0;
+  float buckets_cost = 0.0f;
+  for(auto max_length : bucket_max_lengths) {
+    auto end = histogram[max_length];
+
+    page.buckets.push_back(StringBucket {
+        first, end - first, max_length,
+    });
+    buckets_cost += cost_model.bucketCost(end - first, max_length);
+
+    first = end;
+  }
+
+  // Draw a glyph per instance when the lengths are spread out so
+  //   much that even the best buckets waste more vertices than
+  //   the extra per-glyph fetches (and empty instances) cost
+  switch(string_draw_mode_) {
+  case StringDrawAuto:     page.per_glyph = cost_model.glyphsCost(page.chars_end) < buckets_cost; break;
+  case StringDrawBucketed: page.per_glyph = false; break;
+  case StringDrawPerGlyph: page.per_glyph = true; break;
+  }
+
+  // The per-glyph instances look up their string's
+  //   attributes by index, which can't be done with
+  //   per-instance vertex attributes
+  if(attrs_source_ == StringAttributesInstanced) page.per_glyph = false;
+}
+
+void OSDSurface::uploadDirtyStrings()
+{
+  auto write_attrs = [&](const StringObject& strobj) {
+    const auto& page = string_pages_[strobj.page];
+    assert(page.attrs_mapping && "mapStringBuffers() must be called before appendStringDrawcalls()!");
+
+    osd_detail::StringAttributes instance_data = {
+        (u16)strobj.position.x, (u16)strobj.position.y,
+
+        strobj.chars_offset, (u32)strobj.str.size(),
+
+        (u32)strobj.color.rgba(),
+    };
+
+    auto string_attrs_ptr = page.attrs_mapping->get<osd_detail::StringAttributes>();
+    memcpy(string_attrs_ptr + strobj.attrs_slot, &instance_data, sizeof(instance_data));
+  };
+
+  auto write_chars = [&](const StringObject& strobj) {
+    const auto& page = string_pages_[strobj.page];
+    assert(page.strings_mapping && "mapStringBuffers() must be called before appendStringDrawcalls()!");
+
+    auto strings_buf_ptr = page.strings_mapping->get<u8>();
+    memcpy(strings_buf_ptr + strobj.chars_offset, strobj.str.data(), strobj.str.size());
+  };
+
+  for(auto id : dirty_strings_) {
+    auto& strobj = string_objects_[id];
+
+    if(strobj.live) {
+      // The attributes of the strings on the pages which were
+      //   rebuilt get rewritten below regardless
+      const bool page_rebuilt = string_pages_[strobj.page].layout_rebuilt;
+
+      if(strobj.chars_dirty) write_chars(strobj);
+      if(strobj.attrs_dirty && !page_rebuilt) write_attrs(strobj);
+    }
+
+    strobj.chars_dirty = strobj.attrs_dirty = false;
+  }
+  dirty_strings_.clear();
+
+  // Only changes when the layout is rebuilt (the strings
+  //   get placed, moved or change length)
+  auto write_glyphs = [&](const StringPage& page) {
+    assert(page.glyphs_mapping && "mapStringBuffers() must be called before appendStringDrawcalls()!");
+
+    auto glyphs_ptr = page.glyphs_mapping->get<u16>();
+    std::fill_n(glyphs_ptr, page.chars_end, (u16)osd_detail::NoGlyphString);
+
+    for(auto id : page.draw_order) {
+      const auto& strobj = string_objects_[id];
+
+      std::fill_n(glyphs_ptr + strobj.chars_offset, strobj.str.size(), (u16)strobj.attrs_slot);
+    }
+  };
+
+  // The slots were reassigned, so every string's
+  //   attributes have to be rewritten
+  for(auto& page : string_pages_) {
+    if(page.layout_rebuilt) {
+      for(auto id : page.draw_order) write_attrs(string_objects_[id]);
+      if(page.per_glyph) write_glyphs(page);
     }
 
-    // Append a draw-call for each bucket of strings, where:
-    //   - The number of strings in this bucket (the last one could be smaller)
-    //      is the instance count
-    //   - The offset of the string in 'string_objects_'*2 (each string's attributes
-    //       take 2 texels) is the base instance
-    //   - The rest of the arguemnts are constant for every bucket's draw call,
-    //      which wastes some memory, but not enough to be of immediate concern
-    drawcalls.push_back(
-        osd_drawcall_strings(
-          empty_vertex_array_.get(), GLType::u16, surface_object_inds_, bucket*strs_per_bucket * 2,
-          bucket_str_size, strs_in_bucket,
-          font_tex_, font_sampler_, strings_tex_, string_attrs_tex_)
+    page.upload_pending = page.layout_rebuilt = false;
+  }
+}
+
+void OSDSurface::placeString(u32 id, u32 length, u32 preferred_page)
+{
+  auto& strobj = string_objects_[id];
+  assert(strobj.page == NoPage && "the string must be releaseString()'ed first!");
+
+  // The only limit on the length of the strings - each
+  //   one must fit within a single page
+  assert(length <= StringsPageSize && "the string is too long!");
+
+  auto fits = [&](u32 page_idx) -> bool {
+    const auto& page = string_pages_[page_idx];
+
+    return page.num_strings < MaxStringsPerPage
+        && page.chars_used + length <= StringsPageSize;
+  };
+
+  // Look for a page which has room for the string, starting
+  //   with the 'preferred_page', then the existing ones in
+  //   order (which refills the pages emptied by removals)...
+  u32 page_idx = NoPage;
+  if(preferred_page != NoPage && fits(preferred_page)) {
+    page_idx = preferred_page;
+  } else {
+    for(u32 i = 0; i < string_pages_.size(); i++) {
+      if(!fits(i)) continue;
+
+      page_idx = i;
+      break;
+    }
+  }
+
+  // ...and only if there's none create a new one
+  if(page_idx == NoPage) page_idx = newStringPage();
+
+  // The page has enough unused space, but it might
+  //   be fragmented (after removals or updates)
+  if(string_pages_[page_idx].chars_end + length > StringsPageSize) compactStringPage(page_idx);
+
+  auto& page = string_pages_[page_idx];
+
+  strobj.page = page_idx;
+  strobj.page_entry = page.string_ids.size();
+  strobj.chars_offset = page.chars_end;
+  strobj.chars_capacity = length;
+
+  page.string_ids.push_back(id);
+  page.num_strings++;
+  page.chars_end += length;
+  page.chars_used += length;
+
+  // A new string was added to the page
+  page.layout_dirty = true;
+
+  markStringDirty(id, /* chars */ true, /* attrs */ true);
+}
+
+void OSDSurface::releaseString(u32 id)
+{
+  auto& strobj = string_objects_[id];
+  assert(strobj.page != NoPage);
+
+  auto& page = string_pages_[strobj.page];
+
+  // Move the page's last string into the released one's
+  //   entry, as the order of 'string_ids' doesn't matter
+  auto last_id = page.string_ids.back();
+
+  page.string_ids[strobj.page_entry] = last_id;
+  string_objects_[last_id].page_entry = strobj.page_entry;
+  page.string_ids.pop_back();
+
+  page.num_strings--;
+  page.chars_used -= strobj.chars_capacity;
+
+  // Reset the allocation once the page becomes
+  //   empty, which makes compaction unnecessary
+  if(!page.num_strings) page.chars_end = 0;
+
+  page.layout_dirty = true;
+
+  strobj.page = NoPage;
+}
+
+void OSDSurface::compactStringPage(u32 page_idx)
+{
+  auto& page = string_pages_[page_idx];
+
+  page.chars_end = 0;
+
+  // Pack all the page's strings at the start of
+  //   the buffer, which means they all get re-uploaded
+  for(auto id : page.string_ids) {
+    auto& strobj = string_objects_[id];
+
+    strobj.chars_offset = page.chars_end;
+    strobj.chars_capacity = strobj.str.size();
+
+    page.chars_end += strobj.chars_capacity;
+
+    markStringDirty(id, /* chars */ true, /* attrs */ true);
+  }
+
+  page.chars_used = page.chars_end;
+}
+
+auto OSDSurface::newStringPage() -> u32
+{
+  auto page_idx = (u32)string_pages_.size();
+  auto& page = string_pages_.emplace_back();
+
+  auto label = [page_idx](const char *name) -> std::string {
+    return std::string(name) + "[" + std::to_string(page_idx) + "]";
+  };
+
+  // Only the buffers used with the surface's StringAttributesSource
+  //   get created (see the comment above StringPage::strings_buf)
+  page.strings_buf = nullptr; page.strings_tex = nullptr;
+  page.attrs_buf = nullptr; page.attrs_tex = nullptr;
+  page.attrs_verts = nullptr;
+  page.glyphs_buf = nullptr; page.glyphs_tex = nullptr;
+  page.strings_storage = page.attrs_storage = page.glyphs_storage = nullptr;
+
+  switch(attrs_source_) {
+  case StringAttributesTextureBuffer:
+  case StringAttributesInstanced:
+    page.strings_buf = new GLBufferTexture(); page.strings_tex = new GLTextureBuffer();
+
+    page.strings_buf->alloc(StringsPageSize, GLBuffer::StreamRead, GLBuffer::MapWrite);
+    page.strings_tex->buffer(rgba8ui, *page.strings_buf);
+
+    page.strings_buf->label(label("bt.OSD.Strings").data());
+    page.strings_tex->label(label("tb.OSD.Strings").data());
+    break;
+
+  case StringAttributesStorageBuffer:
+    page.strings_storage = new GLShaderStorageBuffer();
+    page.attrs_storage = new GLShaderStorageBuffer();
+    page.glyphs_storage = new GLShaderStorageBuffer();
+
+    // Same sizes as the texture buffers below
+    page.strings_storage->alloc(StringsPageSize, GLBuffer::StreamRead, GLBuffer::MapWrite);
+    page.attrs_storage->alloc(StringAttrsPageSize, GLBuffer::StreamRead, GLBuffer::MapWrite);
+    page.glyphs_storage->alloc(StringsPageSize * sizeof(u16), GLBuffer::StreamRead, GLBuffer::MapWrite);
+
+    page.strings_storage->label(label("bs.OSD.Strings").data());
+    page.attrs_storage->label(label("bs.OSD.StringAttrs").data());
+    page.glyphs_storage->label(label("bs.OSD.StringGlyphs").data());
+    break;
+
+  default: assert(0);   // create() resolves StringAttributesAuto
+  }
+
+  if(attrs_source_ == StringAttributesTextureBuffer) {
+    page.attrs_buf = new GLBufferTexture(); page.attrs_tex = new GLTextureBuffer();
+    page.glyphs_buf = new GLBufferTexture(); page.glyphs_tex = new GLTextureBuffer();
+
+    page.attrs_buf->alloc(StringAttrsPageSize, GLBuffer::StreamRead, GLBuffer::MapWrite);
+    page.attrs_tex->buffer(rgba32ui, *page.attrs_buf);
+
+    // One u16 per character of 'strings_buf'
+    page.glyphs_buf->alloc(StringsPageSize * sizeof(u16), GLBuffer::StreamRead, GLBuffer::MapWrite);
+    page.glyphs_tex->buffer(rgba16ui, *page.glyphs_buf);
+
+    page.attrs_buf->label(label("bt.OSD.StringAttrs").data());
+    page.attrs_tex->label(label("tb.OSD.StringAttrs").data());
+
+    page.glyphs_buf->label(label("bt.OSD.StringGlyphs").data());
+    page.glyphs_tex->label(label("tb.OSD.StringGlyphs").data());
+  } else if(attrs_source_ == StringAttributesInstanced) {
+    // With StringAttributesInstanced the attributes are stored in a vertex
+    //   buffer instead and the pages are never drawn 'per_glyph'
+    page.attrs_verts = new GLVertexBuffer();
+    page.attrs_verts->alloc(StringAttrsPageSize, GLBuffer::StreamDraw, GLBuffer::MapWrite);
+
+    // A whole osd_detail::StringAttributes per instance (see
+    //   USE_INSTANCE_ATTRIBUTES in s_osd_vs_src)
+    GLVertexFormat attrs_format;
+    attrs_format
+      .iattr(0, 4, GLType::u32, GLVertexFormatAttr::Integer | GLVertexFormatAttr::PerInstance)
+      .bindVertexBuffer(0, *page.attrs_verts);
+
+    page.attrs_array = attrs_format.newVertexArray();
+
+    page.attrs_verts->label(label("bv.OSD.StringAttrs").data());
+    page.attrs_array->label(label("a.OSD.StringAttrs").data());
+  }
+
+  // The DrawStringIndirect program is nullptr when the
+  //   extensions needed for multi-draw indirect are missing
+  page.draws_buf = useMultiDrawIndirect() ? new GLDrawIndirectBuffer() : nullptr;
+
+  if(page.draws_buf) {
+    page.draws_buf->alloc(
+        MaxStringBuckets * sizeof(GLDrawIndirectBuffer::DrawArraysCommand),
+        GLBuffer::StreamDraw, GLBuffer::MapWrite
     );
+
+    page.draws_buf->label(label("bd.OSD.StringDraws").data());
+  }
+
+  page.num_strings = 0;
+  page.chars_end = page.chars_used = 0;
+
+  page.per_glyph = false;
+
+  page.layout_dirty = page.upload_pending = page.layout_rebuilt = false;
+  page.cost_model_generation = OSDStringCostModel::global().generation;
+
+  return page_idx;
+}
+
+auto OSDSurface::stringObject(StringHandle handle) -> StringObject&
+{
+  assert(handle.id < string_objects_.size() && "invalid StringHandle!");
+
+  auto& strobj = string_objects_[handle.id];
+  assert((strobj.live && strobj.generation == handle.generation) &&
+      "attempted to use the StringHandle of a removed string!");
+
+  return strobj;
+}
+
+void OSDSurface::markStringDirty(u32 id, bool chars, bool attrs)
+{
+  auto& strobj = string_objects_[id];
+
+  // Make sure every string ends up in 'dirty_strings_' only once
+  if(!strobj.chars_dirty && !strobj.attrs_dirty) dirty_strings_.push_back(id);
+
+  strobj.chars_dirty |= chars;
+  strobj.attrs_dirty |= attrs;
+
+  string_pages_[strobj.page].upload_pending = true;
+
+  dirty_ = true;
+}
+
+auto OSDSurface::pageUploadsPending(const StringPage& page) const -> bool
+{
+  // The buckets need to be recomputed after the cost model
+  //   was calibrateCostModel()'ed (possibly by another surface)
+  const bool cost_model_changed = page.cost_model_generation != OSDStringCostModel::global().generation;
+
+  return page.upload_pending || page.layout_dirty || cost_model_changed;
+}
+
+auto OSDSurface::stringUploadsPending() const -> bool
+{
+  for(const auto& page : string_pages_) {
+    if(pageUploadsPending(page)) return true;
+  }
+
+  return false;
+}
+
+void OSDSurface::mapStringBuffers()
+{
+  if(!font_) return;     // No string buffers to map
+
+  // GLBufferMapping can't be moved, so it's constructed
+  //   in-place directly from the result of map()
+  for(auto& page : string_pages_) {
+    if(!pageUploadsPending(page)) continue;
+
+    auto strings_buf = first_buffer({ page.strings_buf, page.strings_storage });
+    auto attrs_buf   = first_buffer({ page.attrs_buf, page.attrs_verts, page.attrs_storage });
+    auto glyphs_buf  = first_buffer({ page.glyphs_buf, page.glyphs_storage });
+
+    page.strings_mapping.reset(new GLBufferMapping(strings_buf->map(GLBuffer::MapWrite)));
+    page.attrs_mapping.reset(new GLBufferMapping(attrs_buf->map(GLBuffer::MapWrite)));
+
+    if(glyphs_buf) {
+      page.glyphs_mapping.reset(new GLBufferMapping(glyphs_buf->map(GLBuffer::MapWrite)));
+    }
+
+    if(page.draws_buf) {
+      page.draws_mapping.reset(new GLBufferMapping(page.draws_buf->map(GLBuffer::MapWrite)));
+    }
+  }
+}
+
+void OSDSurface::unmapStringBuffers()
+{
+  // ~GLBufferMapping() does the unmapping
+  for(auto& page : string_pages_) {
+    page.strings_mapping.reset();
+    page.attrs_mapping.reset();
+    page.draws_mapping.reset();
+    page.glyphs_mapping.reset();
   }
 }
 
+auto OSDSurface::useMultiDrawIndirect() const -> bool
+{
+  return multi_draw_indirect_;
+}
+
+auto OSDSurface::stringAttributesSourceSupported(StringAttributesSource source) -> bool
+{
+  assert(s_surface_programs &&
+      "osd_init() must be called before querying the supported StringAttributesSources!");
+
+  switch(source) {
+  case StringAttributesAuto:          return true;
+  case StringAttributesTextureBuffer: return true;
+  case StringAttributesInstanced:
+    // The program is only created with ARB_base_instance
+    return s_surface_programs[OSDDrawCall::DrawStringInstanced];
+
+  case StringAttributesStorageBuffer:
+    return s_surface_programs[OSDDrawCall::DrawStringStorage]
+        && s_surface_programs[OSDDrawCall::DrawStringStorageGlyphs];
+  }
+
+  return false;
+}
+
+auto OSDSurface::stringAttributesSource() const -> StringAttributesSource
+{
+  return attrs_source_;
+}
+
 }
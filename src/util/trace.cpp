@@ -0,0 +1,235 @@
+#include <util/trace.h>
+
+#include <cassert>
+#include <cstdio>
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+
+namespace brdrive {
+
+// Maximum number of zones which can be recorded by a single thread
+static constexpr u32 ThreadBufferCapacity = 1u<<16;
+
+// Maximum number of zones which can be recorded on the GPU timeline,
+//   the same as a thread's, so it doesn't keep growing (and the GPU
+//   zones don't outlast the CPU ones) when tracing is left enabled
+static constexpr u32 GPUEventsCapacity = ThreadBufferCapacity;
+
+// The 'tid' used for the GPU timeline in the exported trace
+static constexpr u32 GPUTraceTid = 0;
+
+struct TraceEvent {
+  const char *name;
+  u64 begin_ns, end_ns;
+
+  TraceCategory category;
+};
+
+struct TraceThreadBuffer {
+  u32 tid;
+  std::string name;   // Protected by 'g_trace_mutex'
+
+  std::unique_ptr<TraceEvent[]> events;
+
+  // Only ever incremented by the owning thread (with release
+  //   semantics after the event is written), so everything
+  //   below it can be read by trace_export_chrome()
+  std::atomic<u32> num_events;
+  std::atomic<u64> num_dropped;
+};
+
+struct TraceGPUEvent {
+  std::string name;
+  u64 begin_ns, duration_ns;
+};
+
+static std::atomic<bool> g_trace_enabled = false;
+
+static std::mutex g_trace_mutex;
+
+// The members below are protected by 'g_trace_mutex'
+//  - The buffers are kept alive after their threads
+//    exit, so their zones can still be exported
+static std::vector<std::shared_ptr<TraceThreadBuffer>> g_trace_buffers;
+static std::vector<TraceGPUEvent> g_trace_gpu_events;
+static u64 g_trace_gpu_num_dropped = 0;
+
+static thread_local TraceThreadBuffer *t_trace_buffer = nullptr;
+
+static auto trace_epoch() -> std::chrono::steady_clock::time_point
+{
+  static const auto epoch = std::chrono::steady_clock::now();
+
+  return epoch;
+}
+
+static auto trace_thread_buffer() -> TraceThreadBuffer *
+{
+  if(t_trace_buffer) return t_trace_buffer;
+
+  auto buffer = std::make_shared<TraceThreadBuffer>();
+  buffer->events.reset(new TraceEvent[ThreadBufferCapacity]);
+  buffer->num_events.store(0, std::memory_order_relaxed);
+  buffer->num_dropped.store(0, std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> lock(g_trace_mutex);
+
+  buffer->tid = g_trace_buffers.size() + 1;   // 0 is the GPUTraceTid
+  g_trace_buffers.push_back(buffer);
+
+  t_trace_buffer = buffer.get();
+
+  return t_trace_buffer;
+}
+
+[[using gnu: always_inline]]
+static constexpr auto TraceCategory_to_str(TraceCategory category) -> const char *
+{
+  switch(category) {
+  case TraceCPU:  return "cpu";
+  case TraceGPU:  return "gpu";
+  case TraceSwap: return "swap";
+  case TraceWait: return "wait";
+
+  default: ;    // Fallthrough
+  }
+
+  return "unknown";
+}
+
+// Writes 'str' as a JSON string literal (including the quotes)
+static auto trace_write_json_str(FILE *f, const char *str) -> void
+{
+  fputc('"', f);
+  for(auto ch = str; *ch; ch++) {
+    switch(*ch) {
+    case '"':  fputs("\\\"", f); break;
+    case '\\': fputs("\\\\", f); break;
+    case '\n': fputs("\\n", f); break;
+    case '\t': fputs("\\t", f); break;
+
+    default:
+      if((unsigned char)*ch < 0x20) {
+        fprintf(f, "\\u%04x", (unsigned)*ch);
+      } else {
+        fputc(*ch, f);
+      }
+      break;
+    }
+  }
+  fputc('"', f);
+}
+
+auto trace_enable(bool enabled) -> void
+{
+  trace_epoch();    // Make sure the epoch precedes all the zones
+
+  g_trace_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+auto trace_enabled() -> bool
+{
+  return g_trace_enabled.load(std::memory_order_relaxed);
+}
+
+auto trace_now() -> u64
+{
+  auto now = std::chrono::steady_clock::now();
+
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(now - trace_epoch()).count();
+}
+
+auto trace_thread_name(const char *name) -> void
+{
+  auto buffer = trace_thread_buffer();
+
+  std::lock_guard<std::mutex> lock(g_trace_mutex);
+  buffer->name = name;
+}
+
+auto trace_zone(const char *name, TraceCategory category, u64 begin_ns, u64 end_ns) -> void
+{
+  assert(name && category < NumTraceCategories);
+
+  auto buffer = trace_thread_buffer();
+
+  auto idx = buffer->num_events.load(std::memory_order_relaxed);
+  if(idx >= ThreadBufferCapacity) {
+    buffer->num_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  buffer->events[idx] = TraceEvent { name, begin_ns, end_ns, category };
+
+  // Publish the event to trace_export_chrome()
+  buffer->num_events.store(idx+1, std::memory_order_release);
+}
+
+auto trace_gpu_zone(const std::string& name, u64 begin_ns, u64 duration_ns) -> void
+{
+  std::lock_guard<std::mutex> lock(g_trace_mutex);
+
+  if(g_trace_gpu_events.size() >= GPUEventsCapacity) {
+    g_trace_gpu_num_dropped++;
+    return;
+  }
+
+  g_trace_gpu_events.push_back(TraceGPUEvent { name, begin_ns, duration_ns });
+}
+
+auto trace_export_chrome(const char *path) -> void
+{
+  auto f = fopen(path, "w");
+  if(!f) throw TraceExportError();
+
+  std::lock_guard<std::mutex> lock(g_trace_mutex);
+
+  // The timestamps are expressed in microseconds
+  auto write_event = [f](const char *name, const char *category, u32 tid, u64 begin_ns, u64 duration_ns) {
+    fputs(",\n{\"name\":", f);
+    trace_write_json_str(f, name);
+    fprintf(f, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+        category, tid, begin_ns/1000.0, duration_ns/1000.0);
+  };
+  auto write_thread_name = [f](u32 tid, const char *name) {
+    fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", tid);
+    trace_write_json_str(f, name);
+    fputs("}}", f);
+  };
+
+  fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", f);
+  fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"brdrive\"}}", f);
+
+  write_thread_name(GPUTraceTid, "GPU");
+  for(const auto& gpu_event : g_trace_gpu_events) {
+    write_event(gpu_event.name.data(), TraceCategory_to_str(TraceGPU), GPUTraceTid,
+        gpu_event.begin_ns, gpu_event.duration_ns);
+  }
+
+  u64 num_dropped = g_trace_gpu_num_dropped;
+  for(const auto& buffer : g_trace_buffers) {
+    if(!buffer->name.empty()) write_thread_name(buffer->tid, buffer->name.data());
+
+    auto num_events = buffer->num_events.load(std::memory_order_acquire);
+    for(u32 i = 0; i < num_events; i++) {
+      const auto& event = buffer->events[i];
+
+      write_event(event.name, TraceCategory_to_str(event.category), buffer->tid,
+          event.begin_ns, event.end_ns - event.begin_ns);
+    }
+
+    num_dropped += buffer->num_dropped.load(std::memory_order_relaxed);
+  }
+
+  fprintf(f, "\n],\"otherData\":{\"dropped_zones\":\"%lu\"}}\n", num_dropped);
+
+  auto failed = ferror(f);
+  if(fclose(f) || failed) throw TraceExportError();
+}
+
+}
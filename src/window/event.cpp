@@ -32,6 +32,8 @@ auto IEventLoop::event(u32 flags) -> Event::Ptr
   assert(was_init_ && "init() wasn't called before using other methods!");
 
   auto event = Event::Ptr();
+
+  takePosted();
   if(!queue_.empty()) {    // First check if there are items in the queue...
     event = std::move(queue_.front());
     queue_.pop_front();
@@ -41,8 +43,17 @@ auto IEventLoop::event(u32 flags) -> Event::Ptr
 
   // ...if there aren't any we must check if we should block
   if(flags & Block) {
-    // ...we are in blocking mode so wait for an event...
-    event = waitEvent();
+    // ...we are in blocking mode so wait for an event - when
+    //    waitEvent() returns a nullptr it was woken up by post()...
+    while(!(event = waitEvent())) {
+      takePosted();
+      if(queue_.empty()) continue;   // The posted event was already
+                                     //   picked up by a previous call
+      event = std::move(queue_.front());
+      queue_.pop_front();
+
+      break;
+    }
 
     // ...and fill up the queue as much as possible to
     //    reduce overhead on future event() calls
@@ -66,11 +77,40 @@ auto IEventLoop::event(u32 flags) -> Event::Ptr
 
 auto IEventLoop::queueEmpty() const -> bool
 {
+  {
+    std::lock_guard<std::mutex> lock(posted_mutex_);
+    if(!posted_.empty()) return false;
+  }
+
   if(queue_.empty()) return queueEmptyInternal();
 
   return false;   // !queue_.empty()
 }
 
+auto IEventLoop::post(Event::Ptr event) -> IEventLoop&
+{
+  assert(event.get());
+
+  {
+    std::lock_guard<std::mutex> lock(posted_mutex_);
+    posted_.push_back(std::move(event));
+  }
+
+  wakeupInternal();
+
+  return *this;
+}
+
+void IEventLoop::takePosted()
+{
+  std::lock_guard<std::mutex> lock(posted_mutex_);
+
+  while(!posted_.empty()) {
+    queue_.push_back(std::move(posted_.front()));
+    posted_.pop_front();
+  }
+}
+
 void IEventLoop::fillQueue()
 {
   // Fill up the queue (as much as possible)...
@@ -96,6 +136,22 @@ QuitEvent::QuitEvent() :
 {
 }
 
+UserEvent::UserEvent(u32 code, uptr data) :
+  Event(User),
+  code_(code), data_(data)
+{
+}
+
+auto UserEvent::code() const -> u32
+{
+  return code_;
+}
+
+auto UserEvent::data() const -> uptr
+{
+  return data_;
+}
+
 IKeyEvent::~IKeyEvent()
 {
 }
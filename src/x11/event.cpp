@@ -53,6 +53,8 @@ auto X11Event::from_X11EventHandle(X11EventLoop *event_loop, X11EventHandle ev)
   case Event::MouseUp:
     event.reset(new X11MouseEvent(event_loop, ev));
     break;
+
+  default: break;     // Not backed by an X11 event (e.g. Event::User)
   }
 
   return std::move(event);
@@ -183,7 +185,8 @@ auto X11MouseEvent::delta() const -> Vec2<i16>
 
 X11EventLoop::X11EventLoop() :
   mouse_last_({ InvalidCoord }), mouse_buttons_last_(0),
-  key_modifiers_(0)
+  key_modifiers_(0),
+  wakeup_atom_(XCB_ATOM_NONE)
 {
 }
 
@@ -216,6 +219,26 @@ auto X11EventLoop::initInternal() -> bool
   free(pointer_reply);
 #endif
 
+  auto connection = x11().connection<xcb_connection_t>();
+
+  static const char WakeupAtomName[] = "_BRDRIVE_WAKEUP";
+  auto atom_cookie = xcb_intern_atom(
+      connection, /* only_if_exists */ 0,
+      sizeof(WakeupAtomName)-1, WakeupAtomName
+  );
+
+  xcb_generic_error_t *err = nullptr;
+  auto atom_reply = xcb_intern_atom_reply(connection, atom_cookie, &err);
+  if(err) {
+    free(err);
+    free(atom_reply);
+
+    return false;
+  }
+
+  wakeup_atom_ = atom_reply->atom;
+  free(atom_reply);
+
   return true;
 }
 
@@ -226,6 +249,13 @@ auto X11EventLoop::pollEvent() -> Event::Ptr
   // Poll until a non-internal event is returned
   xcb_generic_event_t *ev = nullptr;
   while( (ev = xcb_poll_for_event(connection)) ) {
+    // The event loop isn't blocked, so there's
+    //   nothing to wake up - discard the message
+    if(isWakeup(ev)) {
+      free(ev);
+      continue;
+    }
+
     if(!X11Event::is_internal(ev)) break;
 
     // Process any internal events so they don't
@@ -256,6 +286,12 @@ auto X11EventLoop::waitEvent() -> Event::Ptr
     ev = xcb_wait_for_event(connection);
     if(!ev) return QuitEvent::alloc();     // NULL event signifies the window was closed -
                                            //   so signal the application should exit
+    if(isWakeup(ev)) {
+      free(ev);
+
+      return Event::Ptr();    // Let IEventLoop pick up the posted events
+    }
+
     if(!X11Event::is_internal(ev)) {
       event = X11Event::from_X11EventHandle(this, ev);
       if(event) break;
@@ -274,6 +310,35 @@ auto X11EventLoop::waitEvent() -> Event::Ptr
   return std::move(event);
 }
 
+void X11EventLoop::wakeupInternal()
+{
+  auto connection = x11().connection<xcb_connection_t>();
+  auto window = ((X11Window *)IEventLoop::window())->windowHandle();
+
+  xcb_client_message_event_t message = {};
+  message.response_type = XCB_CLIENT_MESSAGE;
+  message.format = 32;
+  message.window = window;
+  message.type = wakeup_atom_;
+
+  // With an empty event mask the message is sent to the
+  //   client which created the window i.e. this one
+  xcb_send_event(
+      connection, /* propagate */ 0, window,
+      XCB_EVENT_MASK_NO_EVENT, (const char *)&message
+  );
+  xcb_flush(connection);
+}
+
+auto X11EventLoop::isWakeup(X11EventHandle ev) const -> bool
+{
+  if(X11Event::x11_response_type(ev) != XCB_CLIENT_MESSAGE) return false;
+
+  auto message = xcb_ev<xcb_client_message_event_t>(ev);
+
+  return message->type == wakeup_atom_;
+}
+
 auto X11EventLoop::queueEmptyInternal() const -> bool
 {
   return xcb_poll_for_queued_event(x11().connection<xcb_connection_t>());
@@ -298,6 +363,8 @@ void X11EventLoop::updateInternalData(const Event *event)
 
     break;
   }
+
+  default: break;     // No internal data depends on the other events
   }
 }
 
@@ -11,24 +11,59 @@
 // OpenGL headers
 #include <GL/gl.h>
 
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include <array>
+#include <algorithm>
+#include <iterator>
+
 namespace brdrive {
 
-static int GLX_VisualAttribs[] = {
+// The sizes (GLX_*_SIZE, GLX_SAMPLES) are filled in from
+//   the GLXContext::FramebufferConfig, see glx_visual_attribs()
+static const int GLX_VisualAttribs[] = {
   GLX_X_RENDERABLE, True,
   GLX_X_VISUAL_TYPE, GLX_TRUE_COLOR,
 
   GLX_DRAWABLE_TYPE, GLX_WINDOW_BIT,
 
+  GLX_RENDER_TYPE, GLX_RGBA_BIT,
+  GLX_RED_SIZE,   0,
+  GLX_GREEN_SIZE, 0,
+  GLX_BLUE_SIZE,  0,
+  GLX_ALPHA_SIZE, 0,
+
+  GLX_DEPTH_SIZE,   0,
+  GLX_STENCIL_SIZE, 0,
+
+  GLX_SAMPLE_BUFFERS, 0,
+  GLX_SAMPLES,        0,
+
+  GLX_DOUBLEBUFFER, True,
+
+  None,
+};
+
+// Used by contexts acquire()'d without a window, which
+//   render into a dummy pbuffer instead
+static int GLX_PbufferVisualAttribs[] = {
+  GLX_DRAWABLE_TYPE, GLX_PBUFFER_BIT,
+
   GLX_RENDER_TYPE, GLX_RGBA_BIT,
   GLX_RED_SIZE,   8,
   GLX_GREEN_SIZE, 8,
   GLX_BLUE_SIZE,  8,
   GLX_ALPHA_SIZE, 8,
 
-//  GLX_DEPTH_SIZE, 24,
-//  GLX_STENCIL_SIZE, 8,
+  None,
+};
 
-  GLX_DOUBLEBUFFER, True,
+static int GLX_PbufferAttribs[] = {
+  GLX_PBUFFER_WIDTH,  1,
+  GLX_PBUFFER_HEIGHT, 1,
 
   None,
 };
@@ -39,25 +74,187 @@ using glXCreateContextAttribsARBFn = ::GLXContext (*)(
     Display *, GLXFBConfig, ::GLXContext, Bool, const int *
   );
 
-static bool g_createcontextattribs_queried = false;
 static glXCreateContextAttribsARBFn glXCreateContextAttribsARB = nullptr;
 
-// ...Same with glXSwapIntervalEXT
+// ...Same with the swap control functions
 using glXSwapIntervalEXTFn = void (*)(
     Display *dpy, GLXDrawable drawable, int interval
   );
+using glXSwapIntervalMESAFn = int (*)(unsigned interval);
 
-static bool g_swapinterval_queried = false;
 static glXSwapIntervalEXTFn glXSwapIntervalEXT = nullptr;
+static glXSwapIntervalMESAFn glXSwapIntervalMESA = nullptr;
+
+// ...and GLX_OML_sync_control
+using glXGetSyncValuesOMLFn = Bool (*)(
+    Display *dpy, GLXDrawable drawable, int64_t *ust, int64_t *msc, int64_t *sbc
+  );
+using glXWaitForSbcOMLFn = Bool (*)(
+    Display *dpy, GLXDrawable drawable, int64_t target_sbc,
+    int64_t *ust, int64_t *msc, int64_t *sbc
+  );
+
+static glXGetSyncValuesOMLFn glXGetSyncValuesOML = nullptr;
+static glXWaitForSbcOMLFn glXWaitForSbcOML = nullptr;
+
+static bool g_glx_functions_loaded = false;
+
+// glXGetProcAddress() returns a (non-null) stub even for functions
+//   which the implementation doesn't support, so the pointers
+//   loaded here can only be called after checking the extension
+static auto glx_load_functions() -> void
+{
+  if(g_glx_functions_loaded) return;
+
+  auto get_proc_address = [](const char *name) {
+    return glXGetProcAddressARB((const GLubyte *)name);
+  };
+
+  glXCreateContextAttribsARB = (glXCreateContextAttribsARBFn)
+    get_proc_address("glXCreateContextAttribsARB");
+
+  glXSwapIntervalEXT = (glXSwapIntervalEXTFn)get_proc_address("glXSwapIntervalEXT");
+  glXSwapIntervalMESA = (glXSwapIntervalMESAFn)get_proc_address("glXSwapIntervalMESA");
+
+  glXGetSyncValuesOML = (glXGetSyncValuesOMLFn)get_proc_address("glXGetSyncValuesOML");
+  glXWaitForSbcOML = (glXWaitForSbcOMLFn)get_proc_address("glXWaitForSbcOML");
+
+  g_glx_functions_loaded = true;
+}
+
+static auto glx_has_extension(const char *extensions, const char *name) -> bool
+{
+  if(!extensions) return false;
+
+  auto name_len = strlen(name);
+  for(auto ext = strstr(extensions, name); ext; ext = strstr(ext+name_len, name)) {
+    // Make sure 'name' isn't only a prefix of another extension
+    auto ext_end = ext[name_len];
+    if(ext_end == ' ' || ext_end == '\0') return true;
+  }
+
+  return false;
+}
+
+static auto glx_visual_attribs(
+    const GLXContext::FramebufferConfig& config
+  ) -> std::array<int, std::size(GLX_VisualAttribs)>
+{
+  std::array<int, std::size(GLX_VisualAttribs)> attribs;
+  std::copy(std::begin(GLX_VisualAttribs), std::end(GLX_VisualAttribs), attribs.begin());
+
+  // 'attribs' is a list of (name, value) pairs terminated with None
+  for(size_t i = 0; attribs[i] != None; i += 2) {
+    auto& value = attribs[i+1];
+
+    switch(attribs[i]) {
+    case GLX_RED_SIZE:       value = config.red_bits; break;
+    case GLX_GREEN_SIZE:     value = config.green_bits; break;
+    case GLX_BLUE_SIZE:      value = config.blue_bits; break;
+    case GLX_ALPHA_SIZE:     value = config.alpha_bits; break;
+    case GLX_DEPTH_SIZE:     value = config.depth_bits; break;
+    case GLX_STENCIL_SIZE:   value = config.stencil_bits; break;
+    case GLX_SAMPLE_BUFFERS: value = config.samples > 0; break;
+    case GLX_SAMPLES:        value = config.samples; break;
+
+    default: break;
+    }
+  }
+
+  return attribs;
+}
+
+// Returns a penalty for the 'fb_config', which already meets the minimum
+//   requirements of the 'config' (as it was returned by glXChooseFBConfig()),
+//   or -1 when it's unusable - the FBConfig with the lowest one should be used
+//  - Slow (GLX_SLOW_CONFIG) configs are penalized the most, then ones which
+//    have an accumulation buffer or multisampling which wasn't requested and
+//    finally all the excess bits (color, depth, stencil, samples) are summed
+static auto glx_score_fb_config(
+    Display *display, GLXFBConfig fb_config, const GLXContext::FramebufferConfig& config
+  ) -> i64
+{
+  auto attrib = [&](int name) -> int {
+    int value = 0;
+    glXGetFBConfigAttrib(display, fb_config, name, &value);
+
+    return value;
+  };
+
+  // The FBConfig must have an X visual to be used with a window
+  if(!attrib(GLX_VISUAL_ID)) return -1;
+
+  i64 penalty = 0;
+
+  if(attrib(GLX_CONFIG_CAVEAT) == GLX_SLOW_CONFIG) penalty += 1ll<<40;
+
+  auto accum_bits = attrib(GLX_ACCUM_RED_SIZE) + attrib(GLX_ACCUM_GREEN_SIZE) +
+    attrib(GLX_ACCUM_BLUE_SIZE) + attrib(GLX_ACCUM_ALPHA_SIZE);
+  if(accum_bits) penalty += 1ll<<32;
+
+  auto samples = attrib(GLX_SAMPLE_BUFFERS) ? attrib(GLX_SAMPLES) : 0;
+  if(samples && !config.samples) penalty += 1ll<<32;
+
+  penalty += attrib(GLX_RED_SIZE) - config.red_bits;
+  penalty += attrib(GLX_GREEN_SIZE) - config.green_bits;
+  penalty += attrib(GLX_BLUE_SIZE) - config.blue_bits;
+  penalty += attrib(GLX_ALPHA_SIZE) - config.alpha_bits;
+  penalty += attrib(GLX_DEPTH_SIZE) - config.depth_bits;
+  penalty += attrib(GLX_STENCIL_SIZE) - config.stencil_bits;
+  penalty += samples - config.samples;
+
+  return penalty;
+}
+
+// Returns CLOCK_MONOTONIC in microseconds, i.e. in
+//   the same units and time base as the OML UST
+static auto glx_monotonic_us() -> u64
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (u64)ts.tv_sec*1'000'000ull + (u64)ts.tv_nsec/1'000ull;
+}
 
 struct pGLXContext {
   Display *display;
 
   ::GLXContext context = nullptr;
   GLXWindow window = 0;
+  GLXPbuffer pbuffer = 0;   // Only created when there's no 'window'
+
+  // Supported extensions
+  bool swap_control = false;          // GLX_EXT_swap_control
+  bool swap_control_mesa = false;     // GLX_MESA_swap_control
+  bool swap_control_tear = false;     // GLX_EXT_swap_control_tear
+  bool sync_control = false;          // GLX_OML_sync_control
+
+  int swap_interval = GLXContext::SwapVsync;
+
+  // The swaps which haven't been presented yet
+  struct PendingSwap {
+    i64 sbc;
+    u64 submit_us;
+  };
+
+  enum : unsigned {
+    MaxPendingSwaps = 16,
+  };
+
+  std::array<PendingSwap, MaxPendingSwaps> pending_swaps;
+  unsigned pending_first = 0, num_pending = 0;
+
+  bool sbc_known = false;
+  i64 issued_sbc = 0;       // SBC of the last swapBuffers()
+  i64 presented_sbc = 0;    // SBC of the last presented frame
+
+  GLXContext::PresentStats present_stats = { };
+  u64 latency_sum_us = 0, num_latency_samples = 0;
 
   ~pGLXContext();
 
+  auto queryExtensions() -> void;
+
   auto createContext(
       const GLXFBConfig& fb_config, IWindow *window, GLContext *share
     ) -> bool;
@@ -71,22 +268,25 @@ pGLXContext::~pGLXContext()
   auto display = x11().xlibDisplay<Display>();
 
   if(window) glXDestroyWindow(display, window);
+  if(pbuffer) glXDestroyPbuffer(display, pbuffer);
   if(context) glXDestroyContext(display, context);
 }
 
+auto pGLXContext::queryExtensions() -> void
+{
+  auto extensions = glXQueryExtensionsString(display, x11().defaultScreen());
+
+  swap_control = glx_has_extension(extensions, "GLX_EXT_swap_control");
+  swap_control_mesa = glx_has_extension(extensions, "GLX_MESA_swap_control");
+  swap_control_tear = swap_control && glx_has_extension(extensions, "GLX_EXT_swap_control_tear");
+  sync_control = glx_has_extension(extensions, "GLX_OML_sync_control");
+}
+
 auto pGLXContext::createContext(
     const GLXFBConfig& fb_config, IWindow *window, GLContext *share
   ) -> bool
 {
-  if(!g_createcontextattribs_queried) {
-    glXCreateContextAttribsARB = (glXCreateContextAttribsARBFn)
-      glXGetProcAddressARB((const GLubyte *)"glXCreateContextAttribsARB");
-  }
-
-  if(!g_swapinterval_queried) {
-    glXSwapIntervalEXT = (glXSwapIntervalEXTFn)
-      glXGetProcAddressARB((const GLubyte *)"glXSwapIntervalEXT");
-  }
+  glx_load_functions();
 
   // Only old-style contexts are available 
   if(!glXCreateContextAttribsARB) return false;
@@ -132,49 +332,98 @@ auto pGLXContext::createContextLegacy(
 }
 
 GLXContext::GLXContext() :
-  p(nullptr)
+  GLXContext(FramebufferConfig())
 {
 }
 
-GLXContext::~GLXContext()
+GLXContext::GLXContext(const FramebufferConfig& config) :
+  config_(config),
+  fb_config_(nullptr), visual_({ 0, 0 }),
+  p(nullptr)
 {
-  delete p;
 }
 
-auto GLXContext::acquire(IWindow *window_, GLContext *share) -> GLContext&
+auto GLXContext::chooseVisual() -> Visual
 {
   assert(brdrive::x11_was_init() &&
-      "x11_init() MUST be called prior to creating a GLXContext!");
+      "x11_init() MUST be called prior to choosing the visual!");
+
+  if(fb_config_) return visual_;
 
   auto display = x11().xlibDisplay<Display>();
 
+  auto attribs = glx_visual_attribs(config_);
+
   int num_fb_configs = 0;
   auto fb_configs = glXChooseFBConfig(
       display, x11().defaultScreen(),
-      GLX_VisualAttribs, &num_fb_configs
+      attribs.data(), &num_fb_configs
   );
-  if(!fb_configs || !num_fb_configs) throw NoSuitableFramebufferConfigError();
+  if(!fb_configs || !num_fb_configs) {
+    if(fb_configs) XFree(fb_configs);
 
-  // TODO: smarter way of choosing the FBConfig (?)
-  auto fb_config = fb_configs[0];
-  XVisualInfo *visual_info = glXGetVisualFromFBConfig(display, fb_config);
+    throw NoSuitableFramebufferConfigError();
+  }
 
-  auto cleanup_x_structures = [&]() -> void {
-    XFree(visual_info);
-    XFree(fb_configs);
-  };
+  // The FBConfigs are sorted by glXChooseFBConfig(), but the sort
+  //   order prefers MORE color bits, so re-score them all
+  GLXFBConfig best_fb_config = nullptr;
+  i64 best_penalty = -1;
+  for(int i = 0; i < num_fb_configs; i++) {
+    auto penalty = glx_score_fb_config(display, fb_configs[i], config_);
+    if(penalty < 0) continue;
+
+    if(best_penalty < 0 || penalty < best_penalty) {
+      best_fb_config = fb_configs[i];
+      best_penalty = penalty;
+    }
+  }
+
+  // The GLXFBConfigs themselves are owned by the Display
+  //   (only the array has to be freed)
+  XFree(fb_configs);
+
+  if(!best_fb_config) throw NoSuitableFramebufferConfigError();
+
+  XVisualInfo *visual_info = glXGetVisualFromFBConfig(display, best_fb_config);
+  if(!visual_info) throw NoSuitableFramebufferConfigError();
+
+  fb_config_ = best_fb_config;
+  visual_ = Visual { (u8)visual_info->depth, (u32)visual_info->visualid };
+
+  XFree(visual_info);
+
+  return visual_;
+}
+
+GLXContext::~GLXContext()
+{
+  delete p;
+}
+
+auto GLXContext::acquire(IWindow *window_, GLContext *share) -> GLContext&
+{
+  assert(brdrive::x11_was_init() &&
+      "x11_init() MUST be called prior to creating a GLXContext!");
+
+  auto display = x11().xlibDisplay<Display>();
 
-  auto depth  = visual_info->depth;
-  auto visual = visual_info->visualid;
+  if(!window_) return acquireOffscreen(share);
+
+  // No-op when it was already called before creating the window
+  auto visual = chooseVisual();
+  auto fb_config = (GLXFBConfig)fb_config_;
 
   // The visual of the window must match that of the
   //   FBConfig, so make sure that's the case before
   //   assigning the context to it
+  //  - This only happens when the window wasn't created
+  //    with the chooseVisual() result
   auto window = (X11Window *)window_;
-  if(!window->recreateWithVisualId(depth, visual)) {
-    cleanup_x_structures();
-
-    throw X11Window::X11InternalError();
+  if(window->visualId() != visual.visual_id) {
+    if(!window->recreateWithVisualId(visual.depth, visual.visual_id)) {
+      throw X11Window::X11InternalError();
+    }
   }
 
   // The XID of the window
@@ -192,28 +441,29 @@ auto GLXContext::acquire(IWindow *window_, GLContext *share) -> GLContext&
   }
 
   // Check if context creation was successful
-  if(!p->context) throw AcquireError();
+  if(p->context) {
+    p->window = glXCreateWindow(
+        display, fb_config, x11_window_handle, nullptr
+    );
+  }
 
-  p->window = glXCreateWindow(
-      display, fb_config, x11_window_handle, nullptr
-  );
   if(!p->window) {
-    glXDestroyContext(display, p->context);
-    cleanup_x_structures();
-
+    // Also destroys the context (if it was created)
     delete p;
     p = nullptr;
 
     throw AcquireError();
   }
 
-  glXSwapIntervalEXT(display, p->window, 1);
-
-  cleanup_x_structures();
+  p->queryExtensions();
 
   // Mark the context as successfully acquired
   was_acquired_ = true;
 
+  // Make sure the swaps are vsync'ed regardless of
+  //   the implementation's default
+  swapInterval(SwapVsync);
+
   return *this;
 }
 
@@ -222,7 +472,7 @@ auto GLXContext::makeCurrent() -> GLContext&
   assert(was_acquired_ && "the context must've been acquire()'d to makeCurrent()!");
 
   auto display  = p->display;
-  auto drawable = (GLXDrawable)p->window;
+  auto drawable = p->window ? (GLXDrawable)p->window : (GLXDrawable)p->pbuffer;
   auto context  = p->context;
 
   auto success = glXMakeContextCurrent(display, drawable, drawable, context);
@@ -236,10 +486,186 @@ auto GLXContext::makeCurrent() -> GLContext&
 auto GLXContext::swapBuffers() -> GLContext&
 {
   assert(was_acquired_ && "the context must've been acquire()'d to swapBuffers()!");
+  assert(p->window && "attempted to swapBuffers() on a context without a window!");
 
   auto drawable = (GLXDrawable)p->window;
   glXSwapBuffers(p->display, drawable);
 
+  if(p->sync_control) {
+    if(!p->sbc_known) {
+      // Start counting from the drawable's current SBC
+      //   (excluding the swap which was just issued)
+      int64_t ust = 0, msc = 0, sbc = 0;
+      if(glXGetSyncValuesOML(p->display, drawable, &ust, &msc, &sbc)) {
+        p->issued_sbc = p->presented_sbc = sbc;
+        p->sbc_known = true;
+      }
+    }
+
+    if(p->sbc_known) {
+      if(p->num_pending == pGLXContext::MaxPendingSwaps) {
+        // Should never really happen - the driver
+        //   throttles the swaps way before that
+        p->pending_first = (p->pending_first + 1) % pGLXContext::MaxPendingSwaps;
+        p->num_pending--;
+      }
+
+      auto idx = (p->pending_first + p->num_pending) % pGLXContext::MaxPendingSwaps;
+      p->pending_swaps[idx] = pGLXContext::PendingSwap { ++p->issued_sbc, glx_monotonic_us() };
+      p->num_pending++;
+    }
+
+    collectPresentTiming();
+  }
+
+  return *this;
+}
+
+auto GLXContext::swapInterval(int interval) -> bool
+{
+  assert(was_acquired_ && "the context must've been acquire()'d to set it's swapInterval()!");
+  assert(p->window && "the swapInterval() can only be set on a context with a window!");
+
+  if(interval < 0 && !p->swap_control_tear) return false;
+
+  if(p->swap_control) {
+    glXSwapIntervalEXT(p->display, (GLXDrawable)p->window, interval);
+  } else if(p->swap_control_mesa && interval >= 0 && GLContext::current() == this) {
+    // The MESA version only affects the current drawable
+    if(glXSwapIntervalMESA((unsigned)interval)) return false;
+  } else {
+    return false;
+  }
+
+  p->swap_interval = interval;
+
+  return true;
+}
+
+auto GLXContext::swapInterval() const -> int
+{
+  assert(was_acquired_);
+
+  return p->swap_interval;
+}
+
+auto GLXContext::adaptiveVsyncSupported() const -> bool
+{
+  assert(was_acquired_);
+
+  return p->swap_control_tear;
+}
+
+auto GLXContext::presentTimingSupported() const -> bool
+{
+  assert(was_acquired_);
+
+  return p->sync_control;
+}
+
+auto GLXContext::presentStats() -> PresentStats
+{
+  assert(was_acquired_);
+
+  if(p->sync_control && p->window) collectPresentTiming();
+
+  return p->present_stats;
+}
+
+auto GLXContext::collectPresentTiming() -> void
+{
+  if(!p->sbc_known) return;
+
+  auto drawable = (GLXDrawable)p->window;
+
+  int64_t ust = 0, msc = 0, sbc = 0;
+  if(!glXGetSyncValuesOML(p->display, drawable, &ust, &msc, &sbc)) return;
+
+  // Nothing was presented since the last call
+  if(sbc <= p->presented_sbc) return;
+
+  // The swap has already completed, so this doesn't block - it only
+  //   fetches the UST/MSC of when the latest swap was presented
+  //   (glXGetSyncValuesOML() returns the ones of the latest vblank)
+  if(!glXWaitForSbcOML(p->display, drawable, sbc, &ust, &msc, &sbc)) return;
+
+  auto& stats = p->present_stats;
+  auto num_presented = (u64)(sbc - p->presented_sbc);
+
+  // Each frame should take 'interval' vblanks (adaptive vsync
+  //   and SwapImmediate are still expected to take at least one)
+  if(stats.num_presented) {
+    auto expected_vblanks = num_presented * (u64)std::max(std::abs(p->swap_interval), 1);
+    auto vblanks = (u64)msc - stats.last_msc;
+
+    if(vblanks > expected_vblanks) stats.num_missed += vblanks - expected_vblanks;
+  }
+
+  stats.num_presented += num_presented;
+  stats.last_ust = (u64)ust;
+  stats.last_msc = (u64)msc;
+
+  p->presented_sbc = sbc;
+
+  // Retire the swaps which were presented - only the latency of the latest
+  //   one is known (the timing of the earlier ones is lost)
+  while(p->num_pending) {
+    const auto& swap = p->pending_swaps[p->pending_first];
+    if(swap.sbc > sbc) break;
+
+    if(swap.sbc == sbc && (u64)ust >= swap.submit_us) {
+      stats.last_latency_us = (u64)ust - swap.submit_us;
+
+      p->latency_sum_us += stats.last_latency_us;
+      p->num_latency_samples++;
+
+      stats.avg_latency_us = p->latency_sum_us / p->num_latency_samples;
+    }
+
+    p->pending_first = (p->pending_first + 1) % pGLXContext::MaxPendingSwaps;
+    p->num_pending--;
+  }
+}
+
+auto GLXContext::acquireOffscreen(GLContext *share) -> GLContext&
+{
+  auto display = x11().xlibDisplay<Display>();
+
+  int num_fb_configs = 0;
+  auto fb_configs = glXChooseFBConfig(
+      display, x11().defaultScreen(),
+      GLX_PbufferVisualAttribs, &num_fb_configs
+  );
+  if(!fb_configs || !num_fb_configs) {
+    if(fb_configs) XFree(fb_configs);
+
+    throw NoSuitableFramebufferConfigError();
+  }
+
+  auto fb_config = fb_configs[0];
+
+  p = new pGLXContext();
+
+  p->display = display;
+
+  if(!p->createContext(fb_config, nullptr, share)) {
+    p->createContextLegacy(fb_config, nullptr, share);
+  }
+
+  p->pbuffer = p->context ? glXCreatePbuffer(display, fb_config, GLX_PbufferAttribs) : 0;
+
+  XFree(fb_configs);
+
+  if(!p->pbuffer) {
+    delete p;
+    p = nullptr;
+
+    throw AcquireError();
+  }
+
+  // Mark the context as successfully acquired
+  was_acquired_ = true;
+
   return *this;
 }
 
@@ -29,10 +29,16 @@ struct pX11Window {
   xcb_window_t window;
   xcb_colormap_t colormap;
 
+  xcb_visualid_t visual;
+
   ~pX11Window();
 
   // Returns 'false' on failure
-  auto init(const Geometry& geom, const Color& bg_color) -> bool;
+  //  - When 'visual' == 0 the root window's visual is used
+  auto init(
+      const Geometry& geom, const Color& bg_color,
+      u8 depth = 0, xcb_visualid_t visual = 0
+    ) -> bool;
 
   auto font(const std::string& font_name) -> std::optional<xcb_font_t>
   {
@@ -92,15 +98,20 @@ pX11Window::~pX11Window()
   }
 }
 
-auto pX11Window::init(const Geometry& geom, const Color& bg_color) -> bool
+auto pX11Window::init(
+    const Geometry& geom, const Color& bg_color,
+    u8 depth, xcb_visualid_t visual
+  ) -> bool
 {
   connection = x11().connection<xcb_connection_t>();
   setup = x11().setup<xcb_setup_t>();
   screen = x11().screen<xcb_screen_t>();
 
+  // The colormap must be created with the same visual as
+  //   the window (see the comment in recreateWithVisualId())
   window = screen->root;
-  if(!createColormap()) return false;
-  if(!createWindow(geom, bg_color)) return false;
+  if(!createColormap(visual)) return false;
+  if(!createWindow(geom, bg_color, depth, visual)) return false;
 
   return true;
 }
@@ -127,6 +138,7 @@ auto pX11Window::createWindow(
 {
   // Acquire an id for the window
   window = x11().genId();
+  this->visual = visual ? visual : screen->root_visual;
 
   u32 mask = XCB_CW_BACK_PIXEL | XCB_CW_EVENT_MASK | XCB_CW_COLORMAP;
   u32 args[] = {
@@ -198,6 +210,7 @@ auto pX11Window::createColormap(xcb_visualid_t visual) -> bool
 }
 
 X11Window::X11Window() :
+  visual_depth_(0), visual_id_(0),
   p(nullptr)
 {
 }
@@ -211,7 +224,7 @@ auto X11Window::create() -> IWindow&
 {
   p = new pX11Window();
 
-  if(!p->init(geometry_, background_)) throw X11InternalError();
+  if(!p->init(geometry_, background_, visual_depth_, visual_id_)) throw X11InternalError();
 
   return *this;
 }
@@ -261,6 +274,16 @@ auto X11Window::destroy() -> IWindow&
   return *this;
 }
 
+auto X11Window::visual(u8 depth, u32 visual_id) -> X11Window&
+{
+  assert(!p && "the visual() can only be changed before create()!");
+
+  visual_depth_ = depth;
+  visual_id_ = visual_id;
+
+  return *this;
+}
+
 auto X11Window::windowHandle() -> X11WindowHandle
 {
   assert(p);
@@ -268,6 +291,13 @@ auto X11Window::windowHandle() -> X11WindowHandle
   return p->window;
 }
 
+auto X11Window::visualId() const -> u32
+{
+  assert(p);
+
+  return p->visual;
+}
+
 auto X11Window::recreateWithVisualId(u8 depth, u32 visual_id) -> bool
 {
   xcb_destroy_window(p->connection, p->window);